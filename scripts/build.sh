@@ -34,6 +34,12 @@ else
     EXTRA_CMAKE_FLAGS="-DCMAKE_BUILD_TYPE=Release"
 fi
 
+# FRACTAL_PROFILE=ON make build: collect render counters (getTileStats)
+if [ "${FRACTAL_PROFILE:-OFF}" = "ON" ]; then
+    echo "   Profiling counters enabled"
+fi
+EXTRA_CMAKE_FLAGS="$EXTRA_CMAKE_FLAGS -DFRACTAL_PROFILE=${FRACTAL_PROFILE:-OFF}"
+
 # Run CMake
 echo "   Configuring with CMake..."
 emcmake cmake -B "$BUILD_DIR" $EXTRA_CMAKE_FLAGS
@@ -0,0 +1,244 @@
+/**
+ * Fractal Explorer - Native microbenchmark
+ *
+ * Renders a fixed set of scenes on one thread and prints the throughput of
+ * the iteration and coloring stages as JSON, so runs can be compared across
+ * commits and machines:
+ *
+ *   fractal_bench [--width W] [--height H] [--repeat N] [--scene NAME]
+ *                 [--trace FILE]
+ *
+ * Each stage is timed N times and the median is reported. Iterations count
+ * each escaped pixel's escape count and each interior pixel as
+ * max_iterations: the work of the plain escape-time loop, so savings from the
+ * periodicity check show up as higher Giterations/s. Built with
+ * FRACTAL_PROFILE, each scene also reports the engine's hot-path counters
+ * for its last run (iterations actually taken, cardioid/bulb and periodic
+ * points, escape-count histogram). --trace writes a Chrome trace-event
+ * timeline of every run.
+ */
+
+#include "core/fractal_engine.h"
+#include "core/simd.h"
+#include "core/trace_recorder.h"
+#include "rendering/viewport.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct Scene {
+    const char* name;
+    double center_x;
+    double center_y;
+    double span;  // Width of the view in the complex plane
+    int max_iterations;
+    fractal::FractalType type;
+    double c_real;
+    double c_imag;
+};
+
+const Scene kScenes[] = {
+    {"full_set", -0.5, 0.0, 3.2, 1000, fractal::MANDELBROT, 0.0, 0.0},
+    {"seahorse_valley", -0.7436438870371587, 0.1318259042053127, 5e-3, 2000,
+     fractal::MANDELBROT, 0.0, 0.0},
+    {"elephant_valley", 0.2750, 0.0060, 1.5e-2, 2000, fractal::MANDELBROT, 0.0, 0.0},
+    {"interior_minibrot", -1.7548776662466927, 0.0, 1.6e-3, 5000, fractal::MANDELBROT, 0.0,
+     0.0},
+    {"julia", 0.0, 0.0, 3.2, 1000, fractal::JULIA, -0.8, 0.156},
+};
+
+struct SceneResult {
+    double iterate_ms;
+    double color_ms;
+    double iterations;
+    double inside_fraction;
+    fractal::RenderStats stats;  // Last run, profiling builds only
+};
+
+double median(std::vector<double> values) {
+    std::sort(values.begin(), values.end());
+    size_t middle = values.size() / 2;
+    return values.size() % 2 ? values[middle] : (values[middle - 1] + values[middle]) / 2;
+}
+
+double elapsedMs(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start)
+        .count();
+}
+
+SceneResult runScene(const Scene& scene, int width, int height, int repeat) {
+    fractal::FractalEngine engine;
+    fractal::Viewport viewport(scene.center_x, scene.center_y, scene.span / width, width,
+                               height);
+    fractal::RenderParams params;
+    params.max_iterations = scene.max_iterations;
+
+    fractal::IterationField field;
+    field.reset(0, 0, width, height);
+    std::vector<uint8_t> pixels;
+
+    std::vector<double> iterate_times, color_times;
+    for (int run = 0; run < repeat; run++) {
+        engine.resetRenderStats();
+        auto start = std::chrono::steady_clock::now();
+        engine.renderTile(0, 0, width, height, viewport, params, scene.type, scene.c_real,
+                          scene.c_imag, nullptr, 0, &field);
+        iterate_times.push_back(elapsedMs(start));
+
+        start = std::chrono::steady_clock::now();
+        fractal::FractalEngine::recolorFrame(field, params, pixels);
+        color_times.push_back(elapsedMs(start));
+    }
+
+    double iterations = 0.0;
+    size_t inside = 0;
+    for (size_t i = 0; i < field.smooth_values.size(); i++) {
+        if (field.inside_set[i]) {
+            iterations += scene.max_iterations;
+            inside++;
+        } else {
+            iterations += std::max(1.0f, field.smooth_values[i]);
+        }
+    }
+
+    SceneResult result;
+    result.iterate_ms = median(iterate_times);
+    result.color_ms = median(color_times);
+    result.iterations = iterations;
+    result.inside_fraction = static_cast<double>(inside) / field.smooth_values.size();
+    result.stats = engine.renderStats();
+    return result;
+}
+
+const char* simdName() {
+#if defined(__wasm_simd128__)
+    return "simd128";
+#elif defined(__AVX2__) || defined(__AVX__)
+    return "avx2";
+#elif defined(__SSE2__) || defined(_M_X64)
+    return "sse2";
+#else
+    return "scalar";
+#endif
+}
+
+// "profile" member of a scene, as its last lines
+void printStats(const fractal::RenderStats& stats) {
+    std::cout << ",\n      \"profile\": {\n"
+              << "        \"points\": " << stats.points << ",\n"
+              << "        \"iterations\": " << stats.iterations << ",\n"
+              << "        \"bulb_skipped\": " << stats.bulb_skipped << ",\n"
+              << "        \"periodic\": " << stats.periodic << ",\n"
+              << "        \"escaped\": " << stats.escaped << ",\n"
+              << "        \"limit_reached\": " << stats.limit_reached << ",\n"
+              << "        \"iterate_ms\": " << stats.iterate_ms << ",\n"
+              << "        \"escape_histogram\": [";
+    for (int bin = 0; bin < fractal::RenderStats::kHistogramBins; bin++) {
+        std::cout << (bin ? ", " : "") << stats.escape_histogram[bin];
+    }
+    std::cout << "]\n      }";
+}
+
+void usage() {
+    std::cerr << "usage: fractal_bench [--width W] [--height H] [--repeat N] [--scene NAME] "
+              << "[--trace FILE]" << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    int width = 640;
+    int height = 480;
+    int repeat = 5;
+    std::string only;
+    std::string trace_path;
+
+    for (int i = 1; i < argc; i++) {
+        bool has_value = i + 1 < argc;
+        if (!std::strcmp(argv[i], "--width") && has_value) {
+            width = std::atoi(argv[++i]);
+        } else if (!std::strcmp(argv[i], "--height") && has_value) {
+            height = std::atoi(argv[++i]);
+        } else if (!std::strcmp(argv[i], "--repeat") && has_value) {
+            repeat = std::atoi(argv[++i]);
+        } else if (!std::strcmp(argv[i], "--scene") && has_value) {
+            only = argv[++i];
+        } else if (!std::strcmp(argv[i], "--trace") && has_value) {
+            trace_path = argv[++i];
+        } else {
+            usage();
+            return 1;
+        }
+    }
+    if (width < 1 || height < 1 || repeat < 1) {
+        usage();
+        return 1;
+    }
+
+    fractal::TraceRecorder trace;
+    if (!trace_path.empty()) {
+        trace.start();
+    }
+
+    double pixels = static_cast<double>(width) * height;
+    std::cout.precision(6);
+    std::cout << "{\n"
+              << "  \"width\": " << width << ",\n"
+              << "  \"height\": " << height << ",\n"
+              << "  \"repeat\": " << repeat << ",\n"
+              << "  \"threads\": 1,\n"
+              << "  \"simd\": \"" << simdName() << "\",\n"
+              << "  \"double_lanes\": " << fractal::simd::VecD::kLanes << ",\n"
+              << "  \"compiler\": \"" << __VERSION__ << "\",\n"
+              << "  \"scenes\": [";
+
+    bool first = true;
+    for (const Scene& scene : kScenes) {
+        if (!only.empty() && only != scene.name) {
+            continue;
+        }
+        SceneResult result;
+        {
+            fractal::TraceSpan span(scene.name, "scene");
+            result = runScene(scene, width, height, repeat);
+        }
+        double total_ms = result.iterate_ms + result.color_ms;
+
+        std::cout << (first ? "\n" : ",\n")
+                  << "    {\n"
+                  << "      \"name\": \"" << scene.name << "\",\n"
+                  << "      \"max_iterations\": " << scene.max_iterations << ",\n"
+                  << "      \"inside_fraction\": " << result.inside_fraction << ",\n"
+                  << "      \"iterate_ms\": " << result.iterate_ms << ",\n"
+                  << "      \"color_ms\": " << result.color_ms << ",\n"
+                  << "      \"mpixels_per_s\": " << pixels / total_ms / 1e3 << ",\n"
+                  << "      \"giterations_per_s\": " << result.iterations / result.iterate_ms / 1e6
+                  << ",\n"
+                  << "      \"iterate_ns_per_pixel\": " << result.iterate_ms * 1e6 / pixels
+                  << ",\n"
+                  << "      \"color_ns_per_pixel\": " << result.color_ms * 1e6 / pixels;
+        if (fractal::RenderStats::enabled()) {
+            printStats(result.stats);
+        }
+        std::cout << "\n    }";
+        first = false;
+    }
+    std::cout << "\n  ]\n}" << std::endl;
+
+    if (first) {
+        std::cerr << "no scene named " << only << std::endl;
+        return 1;
+    }
+    trace.stop();
+    if (!trace_path.empty() && !trace.writeFile(trace_path)) {
+        std::cerr << "could not write " << trace_path << std::endl;
+        return 1;
+    }
+    return 0;
+}
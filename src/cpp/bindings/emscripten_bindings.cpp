@@ -1,9 +1,20 @@
 #include <emscripten/bind.h>
 #include <emscripten/val.h>
 #include "../core/fractal_engine.h"
+#include "../core/color_histogram.h"
+#include "../core/color_palette.h"
+#include "../core/trace_recorder.h"
 #include "../rendering/viewport.h"
 #include "../rendering/tile_manager.h"
 #include "../rendering/progressive_renderer.h"
+#include "../rendering/pixel_buffer_pool.h"
+#include "../rendering/tile_cache.h"
+#include "../rendering/pan_renderer.h"
+#include "../rendering/render_session.h"
+#include <algorithm>
+#include <limits>
+#include <string>
+#include <vector>
 
 using namespace emscripten;
 using namespace fractal;
@@ -11,32 +22,532 @@ using namespace fractal;
 // Global engine instance
 static FractalEngine engine;
 
-// Render a tile and return pixel data
-val renderTile(int x_start, int y_start, int tile_width, int tile_height,
-              double center_x, double center_y, double scale, int width, int height,
-              int max_iter, int fractal_type, double julia_c_re, double julia_c_im,
-              int palette_id) {
+// Pixel buffers leased to JS, plus the buffer behind the returning
+// renderTile/renderTileDeep calls
+static PixelBufferPool pixel_pool;
+static uint8_t* result_buffer = nullptr;
 
-    // Create viewport
-    Viewport viewport(center_x, center_y, scale, width, height);
+// Module-owned buffer for the returning render calls. The returned view stays
+// valid until the next such call.
+static uint8_t* resultBuffer(size_t size) {
+    if (!result_buffer || pixel_pool.capacity(result_buffer) < size) {
+        if (result_buffer) {
+            pixel_pool.release(result_buffer);
+        }
+        result_buffer = pixel_pool.acquire(size);
+    }
+    return result_buffer;
+}
+
+// The view a retained tile was rendered for. Deep renders carry their
+// center as decimal strings, the others as doubles.
+struct RetainedView {
+    double center_x = 0.0;
+    double center_y = 0.0;
+    std::string deep_center_x;
+    std::string deep_center_y;
+    double scale = 0.0;
+    int width = 0;
+    int height = 0;
+    int fractal_type = 0;
+    double julia_c_re = 0.0;
+    double julia_c_im = 0.0;
+
+    bool operator==(const RetainedView& other) const {
+        return center_x == other.center_x && center_y == other.center_y &&
+               deep_center_x == other.deep_center_x &&
+               deep_center_y == other.deep_center_y && scale == other.scale &&
+               width == other.width && height == other.height &&
+               fractal_type == other.fractal_type && julia_c_re == other.julia_c_re &&
+               julia_c_im == other.julia_c_im;
+    }
+};
+
+static RetainedView retainedView(double center_x, double center_y, double scale, int width,
+                                 int height, int fractal_type, double julia_c_re,
+                                 double julia_c_im) {
+    RetainedView view;
+    view.center_x = center_x;
+    view.center_y = center_y;
+    view.scale = scale;
+    view.width = width;
+    view.height = height;
+    view.fractal_type = fractal_type;
+    view.julia_c_re = julia_c_re;
+    view.julia_c_im = julia_c_im;
+    return view;
+}
+
+static RetainedView deepRetainedView(const std::string& center_x, const std::string& center_y,
+                                     double scale, int width, int height) {
+    RetainedView view;
+    view.deep_center_x = center_x;
+    view.deep_center_y = center_y;
+    view.scale = scale;
+    view.width = width;
+    view.height = height;
+    return view;
+}
+
+// Iteration data of the tiles this module rendered for the current view,
+// one field per tile, so that a palette change can be served by
+// recolorTileInto and a higher iteration limit by continueTileInto. Each
+// module (worker) only holds the tiles it rendered itself; rendering
+// another view drops them.
+static RetainedView retained_view;
+static std::vector<IterationField> retained_tiles;
+
+// Whether retained tiles also keep the orbits of pixels stopped by the
+// iteration limit (16 of the 21 bytes a retained pixel costs). Set by a
+// caller that will raise the limit; progressive passes keep theirs only
+// until the last pass.
+static bool keep_orbits = false;
+
+// The retained field covering a tile of the current view, or null
+static IterationField* findRetained(int x_start, int y_start, int tile_width,
+                                    int tile_height) {
+    for (IterationField& field : retained_tiles) {
+        if (x_start >= field.origin_x && y_start >= field.origin_y &&
+            x_start + tile_width <= field.origin_x + field.width &&
+            y_start + tile_height <= field.origin_y + field.height) {
+            return &field;
+        }
+    }
+    return nullptr;
+}
+
+// A cleared field for a tile about to be rendered for view, replacing any
+// earlier data overlapping it. Valid until the next call.
+static IterationField* retainedField(const RetainedView& view, int x_start, int y_start,
+                                     int tile_width, int tile_height, bool orbits) {
+    if (x_start < 0 || y_start < 0 || x_start + tile_width > view.width ||
+        y_start + tile_height > view.height) {
+        return nullptr;  // Tile not inside the frame: nothing to retain
+    }
+    if (!(view == retained_view)) {
+        retained_tiles.clear();
+        retained_view = view;
+    }
+    retained_tiles.erase(
+        std::remove_if(retained_tiles.begin(), retained_tiles.end(),
+                       [&](const IterationField& field) {
+                           return x_start < field.origin_x + field.width &&
+                                  field.origin_x < x_start + tile_width &&
+                                  y_start < field.origin_y + field.height &&
+                                  field.origin_y < y_start + tile_height;
+                       }),
+        retained_tiles.end());
+    retained_tiles.emplace_back();
+    IterationField& field = retained_tiles.back();
+    field.keep_orbits = orbits;
+    field.reset(x_start, y_start, tile_width, tile_height);
+    return &field;
+}
+
+// Start or stop keeping a retained field's orbits. Orbits added to a field
+// are unrecorded, so the next continueTile recomputes those pixels once.
+static void setFieldOrbits(IterationField& field, bool orbits) {
+    if (field.keep_orbits == orbits) {
+        return;
+    }
+    field.keep_orbits = orbits;
+    size_t size = orbits ? field.smooth_values.size() : 0;
+    std::vector<double>(size, std::numeric_limits<double>::infinity()).swap(field.orbit_real);
+    std::vector<double>(size, std::numeric_limits<double>::infinity()).swap(field.orbit_imag);
+}
+
+void setKeepOrbits(bool keep) {
+    keep_orbits = keep;
+}
+
+// World-aligned tiles this module has rendered, reused across pan and zoom
+static TileCache tile_cache;
+
+// Mariani-Silver subdivision for the non-deep render calls
+static bool subdivision_enabled = false;
 
-    // Create render params
+// Adaptive anti-aliasing cap (samples per pixel, 1: off) for the non-deep
+// render calls, and the extra samples the last of them took
+static int antialias_samples = 1;
+static int last_extra_samples = 0;
+
+// Frame-wide histogram for equalized coloring, set by the main thread from
+// the merged tile histograms; unset means linear coloring
+static ColorHistogram color_histogram;
+static bool equalize_colors = false;
+
+// Colors from setCustomPalette, used by the render calls given palette id
+// kCustomPalette
+static const int kCustomPalette = -1;
+static std::shared_ptr<const ColorPalette> custom_palette;
+
+// Counters of the last render call (profiling builds only)
+static RenderStats call_stats;
+
+static RenderParams makeParams(int max_iter, int palette_id) {
     RenderParams params;
     params.max_iterations = max_iter;
     params.bailout_radius = 4.0;
     params.smooth_coloring = true;
     params.palette_id = palette_id;
+    params.palette = palette_id == kCustomPalette ? custom_palette.get() : nullptr;
+    params.subdivide = subdivision_enabled;
+    params.antialias_samples = antialias_samples;
+    params.color_histogram = equalize_colors ? &color_histogram : nullptr;
+    call_stats.reset();
+    params.stats = &call_stats;
+    return params;
+}
+
+void setSubdivision(bool enabled) {
+    subdivision_enabled = enabled;
+}
+
+void setAntialiasing(int max_samples) {
+    antialias_samples = std::max(1, max_samples);
+}
+
+int lastExtraSamples() {
+    return last_extra_samples;
+}
+
+// Color every following call through the CDF of these histogram counts
+// (merged tileHistogram results for a max_iter render)
+void setColorHistogram(val counts, int max_iter) {
+    color_histogram.reset(max_iter);
+    color_histogram.setCounts(vecFromJSArray<uint32_t>(counts));
+    color_histogram.finalize();
+    equalize_colors = true;
+}
+
+void clearColorHistogram() {
+    equalize_colors = false;
+}
+
+// Set the colors of palette id -1 from a flat [r, g, b, r, g, b, ...]
+// array; an empty array falls back to the default palette
+void setCustomPalette(val rgb) {
+    std::vector<uint8_t> bytes = vecFromJSArray<uint8_t>(rgb);
+    std::vector<Color> colors;
+    for (size_t i = 0; i + 2 < bytes.size(); i += 3) {
+        colors.push_back(Color(bytes[i], bytes[i + 1], bytes[i + 2]));
+    }
+    custom_palette = colors.empty() ? nullptr : ColorPalette::custom(colors);
+}
+
+// Histogram of a retained tile, counting only the sample_step grid a
+// progressive pass has filled. The view is only valid until the next call;
+// returns null if this module holds no data for the tile.
+val tileHistogram(int x_start, int y_start, int tile_width, int tile_height, int max_iter,
+                  int sample_step) {
+    const IterationField* field = findRetained(x_start, y_start, tile_width, tile_height);
+    if (!field) {
+        return val::null();
+    }
+
+    static ColorHistogram tile_histogram;
+    tile_histogram.reset(max_iter);
+    tile_histogram.addField(*field, x_start, y_start, tile_width, tile_height,
+                            sample_step);
+    const std::vector<uint32_t>& counts = tile_histogram.counts();
+    return val(typed_memory_view(counts.size(), counts.data()));
+}
+
+// Lease a persistent RGBA buffer in the wasm heap. Returns its address, to be
+// passed to renderTileInto/renderTileDeepInto and finally releaseTileBuffer.
+uintptr_t acquireTileBuffer(int size_bytes) {
+    return reinterpret_cast<uintptr_t>(pixel_pool.acquire(size_bytes));
+}
+
+void releaseTileBuffer(uintptr_t buffer) {
+    pixel_pool.release(reinterpret_cast<uint8_t*>(buffer));
+}
+
+// Render a tile into a leased buffer and return a view of it (no copy)
+val renderTileInto(uintptr_t buffer, int x_start, int y_start, int tile_width, int tile_height,
+                   double center_x, double center_y, double scale, int width, int height,
+                   int max_iter, int fractal_type, double julia_c_re, double julia_c_im,
+                   int palette_id) {
+    uint8_t* pixels = reinterpret_cast<uint8_t*>(buffer);
+    size_t size = static_cast<size_t>(tile_width) * tile_height * 4;
+    if (pixel_pool.capacity(pixels) < size) {
+        return val::null();
+    }
+
+    Viewport viewport(center_x, center_y, scale, width, height);
+    RenderParams params = makeParams(max_iter, palette_id);
+
+    last_extra_samples = engine.renderTile(
+        x_start, y_start, tile_width, tile_height, viewport, params,
+        static_cast<FractalType>(fractal_type), julia_c_re, julia_c_im, pixels, tile_width * 4,
+        retainedField(retainedView(center_x, center_y, scale, width, height, fractal_type,
+                                   julia_c_re, julia_c_im),
+                      x_start, y_start, tile_width, tile_height, keep_orbits));
+
+    return val(typed_memory_view(size, pixels));
+}
+
+// Deep-zoom (perturbation) variant of renderTileInto. The center is passed as
+// decimal strings so it can carry more digits than a double.
+val renderTileDeepInto(uintptr_t buffer, int x_start, int y_start, int tile_width,
+                       int tile_height, std::string center_x, std::string center_y,
+                       double scale, int width, int height, int max_iter, int palette_id) {
+    uint8_t* pixels = reinterpret_cast<uint8_t*>(buffer);
+    size_t size = static_cast<size_t>(tile_width) * tile_height * 4;
+    if (pixel_pool.capacity(pixels) < size) {
+        return val::null();
+    }
+
+    DeepViewport viewport(center_x, center_y, scale, width, height);
+    RenderParams params = makeParams(max_iter, palette_id);
+
+    // Perturbation records no orbits to keep
+    engine.renderTileDeep(x_start, y_start, tile_width, tile_height,
+                         viewport, params, pixels, tile_width * 4,
+                         retainedField(deepRetainedView(center_x, center_y, scale, width,
+                                                        height),
+                                       x_start, y_start, tile_width, tile_height, false));
+
+    return val(typed_memory_view(size, pixels));
+}
+
+// renderTileInto served from the world-aligned tile cache. Returns null when
+// the view is too deep for the cache, so the caller can fall back to
+// renderTileInto/renderTileDeepInto.
+val renderTileCachedInto(uintptr_t buffer, int x_start, int y_start, int tile_width,
+                         int tile_height, double center_x, double center_y, double scale,
+                         int width, int height, int max_iter, int fractal_type,
+                         double julia_c_re, double julia_c_im, int palette_id) {
+    uint8_t* pixels = reinterpret_cast<uint8_t*>(buffer);
+    size_t size = static_cast<size_t>(tile_width) * tile_height * 4;
+    if (pixel_pool.capacity(pixels) < size) {
+        return val::null();
+    }
+
+    Viewport viewport(center_x, center_y, scale, width, height);
+    RenderParams params = makeParams(max_iter, palette_id);
+
+    if (!tile_cache.renderTile(engine, x_start, y_start, tile_width, tile_height,
+                               viewport, params, static_cast<FractalType>(fractal_type),
+                               julia_c_re, julia_c_im, pixels, tile_width * 4)) {
+        return val::null();
+    }
+
+    return val(typed_memory_view(size, pixels));
+}
+
+void setTileCacheBudget(int megabytes) {
+    tile_cache.setMemoryBudget(static_cast<size_t>(megabytes) << 20);
+}
+
+val getTileCacheStats() {
+    auto stats = val::object();
+    stats.set("hits", static_cast<double>(tile_cache.hits()));
+    stats.set("merges", static_cast<double>(tile_cache.merges()));
+    stats.set("misses", static_cast<double>(tile_cache.misses()));
+    stats.set("tiles", static_cast<double>(tile_cache.tileCount()));
+    stats.set("bytes", static_cast<double>(tile_cache.memoryUsed()));
+    return stats;
+}
+
+// Periodicity check totals for this module's engine: points iterated, how
+// many the check decided, and their ratio
+val getPeriodicityStats() {
+    PeriodicityStats totals = engine.periodicityStats();
+    auto stats = val::object();
+    stats.set("points", static_cast<double>(totals.points));
+    stats.set("hits", static_cast<double>(totals.hits));
+    stats.set("hitRate", totals.points > 0
+                             ? static_cast<double>(totals.hits) / totals.points : 0.0);
+    return stats;
+}
+
+void resetPeriodicityStats() {
+    engine.resetPeriodicityStats();
+}
+
+static val statsToObject(const RenderStats& totals) {
+    auto stats = val::object();
+    stats.set("pixels", static_cast<double>(totals.pixels));
+    stats.set("points", static_cast<double>(totals.points));
+    stats.set("iterations", static_cast<double>(totals.iterations));
+    stats.set("bulbSkipped", static_cast<double>(totals.bulb_skipped));
+    stats.set("periodic", static_cast<double>(totals.periodic));
+    stats.set("escaped", static_cast<double>(totals.escaped));
+    stats.set("limitReached", static_cast<double>(totals.limit_reached));
+    stats.set("iterateMs", totals.iterate_ms);
+    stats.set("colorMs", totals.color_ms);
+    auto histogram = val::array();
+    for (int bin = 0; bin < RenderStats::kHistogramBins; bin++) {
+        histogram.set(bin, static_cast<double>(totals.escape_histogram[bin]));
+    }
+    stats.set("escapeHistogram", histogram);
+    return stats;
+}
+
+// Hot-path counters of the last render call (the tile just returned), or
+// null when the module was built without FRACTAL_PROFILE
+val getTileStats() {
+    return RenderStats::enabled() ? statsToObject(call_stats) : val::null();
+}
+
+// The same counters summed over every render call since the last reset
+val getRenderStats() {
+    return RenderStats::enabled() ? statsToObject(engine.renderStats()) : val::null();
+}
+
+void resetRenderStats() {
+    engine.resetRenderStats();
+}
+
+// Timeline of this module's render calls in Chrome trace-event format. Each
+// worker records under trace thread id worker_id + 1 (0 is the main thread);
+// timestamps are performance.now() microseconds of the worker.
+static TraceRecorder trace_recorder;
+
+void startTrace(int worker_id) {
+    TraceRecorder::setThreadID(worker_id + 1);
+    TraceRecorder::setThreadName("worker " + std::to_string(worker_id));
+    trace_recorder.start();
+}
+
+// Stop recording and return the events as a JSON array
+std::string stopTrace() {
+    trace_recorder.stop();
+    return trace_recorder.eventsJSON();
+}
+
+// Recolor a previously rendered tile from the retained iteration data, with
+// a new palette, offset (in palette cycles) and speed. The view is that of
+// the render, with deep_center_x/deep_center_y set (and the double center
+// and fractal ignored) for a renderTileDeepInto tile. Returns null if this
+// module holds no data for the tile in that view; max_iter must match the
+// render.
+val recolorTileInto(uintptr_t buffer, int x_start, int y_start, int tile_width,
+                    int tile_height, double center_x, double center_y,
+                    std::string deep_center_x, std::string deep_center_y, double scale,
+                    int width, int height, int max_iter, int fractal_type,
+                    double julia_c_re, double julia_c_im, int palette_id,
+                    double color_offset, double color_speed) {
+    uint8_t* pixels = reinterpret_cast<uint8_t*>(buffer);
+    size_t size = static_cast<size_t>(tile_width) * tile_height * 4;
+    RetainedView view = deep_center_x.empty()
+        ? retainedView(center_x, center_y, scale, width, height, fractal_type, julia_c_re,
+                       julia_c_im)
+        : deepRetainedView(deep_center_x, deep_center_y, scale, width, height);
+    const IterationField* field = view == retained_view
+        ? findRetained(x_start, y_start, tile_width, tile_height) : nullptr;
+    if (pixel_pool.capacity(pixels) < size || !field) {
+        return val::null();
+    }
+
+    RenderParams params = makeParams(max_iter, palette_id);
+    params.color_offset = color_offset;
+    params.color_speed = color_speed;
+
+    FractalEngine::recolorTile(*field, x_start, y_start, tile_width, tile_height,
+                               params, pixels, tile_width * 4);
+
+    return val(typed_memory_view(size, pixels));
+}
+
+// Raise the iteration limit of a tile this module rendered: only orbits
+// stopped by the old limit are iterated further, from their saved z when
+// the tile kept its orbits (setKeepOrbits) and from the start otherwise.
+// The view and fractal must match the original render and max_iter must
+// not be lower. Returns null if this module holds no data for the tile.
+val continueTileInto(uintptr_t buffer, int x_start, int y_start, int tile_width,
+                     int tile_height, double center_x, double center_y, double scale,
+                     int width, int height, int max_iter, int fractal_type,
+                     double julia_c_re, double julia_c_im, int palette_id) {
+    uint8_t* pixels = reinterpret_cast<uint8_t*>(buffer);
+    size_t size = static_cast<size_t>(tile_width) * tile_height * 4;
+    RetainedView view = retainedView(center_x, center_y, scale, width, height, fractal_type,
+                                     julia_c_re, julia_c_im);
+    IterationField* field = view == retained_view
+        ? findRetained(x_start, y_start, tile_width, tile_height) : nullptr;
+    if (pixel_pool.capacity(pixels) < size || !field) {
+        return val::null();
+    }
+
+    Viewport viewport(center_x, center_y, scale, width, height);
+    RenderParams params = makeParams(max_iter, palette_id);
+
+    if (keep_orbits) {
+        setFieldOrbits(*field, true);  // So that the next raise resumes them
+    }
+    engine.continueTile(x_start, y_start, tile_width, tile_height, viewport, params,
+                        static_cast<FractalType>(fractal_type), julia_c_re, julia_c_im,
+                        *field, pixels, tile_width * 4);
+
+    return val(typed_memory_view(size, pixels));
+}
+
+// One progressive pass over a tile (see getPassParams): computes the samples
+// new to this pass's grid into the tile's retained field, continues the
+// earlier passes' samples to max_iter and returns the tile with each sample
+// filling its block. Passes of a frame must run in order on the same
+// module. Orbits are kept between passes and dropped after the last one
+// (sample_step 1) unless setKeepOrbits asked for them.
+val renderPassInto(uintptr_t buffer, int x_start, int y_start, int tile_width,
+                   int tile_height, double center_x, double center_y, double scale,
+                   int width, int height, int max_iter, int fractal_type,
+                   double julia_c_re, double julia_c_im, int palette_id,
+                   int sample_step, int previous_sample_step) {
+    uint8_t* pixels = reinterpret_cast<uint8_t*>(buffer);
+    size_t size = static_cast<size_t>(tile_width) * tile_height * 4;
+    if (pixel_pool.capacity(pixels) < size || sample_step < 1) {
+        return val::null();
+    }
+    RetainedView view = retainedView(center_x, center_y, scale, width, height, fractal_type,
+                                     julia_c_re, julia_c_im);
+    IterationField* field;
+    if (previous_sample_step > 0) {
+        field = view == retained_view
+            ? findRetained(x_start, y_start, tile_width, tile_height) : nullptr;
+    } else {
+        field = retainedField(view, x_start, y_start, tile_width, tile_height, true);
+    }
+    if (!field) {
+        return val::null();
+    }
+
+    Viewport viewport(center_x, center_y, scale, width, height);
+    RenderParams params = makeParams(max_iter, palette_id);
+
+    last_extra_samples = engine.renderTileProgressive(
+        x_start, y_start, tile_width, tile_height, viewport, params,
+        static_cast<FractalType>(fractal_type), julia_c_re, julia_c_im, sample_step,
+        previous_sample_step, *field, pixels, tile_width * 4);
+    if (sample_step == 1) {
+        setFieldOrbits(*field, keep_orbits);
+    }
+
+    return val(typed_memory_view(size, pixels));
+}
 
-    // Render tile
-    std::vector<uint8_t> pixel_buffer;
-    engine.renderTile(x_start, y_start, tile_width, tile_height,
-                     viewport, params,
-                     static_cast<FractalType>(fractal_type),
-                     julia_c_re, julia_c_im,
-                     pixel_buffer);
+// Render a tile and return pixel data. The view points into a module-owned
+// buffer and is only valid until the next renderTile/renderTileDeep call.
+val renderTile(int x_start, int y_start, int tile_width, int tile_height,
+              double center_x, double center_y, double scale, int width, int height,
+              int max_iter, int fractal_type, double julia_c_re, double julia_c_im,
+              int palette_id) {
+    size_t size = static_cast<size_t>(tile_width) * tile_height * 4;
+    return renderTileInto(reinterpret_cast<uintptr_t>(resultBuffer(size)),
+                          x_start, y_start, tile_width, tile_height,
+                          center_x, center_y, scale, width, height,
+                          max_iter, fractal_type, julia_c_re, julia_c_im, palette_id);
+}
 
-    // Return as Uint8Array
-    return val(typed_memory_view(pixel_buffer.size(), pixel_buffer.data()));
+// Deep-zoom variant of renderTile, with the same view lifetime
+val renderTileDeep(int x_start, int y_start, int tile_width, int tile_height,
+                  std::string center_x, std::string center_y, double scale,
+                  int width, int height, int max_iter, int palette_id) {
+    size_t size = static_cast<size_t>(tile_width) * tile_height * 4;
+    return renderTileDeepInto(reinterpret_cast<uintptr_t>(resultBuffer(size)),
+                              x_start, y_start, tile_width, tile_height,
+                              center_x, center_y, scale, width, height,
+                              max_iter, palette_id);
 }
 
 // Convert screen coordinates to complex coordinates
@@ -54,10 +565,128 @@ val screenToComplex(int screen_x, int screen_y,
     return result;
 }
 
-// Get adaptive iteration count for a render pass
-int getAdaptiveIterations(int pass, int base_iterations) {
-    return ProgressiveRenderer::getAdaptiveIterations(
+// Sample grid and iteration limit of a progressive pass
+val getPassParams(int pass, int base_iterations) {
+    ProgressiveRenderParams pass_params = ProgressiveRenderer::getPassParams(
         static_cast<RenderPass>(pass), base_iterations);
+    auto result = val::object();
+    result.set("sampleStep", pass_params.sample_step);
+    result.set("previousSampleStep", pass_params.previous_sample_step);
+    result.set("resolutionScale", pass_params.resolution_scale);
+    result.set("maxIterations", pass_params.max_iterations);
+    return result;
+}
+
+static val estimateToObject(const IterationEstimate& estimate) {
+    auto result = val::object();
+    result.set("maxIterations", estimate.max_iterations);
+    result.set("probeIterations", estimate.probe_iterations);
+    result.set("samples", estimate.samples);
+    result.set("escaped", estimate.escaped);
+    result.set("interior", estimate.interior);
+    result.set("unresolved", estimate.unresolved);
+    result.set("medianEscape", estimate.median_escape);
+    result.set("p90Escape", estimate.p90_escape);
+    result.set("p99Escape", estimate.p99_escape);
+    result.set("resolvedFraction", estimate.resolved_fraction);
+    return result;
+}
+
+// Pick max_iterations for a view from a preview grid's escape statistics.
+// With tile_size > 0 the result also lists a limit per tile_size tile.
+val autoIterations(double center_x, double center_y, double scale, int width, int height,
+                   int fractal_type, double julia_c_real, double julia_c_imag,
+                   double target_resolved, int tile_size) {
+    Viewport viewport(center_x, center_y, scale, width, height);
+    FractalType type = static_cast<FractalType>(fractal_type);
+    AutoIterationParams auto_params;
+    if (target_resolved > 0.0) {
+        auto_params.target_resolved = target_resolved;
+    }
+
+    val result = estimateToObject(ProgressiveRenderer::estimateIterations(
+        engine, 0, 0, width, height, viewport, type, julia_c_real, julia_c_imag, auto_params));
+
+    if (tile_size > 0) {
+        auto js_tiles = val::array();
+        int index = 0;
+        for (int y = 0; y < height; y += tile_size) {
+            for (int x = 0; x < width; x += tile_size) {
+                int w = std::min(tile_size, width - x);
+                int h = std::min(tile_size, height - y);
+                val tile = estimateToObject(ProgressiveRenderer::estimateIterations(
+                    engine, x, y, w, h, viewport, type, julia_c_real, julia_c_imag,
+                    auto_params));
+                tile.set("x", x);
+                tile.set("y", y);
+                tile.set("width", w);
+                tile.set("height", h);
+                js_tiles.set(index++, tile);
+            }
+        }
+        result.set("tiles", js_tiles);
+    }
+    return result;
+}
+
+// Rectangles a (dx, dy) whole-pixel pan exposes on a width x height canvas
+val getExposedRects(int width, int height, int dx, int dy) {
+    auto rects = PanRenderer::exposedRects(width, height, dx, dy);
+
+    auto js_rects = val::array();
+    for (size_t i = 0; i < rects.size(); i++) {
+        auto rect_obj = val::object();
+        rect_obj.set("x", rects[i].x);
+        rect_obj.set("y", rects[i].y);
+        rect_obj.set("width", rects[i].width);
+        rect_obj.set("height", rects[i].height);
+        js_rects.set(i, rect_obj);
+    }
+
+    return js_rects;
+}
+
+// Session for a module that owns a whole view: sessionNext pulls its tiles
+// in priority order, and sessionUpdate/sessionFocus between calls drop or
+// re-prioritize the work still pending
+static RenderSession session(engine);
+static SessionTile session_tile;
+static std::shared_ptr<const ColorPalette> session_palette;  // Kept alive for the view
+
+void sessionUpdate(double center_x, double center_y, double scale, int width, int height,
+                   int max_iter, int fractal_type, double julia_c_re, double julia_c_im,
+                   int palette_id, int first_pass) {
+    Viewport viewport(center_x, center_y, scale, width, height);
+    session_palette = palette_id == kCustomPalette ? custom_palette : nullptr;
+    session.update(viewport, makeParams(max_iter, palette_id),
+                   static_cast<FractalType>(fractal_type), julia_c_re, julia_c_im,
+                   static_cast<RenderPass>(first_pass));
+}
+
+void sessionFocus(double x, double y) {
+    session.setFocus(x, y);
+}
+
+void sessionCancel() {
+    session.cancel();
+}
+
+// The next finished pass of a tile, or null when the view is done. The
+// pixels view is only valid until the next sessionNext call.
+val sessionNext() {
+    if (!session.next(session_tile)) {
+        return val::null();
+    }
+    auto result = val::object();
+    result.set("x", session_tile.tile.x);
+    result.set("y", session_tile.tile.y);
+    result.set("width", session_tile.tile.width);
+    result.set("height", session_tile.tile.height);
+    result.set("pass", static_cast<int>(session_tile.pass));
+    result.set("frame", static_cast<double>(session_tile.frame));
+    result.set("pixels", val(typed_memory_view(session_tile.pixels.size(),
+                                               session_tile.pixels.data())));
+    return result;
 }
 
 // Generate tiles for a viewport
@@ -80,14 +709,50 @@ val generateTiles(int width, int height, int tile_size) {
 
 EMSCRIPTEN_BINDINGS(fractal_module) {
     function("renderTile", &renderTile);
+    function("renderTileDeep", &renderTileDeep);
+    function("renderTileInto", &renderTileInto);
+    function("renderTileDeepInto", &renderTileDeepInto);
+    function("recolorTileInto", &recolorTileInto);
+    function("continueTileInto", &continueTileInto);
+    function("renderPassInto", &renderPassInto);
+    function("setKeepOrbits", &setKeepOrbits);
+    function("renderTileCachedInto", &renderTileCachedInto);
+    function("setTileCacheBudget", &setTileCacheBudget);
+    function("getTileCacheStats", &getTileCacheStats);
+    function("acquireTileBuffer", &acquireTileBuffer);
+    function("releaseTileBuffer", &releaseTileBuffer);
     function("screenToComplex", &screenToComplex);
-    function("getAdaptiveIterations", &getAdaptiveIterations);
+    function("getPassParams", &getPassParams);
+    function("autoIterations", &autoIterations);
     function("generateTiles", &generateTiles);
+    function("sessionUpdate", &sessionUpdate);
+    function("sessionFocus", &sessionFocus);
+    function("sessionCancel", &sessionCancel);
+    function("sessionNext", &sessionNext);
+    function("getExposedRects", &getExposedRects);
+    function("setSubdivision", &setSubdivision);
+    function("setAntialiasing", &setAntialiasing);
+    function("lastExtraSamples", &lastExtraSamples);
+    function("setColorHistogram", &setColorHistogram);
+    function("clearColorHistogram", &clearColorHistogram);
+    function("setCustomPalette", &setCustomPalette);
+    function("tileHistogram", &tileHistogram);
+    function("getPeriodicityStats", &getPeriodicityStats);
+    function("resetPeriodicityStats", &resetPeriodicityStats);
+    function("getTileStats", &getTileStats);
+    function("getRenderStats", &getRenderStats);
+    function("resetRenderStats", &resetRenderStats);
+    function("startTrace", &startTrace);
+    function("stopTrace", &stopTrace);
 
     // Export enums
     enum_<FractalType>("FractalType")
         .value("MANDELBROT", MANDELBROT)
-        .value("JULIA", JULIA);
+        .value("JULIA", JULIA)
+        .value("BURNING_SHIP", BURNING_SHIP)
+        .value("TRICORN", TRICORN)
+        .value("MULTIBROT_3", MULTIBROT_3)
+        .value("MULTIBROT_4", MULTIBROT_4);
 
     enum_<RenderPass>("RenderPass")
         .value("PASS_PREVIEW", PASS_PREVIEW)
@@ -0,0 +1,226 @@
+#include "big_fixed.h"
+#include <algorithm>
+#include <cmath>
+
+namespace fractal {
+
+BigFixed::BigFixed(int frac_limbs)
+    : limbs_(frac_limbs + 1, 0), frac_limbs_(frac_limbs), negative_(false) {
+}
+
+BigFixed::BigFixed(double value, int frac_limbs)
+    : limbs_(frac_limbs + 1, 0), frac_limbs_(frac_limbs), negative_(value < 0.0) {
+    double mag = std::fabs(value);
+
+    // Integer part, then peel off 32 fractional bits at a time (all exact)
+    double int_part = std::floor(mag);
+    limbs_[frac_limbs_] = static_cast<uint32_t>(int_part);
+    double frac = mag - int_part;
+    for (int i = frac_limbs_ - 1; i >= 0 && frac > 0.0; i--) {
+        frac = std::ldexp(frac, 32);
+        double limb = std::floor(frac);
+        limbs_[i] = static_cast<uint32_t>(limb);
+        frac -= limb;
+    }
+
+    if (isZero()) {
+        negative_ = false;
+    }
+}
+
+bool BigFixed::fromString(const std::string& text, int frac_limbs, BigFixed& out) {
+    out = BigFixed(frac_limbs);
+
+    size_t pos = 0;
+    bool negative = false;
+    if (pos < text.size() && (text[pos] == '-' || text[pos] == '+')) {
+        negative = (text[pos] == '-');
+        pos++;
+    }
+
+    // Collect mantissa digits and where the decimal point falls
+    std::string digits;
+    long point = -1;
+    for (; pos < text.size(); pos++) {
+        char ch = text[pos];
+        if (ch >= '0' && ch <= '9') {
+            digits.push_back(ch);
+        } else if (ch == '.' && point < 0) {
+            point = static_cast<long>(digits.size());
+        } else {
+            break;
+        }
+    }
+    if (digits.empty()) {
+        return false;
+    }
+    if (point < 0) {
+        point = static_cast<long>(digits.size());
+    }
+
+    // Optional exponent
+    if (pos < text.size() && (text[pos] == 'e' || text[pos] == 'E')) {
+        pos++;
+        size_t used = 0;
+        long exponent;
+        try {
+            exponent = std::stol(text.substr(pos), &used);
+        } catch (...) {
+            return false;
+        }
+        if (used == 0) {
+            return false;
+        }
+        point += exponent;
+        pos += used;
+    }
+    if (pos != text.size()) {
+        return false;
+    }
+
+    // Integer digits (bounded by the single integer limb)
+    uint64_t int_value = 0;
+    for (long i = 0; i < point; i++) {
+        uint32_t digit = (i < static_cast<long>(digits.size())) ? digits[i] - '0' : 0;
+        int_value = int_value * 10 + digit;
+        if (int_value >= (1ull << 31)) {
+            return false;
+        }
+    }
+
+    // Fractional digits, least significant first: v = (v + d) / 10. Digits far
+    // below the precision of the result cannot change it, so skip them.
+    long first_frac = std::max(0L, point);
+    long max_digits = static_cast<long>(frac_limbs) * 10 + 2;
+    long last_frac = std::min(static_cast<long>(digits.size()), point + max_digits);
+    for (long i = last_frac - 1; i >= first_frac; i--) {
+        out.addDigitAndDivideBy10(digits[i] - '0');
+    }
+    // Leading zeros between the point and the first mantissa digit
+    for (long i = std::min(0L, point); i < 0 && i > -max_digits; i++) {
+        out.addDigitAndDivideBy10(0);
+    }
+
+    out.limbs_[frac_limbs] = static_cast<uint32_t>(int_value);
+    out.negative_ = negative && !out.isZero();
+    return true;
+}
+
+int BigFixed::limbsForScale(double scale) {
+    // Resolve a pixel plus 64 guard bits for the orbit's error growth
+    double bits = std::max(0.0, -std::log2(scale)) + 64.0;
+    return std::max(2, static_cast<int>(std::ceil(bits / 32.0)) + 1);
+}
+
+double BigFixed::toDouble() const {
+    double value = 0.0;
+    for (int i = 0; i <= frac_limbs_; i++) {
+        value += std::ldexp(static_cast<double>(limbs_[i]), 32 * (i - frac_limbs_));
+    }
+    return negative_ ? -value : value;
+}
+
+BigFixed BigFixed::operator+(const BigFixed& other) const {
+    BigFixed result(frac_limbs_);
+    if (negative_ == other.negative_) {
+        addMagnitude(*this, other, result);
+        result.negative_ = negative_;
+    } else if (compareMagnitude(other) >= 0) {
+        subMagnitude(*this, other, result);
+        result.negative_ = negative_;
+    } else {
+        subMagnitude(other, *this, result);
+        result.negative_ = other.negative_;
+    }
+    if (result.isZero()) {
+        result.negative_ = false;
+    }
+    return result;
+}
+
+BigFixed BigFixed::operator-(const BigFixed& other) const {
+    return *this + (-other);
+}
+
+BigFixed BigFixed::operator-() const {
+    BigFixed result = *this;
+    result.negative_ = !negative_ && !isZero();
+    return result;
+}
+
+BigFixed BigFixed::operator*(const BigFixed& other) const {
+    const int n = frac_limbs_ + 1;
+    std::vector<uint32_t> product(2 * n, 0);
+
+    // Schoolbook multiply of the full magnitudes
+    for (int i = 0; i < n; i++) {
+        uint64_t carry = 0;
+        uint64_t a = limbs_[i];
+        if (a == 0) {
+            continue;
+        }
+        for (int j = 0; j < n; j++) {
+            uint64_t t = a * other.limbs_[j] + product[i + j] + carry;
+            product[i + j] = static_cast<uint32_t>(t);
+            carry = t >> 32;
+        }
+        product[i + n] = static_cast<uint32_t>(carry);
+    }
+
+    // Drop the extra fractional limbs (truncation)
+    BigFixed result(frac_limbs_);
+    for (int i = 0; i < n; i++) {
+        result.limbs_[i] = product[i + frac_limbs_];
+    }
+    result.negative_ = (negative_ != other.negative_) && !result.isZero();
+    return result;
+}
+
+bool BigFixed::isZero() const {
+    for (uint32_t limb : limbs_) {
+        if (limb != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+int BigFixed::compareMagnitude(const BigFixed& other) const {
+    for (int i = frac_limbs_; i >= 0; i--) {
+        if (limbs_[i] != other.limbs_[i]) {
+            return limbs_[i] < other.limbs_[i] ? -1 : 1;
+        }
+    }
+    return 0;
+}
+
+void BigFixed::addMagnitude(const BigFixed& a, const BigFixed& b, BigFixed& out) {
+    uint64_t carry = 0;
+    for (int i = 0; i <= a.frac_limbs_; i++) {
+        uint64_t t = static_cast<uint64_t>(a.limbs_[i]) + b.limbs_[i] + carry;
+        out.limbs_[i] = static_cast<uint32_t>(t);
+        carry = t >> 32;
+    }
+}
+
+void BigFixed::subMagnitude(const BigFixed& a, const BigFixed& b, BigFixed& out) {
+    // Requires |a| >= |b|
+    int64_t borrow = 0;
+    for (int i = 0; i <= a.frac_limbs_; i++) {
+        int64_t t = static_cast<int64_t>(a.limbs_[i]) - b.limbs_[i] - borrow;
+        borrow = t < 0 ? 1 : 0;
+        out.limbs_[i] = static_cast<uint32_t>(t + (borrow << 32));
+    }
+}
+
+void BigFixed::addDigitAndDivideBy10(uint32_t digit) {
+    limbs_[frac_limbs_] += digit;
+    uint64_t remainder = 0;
+    for (int i = frac_limbs_; i >= 0; i--) {
+        uint64_t cur = (remainder << 32) | limbs_[i];
+        limbs_[i] = static_cast<uint32_t>(cur / 10);
+        remainder = cur % 10;
+    }
+}
+
+} // namespace fractal
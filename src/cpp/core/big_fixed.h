@@ -0,0 +1,52 @@
+#ifndef BIG_FIXED_H
+#define BIG_FIXED_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace fractal {
+
+// Signed fixed-point number with one 32-bit integer limb and a configurable
+// number of 32-bit fractional limbs. Used only for the perturbation reference
+// orbit, so it supports just what z = z^2 + c needs: add, subtract, multiply
+// and conversion to/from double and decimal strings. Values must stay below
+// 2^31 in magnitude, which holds for any orbit point inside the bailout.
+class BigFixed {
+public:
+    explicit BigFixed(int frac_limbs = 2);
+    BigFixed(double value, int frac_limbs);
+
+    // Parse a decimal string such as "-0.7436438870371587047521915" or
+    // "1.25e-40". Returns false (and leaves the value at zero) on bad input.
+    static bool fromString(const std::string& text, int frac_limbs, BigFixed& out);
+
+    // Number of fractional limbs needed to resolve `scale` with headroom
+    static int limbsForScale(double scale);
+
+    double toDouble() const;
+    int fracLimbs() const { return frac_limbs_; }
+
+    BigFixed operator+(const BigFixed& other) const;
+    BigFixed operator-(const BigFixed& other) const;
+    BigFixed operator*(const BigFixed& other) const;
+    BigFixed operator-() const;
+
+private:
+    // Little-endian magnitude: limbs_[frac_limbs_] is the integer part
+    std::vector<uint32_t> limbs_;
+    int frac_limbs_;
+    bool negative_;
+
+    bool isZero() const;
+    int compareMagnitude(const BigFixed& other) const;
+    static void addMagnitude(const BigFixed& a, const BigFixed& b, BigFixed& out);
+    static void subMagnitude(const BigFixed& a, const BigFixed& b, BigFixed& out);
+
+    // this = (this + digit) / 10, used when parsing fractional digits
+    void addDigitAndDivideBy10(uint32_t digit);
+};
+
+} // namespace fractal
+
+#endif // BIG_FIXED_H
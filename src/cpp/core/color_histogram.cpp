@@ -0,0 +1,71 @@
+#include "color_histogram.h"
+
+namespace fractal {
+
+ColorHistogram::ColorHistogram(int max_iterations) {
+    reset(max_iterations);
+}
+
+void ColorHistogram::reset(int max_iterations) {
+    max_iterations_ = std::max(1, max_iterations);
+    counts_.assign(std::min(max_iterations_, kMaxBins), 0);
+    bin_scale_ = static_cast<double>(counts_.size()) / max_iterations_;
+    total_ = 0;
+    cdf_.clear();
+}
+
+void ColorHistogram::addField(const IterationField& field, int x, int y, int w, int h,
+                              int step) {
+    step = std::max(1, step);
+    int x_first = (x + step - 1) / step * step;
+    int y_first = (y + step - 1) / step * step;
+    int last_bin = bins() - 1;
+
+    for (int row = y_first; row < y + h; row += step) {
+        size_t base = field.indexOf(0, row);
+        for (int column = x_first; column < x + w; column += step) {
+            size_t index = base + column - field.origin_x;
+            if (field.inside_set[index]) {
+                continue;
+            }
+            int bin = static_cast<int>(field.smooth_values[index] * bin_scale_);
+            counts_[std::min(std::max(bin, 0), last_bin)]++;
+            total_++;
+        }
+    }
+}
+
+void ColorHistogram::merge(const ColorHistogram& other) {
+    if (other.bins() != bins()) {
+        return;
+    }
+    for (int i = 0; i < bins(); i++) {
+        counts_[i] += other.counts_[i];
+    }
+    total_ += other.total_;
+}
+
+void ColorHistogram::setCounts(const std::vector<uint32_t>& counts) {
+    cdf_.clear();
+    total_ = 0;
+    for (int i = 0; i < bins(); i++) {
+        counts_[i] = i < static_cast<int>(counts.size()) ? counts[i] : 0;
+        total_ += counts_[i];
+    }
+}
+
+void ColorHistogram::finalize() {
+    cdf_.assign(bins() + 1, 0.0f);
+    if (total_ == 0) {
+        cdf_.clear();
+        return;
+    }
+
+    uint64_t running = 0;
+    for (int i = 0; i < bins(); i++) {
+        running += counts_[i];
+        cdf_[i + 1] = static_cast<float>(static_cast<double>(running) / total_);
+    }
+}
+
+} // namespace fractal
@@ -0,0 +1,66 @@
+#ifndef COLOR_HISTOGRAM_H
+#define COLOR_HISTOGRAM_H
+
+#include "fractal_engine.h"
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+namespace fractal {
+
+// Histogram of the smooth values of escaped pixels over [0, max_iterations),
+// for histogram-equalized coloring. Each tile or thread fills its own
+// histogram from retained IterationField data and merge() adds them up, so
+// no shared state is touched while counting. finalize() turns the counts
+// into a CDF; equalize() then maps a smooth value to its rank in [0, 1],
+// spreading the palette evenly over the pixels instead of the iterations.
+class ColorHistogram {
+public:
+    // Bins are whole iterations up to this many, then wider
+    static constexpr int kMaxBins = 4096;
+
+    explicit ColorHistogram(int max_iterations = 1000);
+
+    // Clear the counts and set the iteration range
+    void reset(int max_iterations);
+
+    // Count the escaped pixels of frame rectangle (x, y, w, h). With step > 1
+    // only pixels on that frame-aligned grid are counted (a progressive pass).
+    void addField(const IterationField& field, int x, int y, int w, int h, int step = 1);
+
+    // Add another histogram over the same iteration range
+    void merge(const ColorHistogram& other);
+
+    // Build the CDF from the counts. Until then equalize() is the identity.
+    void finalize();
+
+    double equalize(double smooth_value) const {
+        if (cdf_.empty()) {
+            return smooth_value / max_iterations_;
+        }
+        double position = std::min(std::max(smooth_value * bin_scale_, 0.0),
+                                   static_cast<double>(bins()));
+        int bin = std::min(static_cast<int>(position), bins() - 1);
+        double fraction = position - bin;
+        return cdf_[bin] + fraction * (cdf_[bin + 1] - cdf_[bin]);
+    }
+
+    int maxIterations() const { return max_iterations_; }
+    int bins() const { return static_cast<int>(counts_.size()); }
+    uint64_t total() const { return total_; }
+
+    // Raw counts, for moving histograms between workers
+    const std::vector<uint32_t>& counts() const { return counts_; }
+    void setCounts(const std::vector<uint32_t>& counts);
+
+private:
+    int max_iterations_;
+    double bin_scale_;  // Bins per iteration
+    uint64_t total_;
+    std::vector<uint32_t> counts_;
+    std::vector<float> cdf_;  // bins() + 1 entries once finalized
+};
+
+} // namespace fractal
+
+#endif // COLOR_HISTOGRAM_H
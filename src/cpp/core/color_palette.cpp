@@ -1,10 +1,70 @@
 #include "color_palette.h"
 #include <algorithm>
+#include <array>
+#include <mutex>
+#include <unordered_map>
 
 namespace fractal {
 
 ColorPalette::ColorPalette() {
     generateClassicPalette();
+    buildLut();
+}
+
+const ColorPalette& ColorPalette::builtin(int palette_id) {
+    // Built once on first use; function-local static init is thread-safe
+    static const std::array<ColorPalette, 5> palettes = [] {
+        std::array<ColorPalette, 5> result;
+        for (int i = 0; i < 5; i++) {
+            result[i].initPalette(i);
+        }
+        return result;
+    }();
+
+    if (palette_id < 0 || palette_id >= static_cast<int>(palettes.size())) {
+        palette_id = 0;  // Same fallback as initPalette
+    }
+    return palettes[palette_id];
+}
+
+std::shared_ptr<const ColorPalette> ColorPalette::custom(const std::vector<Color>& colors) {
+    // Entries keep their colors: a hash match is only a candidate
+    struct Entry {
+        std::vector<Color> colors;
+        std::shared_ptr<const ColorPalette> palette;
+    };
+    static std::mutex mutex;
+    static std::unordered_map<uint64_t, Entry> cache;
+    const size_t kMaxCached = 64;
+
+    // FNV-1a over the RGBA bytes
+    uint64_t hash = 1469598103934665603ull;
+    for (const Color& color : colors) {
+        for (uint8_t byte : {color.r, color.g, color.b, color.a}) {
+            hash = (hash ^ byte) * 1099511628211ull;
+        }
+    }
+    auto same = [&](const std::vector<Color>& other) {
+        return std::equal(colors.begin(), colors.end(), other.begin(), other.end(),
+                          [](const Color& a, const Color& b) {
+                              return a.r == b.r && a.g == b.g && a.b == b.b && a.a == b.a;
+                          });
+    };
+
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = cache.find(hash);
+    if (it != cache.end() && same(it->second.colors)) {
+        return it->second.palette;
+    }
+
+    if (cache.size() >= kMaxCached) {
+        cache.clear();  // Holders keep their shared_ptr alive
+    }
+
+    auto palette = std::make_shared<ColorPalette>();
+    palette->setCustomColors(colors);
+    cache[hash] = Entry{colors, palette};  // A colliding list takes the slot
+    return palette;
 }
 
 void ColorPalette::initPalette(int palette_id) {
@@ -28,6 +88,7 @@ void ColorPalette::initPalette(int palette_id) {
             generateClassicPalette();
             break;
     }
+    buildLut();
 }
 
 Color ColorPalette::getColor(double smooth_value, int max_iterations) const {
@@ -52,6 +113,20 @@ Color ColorPalette::getColor(double smooth_value, int max_iterations) const {
 void ColorPalette::setCustomColors(const std::vector<Color>& colors) {
     if (!colors.empty()) {
         palette_ = colors;
+        buildLut();
+    }
+}
+
+void ColorPalette::buildLut() {
+    // Entry k is getColor() at palette position k * size / kLutSize
+    lut_.resize(kLutSize);
+    double size = static_cast<double>(palette_.size());
+    for (int k = 0; k < kLutSize; k++) {
+        double palette_index = k * size / kLutSize;
+        int index1 = static_cast<int>(palette_index) % palette_.size();
+        int index2 = (index1 + 1) % palette_.size();
+        double t = palette_index - std::floor(palette_index);
+        lut_[k] = interpolateColors(palette_[index1], palette_[index2], t);
     }
 }
 
@@ -2,6 +2,9 @@
 #define COLOR_PALETTE_H
 
 #include "fractal_engine.h"
+#include "color_histogram.h"
+#include <cstdint>
+#include <memory>
 #include <vector>
 #include <cmath>
 
@@ -9,9 +12,24 @@ namespace fractal {
 
 class ColorPalette {
 public:
+    // Entries in the precomputed lookup table covering one palette cycle
+    static constexpr int kLutSize = 4096;
+
     ColorPalette();
     ~ColorPalette() = default;
 
+    // Shared, build-once instance of a built-in palette (thread-safe)
+    static const ColorPalette& builtin(int palette_id);
+
+    // Shared instance for a custom color list, cached by content. Pass it
+    // to a render as RenderParams::palette.
+    static std::shared_ptr<const ColorPalette> custom(const std::vector<Color>& colors);
+
+    // The palette a render uses: params.palette, else the built-in one
+    static const ColorPalette& forParams(const RenderParams& params) {
+        return params.palette ? *params.palette : builtin(params.palette_id);
+    }
+
     // Initialize a palette by ID
     void initPalette(int palette_id);
 
@@ -21,8 +39,52 @@ public:
     // Set custom palette colors
     void setCustomColors(const std::vector<Color>& colors);
 
+    // The colors the lookup table is built from
+    const std::vector<Color>& colors() const { return palette_; }
+
+    // Table lookup equivalent of getColor(), extended with params'
+    // color_offset and color_speed. Compute lutScale/lutOffset once per tile;
+    // the smooth value then becomes a fixed-point table index, so colors
+    // match getColor() to within 1/16 of a 256-entry palette step.
+    static double lutScale(const RenderParams& params) {
+        return kLutSize * params.color_speed / colorIterations(params);
+    }
+
+    static int colorIterations(const RenderParams& params) {
+        return params.color_iterations > 0 ? params.color_iterations : params.max_iterations;
+    }
+
+    // Smooth value as the palette sees it: unchanged, or with
+    // params.color_histogram its rank in the histogram scaled back to the
+    // iteration range, so lookup() spreads the palette over the pixels
+    static double colorValue(const RenderParams& params, double smooth_value) {
+        if (!params.color_histogram) {
+            return smooth_value;
+        }
+        return params.color_histogram->equalize(smooth_value) * colorIterations(params);
+    }
+
+    static double lutOffset(const RenderParams& params) {
+        return kLutSize * params.color_offset;
+    }
+
+    Color lookup(double smooth_value, bool inside_set, double lut_scale,
+                 double lut_offset) const {
+        // Inside the set -> black
+        if (inside_set) {
+            return Color(0, 0, 0, 255);
+        }
+        // Wrap through a signed integer so negative values stay in range
+        int64_t index = static_cast<int64_t>(smooth_value * lut_scale + lut_offset);
+        return lut_[static_cast<uint32_t>(index) & (kLutSize - 1)];
+    }
+
 private:
     std::vector<Color> palette_;
+    std::vector<Color> lut_;
+
+    // Rebuild lut_ from palette_
+    void buildLut();
 
     // Built-in palette generators
     void generateClassicPalette();
@@ -0,0 +1,77 @@
+#ifndef DOUBLE_DOUBLE_H
+#define DOUBLE_DOUBLE_H
+
+namespace fractal {
+
+// Unevaluated sum hi + lo of two doubles with |lo| <= ulp(hi) / 2, giving
+// about 106 bits of mantissa. Products use Dekker's split rather than fma,
+// which WebAssembly only provides as a slow library call.
+//
+// Relies on strict IEEE evaluation order: do not build with -ffast-math.
+struct DoubleDouble {
+    double hi;
+    double lo;
+
+    DoubleDouble() : hi(0.0), lo(0.0) {}
+    DoubleDouble(double h) : hi(h), lo(0.0) {}
+    DoubleDouble(double h, double l) : hi(h), lo(l) {}
+
+    // Exact a + b as a normalized pair (Knuth's two-sum)
+    static DoubleDouble twoSum(double a, double b) {
+        double s = a + b;
+        double bb = s - a;
+        double err = (a - (s - bb)) + (b - bb);
+        return DoubleDouble(s, err);
+    }
+
+    // Exact a * b as a normalized pair (Dekker's two-product)
+    static DoubleDouble twoProd(double a, double b) {
+        const double kSplit = 134217729.0;  // 2^27 + 1
+        double p = a * b;
+        double ta = kSplit * a;
+        double a_hi = ta - (ta - a);
+        double a_lo = a - a_hi;
+        double tb = kSplit * b;
+        double b_hi = tb - (tb - b);
+        double b_lo = b - b_hi;
+        double err = ((a_hi * b_hi - p) + a_hi * b_lo + a_lo * b_hi) + a_lo * b_lo;
+        return DoubleDouble(p, err);
+    }
+
+    static DoubleDouble quickTwoSum(double a, double b) {
+        double s = a + b;
+        return DoubleDouble(s, b - (s - a));
+    }
+};
+
+inline DoubleDouble operator+(const DoubleDouble& a, const DoubleDouble& b) {
+    DoubleDouble s = DoubleDouble::twoSum(a.hi, b.hi);
+    DoubleDouble t = DoubleDouble::twoSum(a.lo, b.lo);
+    s.lo += t.hi;
+    s = DoubleDouble::quickTwoSum(s.hi, s.lo);
+    s.lo += t.lo;
+    return DoubleDouble::quickTwoSum(s.hi, s.lo);
+}
+
+inline DoubleDouble operator-(const DoubleDouble& a) {
+    return DoubleDouble(-a.hi, -a.lo);
+}
+
+inline DoubleDouble operator-(const DoubleDouble& a, const DoubleDouble& b) {
+    return a + (-b);
+}
+
+inline DoubleDouble operator*(const DoubleDouble& a, const DoubleDouble& b) {
+    DoubleDouble p = DoubleDouble::twoProd(a.hi, b.hi);
+    p.lo += a.hi * b.lo + a.lo * b.hi;
+    return DoubleDouble::quickTwoSum(p.hi, p.lo);
+}
+
+// Multiplying by a power of two is exact
+inline DoubleDouble times2(const DoubleDouble& a) {
+    return DoubleDouble(a.hi * 2.0, a.lo * 2.0);
+}
+
+} // namespace fractal
+
+#endif // DOUBLE_DOUBLE_H
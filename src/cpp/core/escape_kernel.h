@@ -0,0 +1,503 @@
+#ifndef ESCAPE_KERNEL_H
+#define ESCAPE_KERNEL_H
+
+#include "fractal_engine.h"
+#include "double_double.h"
+#include "formula.h"
+#include "simd.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <limits>
+
+namespace fractal {
+namespace kernel {
+
+// Number of independent vectors iterated together. One z^2 + c step is a
+// short chain of dependent multiplies, so interleaving several vectors keeps
+// the FP units busy instead of waiting on latency.
+constexpr int kStreams = 4;
+
+template <typename Vec>
+constexpr int blockSize() { return kStreams * Vec::kLanes; }
+
+// Iterations between polls of the cancellation flag: microseconds of work
+// for a block, so a cancelled render stops well within a millisecond
+constexpr int kCancelInterval = 1024;
+
+// Cancellation flag of the render call running on this thread (null outside
+// one, or when the call has none)
+inline const std::atomic<bool>*& cancelFlag() {
+    thread_local const std::atomic<bool>* current = nullptr;
+    return current;
+}
+
+inline bool cancelled() {
+    const std::atomic<bool>* flag = cancelFlag();
+    return flag && flag->load(std::memory_order_relaxed);
+}
+
+// Makes a render call's RenderParams::cancel visible to the kernels it runs.
+// Nested calls keep the outer call's flag unless they bring their own.
+class CancelScope {
+public:
+    explicit CancelScope(const std::atomic<bool>* flag) : outer_(cancelFlag()) {
+        if (flag) {
+            cancelFlag() = flag;
+        }
+    }
+
+    ~CancelScope() { cancelFlag() = outer_; }
+
+    CancelScope(const CancelScope&) = delete;
+    CancelScope& operator=(const CancelScope&) = delete;
+
+private:
+    const std::atomic<bool>* outer_;
+};
+
+// The block loop is inlined into each batch kernel rather than shared, so
+// every family and plane gets its own loop (a Julia c stays in a register
+// instead of being reloaded for each stream)
+#if defined(__GNUC__) || defined(__clang__)
+#define FRACTAL_KERNEL_INLINE inline __attribute__((always_inline))
+#else
+#define FRACTAL_KERNEL_INLINE inline
+#endif
+
+// Iterates Formula (z = z^2 + c for Quadratic) for blockSize<Vec>() points
+// until every lane has escaped or max_iterations is reached. `active` marks
+// lanes that should iterate at all.
+// On return `iter` holds the iteration count per lane and `escape_mag2` the
+// value of |z|^2 at escape (undefined for lanes that never escaped).
+//
+// Escaped lanes keep iterating (their z overflows harmlessly to inf/nan) so
+// no blend sits on the critical path; the count and |z|^2 are frozen instead.
+//
+// With kDetectCycles, Brent's method stops lanes whose orbit has settled on a
+// cycle: z is saved at iterations 1, 2, 4, 8, ... and a lane that comes back
+// within cycle_tolerance of its saved value is marked in `periodic` and
+// deactivated. All lanes share the iteration counter, so the save schedule
+// costs one scalar test per step.
+template <typename Formula, typename Vec, bool kDetectCycles>
+FRACTAL_KERNEL_INLINE void iterateBlockImpl(
+    Vec (&z_real)[kStreams], Vec (&z_imag)[kStreams],
+    const Vec (&c_real)[kStreams], const Vec (&c_imag)[kStreams], Vec (&active)[kStreams],
+    int max_iterations, double bailout_radius, double cycle_tolerance,
+    Vec (&iter)[kStreams], Vec (&escape_mag2)[kStreams], Vec (&periodic)[kStreams]) {
+    using Scalar = typename Vec::Scalar;
+
+    const Vec bailout(static_cast<Scalar>(bailout_radius));
+    const Vec one(static_cast<Scalar>(1));
+    const Vec tolerance2(static_cast<Scalar>(cycle_tolerance * cycle_tolerance));
+
+    Vec z_real2[kStreams], z_imag2[kStreams];
+    Vec saved_real[kStreams], saved_imag[kStreams];
+    Vec any_active = active[0];
+    for (int s = 0; s < kStreams; s++) {
+        z_real2[s] = z_real[s] * z_real[s];
+        z_imag2[s] = z_imag[s] * z_imag[s];
+        iter[s] = Vec(static_cast<Scalar>(0));
+        escape_mag2[s] = Vec(static_cast<Scalar>(0));
+        periodic[s] = Vec(static_cast<Scalar>(0));
+        saved_real[s] = z_real[s];
+        saved_imag[s] = z_imag[s];
+        any_active = any_active | active[s];
+    }
+
+    int next_save = 1;
+    for (int i = 0; i < max_iterations && simd::any(any_active); i++) {
+        // Once cancelled, lanes still running read as stopped by the limit
+        if (i % kCancelInterval == 0 && cancelled()) {
+            const Vec limit(static_cast<Scalar>(max_iterations));
+            for (int s = 0; s < kStreams; s++) {
+                iter[s] = simd::select(active[s], limit, iter[s]);
+            }
+            break;
+        }
+
+        for (int s = 0; s < kStreams; s++) {
+            Formula::step(z_real[s], z_imag[s], z_real2[s], z_imag2[s], c_real[s], c_imag[s]);
+            z_real2[s] = z_real[s] * z_real[s];
+            z_imag2[s] = z_imag[s] * z_imag[s];
+
+            Vec mag2 = z_real2[s] + z_imag2[s];
+            Vec inside = simd::cmpLe(mag2, bailout);
+            escape_mag2[s] = simd::select(simd::andNot(inside, active[s]), mag2, escape_mag2[s]);
+            iter[s] = iter[s] + (active[s] & one);
+            active[s] = active[s] & inside;
+
+            if (kDetectCycles) {
+                Vec d_real = z_real[s] - saved_real[s];
+                Vec d_imag = z_imag[s] - saved_imag[s];
+                Vec cycle = simd::cmpLe(d_real * d_real + d_imag * d_imag, tolerance2) & active[s];
+                periodic[s] = periodic[s] | cycle;
+                active[s] = simd::andNot(cycle, active[s]);
+            }
+        }
+
+        if (kDetectCycles && i + 1 == next_save) {
+            for (int s = 0; s < kStreams; s++) {
+                saved_real[s] = z_real[s];
+                saved_imag[s] = z_imag[s];
+            }
+            next_save *= 2;
+        }
+
+        any_active = active[0];
+        for (int s = 1; s < kStreams; s++) {
+            any_active = any_active | active[s];
+        }
+    }
+}
+
+// cycle_tolerance <= 0 disables cycle detection (`periodic` stays clear)
+template <typename Formula, typename Vec>
+FRACTAL_KERNEL_INLINE void iterateBlock(
+    Vec (&z_real)[kStreams], Vec (&z_imag)[kStreams],
+    const Vec (&c_real)[kStreams], const Vec (&c_imag)[kStreams], Vec (&active)[kStreams],
+    int max_iterations, double bailout_radius, double cycle_tolerance,
+    Vec (&iter)[kStreams], Vec (&escape_mag2)[kStreams], Vec (&periodic)[kStreams]) {
+    if (cycle_tolerance > 0.0) {
+        iterateBlockImpl<Formula, Vec, true>(z_real, z_imag, c_real, c_imag, active,
+                                             max_iterations, bailout_radius, cycle_tolerance,
+                                             iter, escape_mag2, periodic);
+    } else {
+        iterateBlockImpl<Formula, Vec, false>(z_real, z_imag, c_real, c_imag, active,
+                                              max_iterations, bailout_radius, cycle_tolerance,
+                                              iter, escape_mag2, periodic);
+    }
+}
+
+// Brent cycle check for the scalar double-double loops: call once per
+// iteration after z has been updated. Returns true once the orbit is
+// back within tolerance of the last saved value.
+struct CycleDetector {
+    DoubleDouble saved_real;
+    DoubleDouble saved_imag;
+    double tolerance2;
+    int next_save;
+
+    CycleDetector(const DoubleDouble& z_real, const DoubleDouble& z_imag, double tolerance)
+        : saved_real(z_real), saved_imag(z_imag), tolerance2(tolerance * tolerance),
+          next_save(1) {}
+
+    bool step(int iter, const DoubleDouble& z_real, const DoubleDouble& z_imag) {
+        double d_real = (z_real - saved_real).hi;
+        double d_imag = (z_imag - saved_imag).hi;
+        if (d_real * d_real + d_imag * d_imag <= tolerance2) {
+            return true;
+        }
+        if (iter == next_save) {
+            saved_real = z_real;
+            saved_imag = z_imag;
+            next_save *= 2;
+        }
+        return false;
+    }
+};
+
+// Fill a FractalPoint from an iteration count and escape magnitude,
+// using the same smooth-coloring formula as the scalar kernels (for a
+// formula of the given degree)
+inline void finishPoint(int iterations, double escape_mag2, int max_iterations,
+                        bool smooth_coloring, FractalPoint& result, int degree = 2) {
+    result.iterations = iterations;
+    result.inside_set = (iterations >= max_iterations);
+
+    if (smooth_coloring && iterations < max_iterations) {
+        double log_zn = std::log(escape_mag2) / 2.0;
+        double nu = std::log(log_zn / std::log(2.0)) / std::log(static_cast<double>(degree));
+        result.smooth_value = iterations + 1.0 - nu;
+    } else {
+        result.smooth_value = iterations;
+    }
+}
+
+// A point whose orbit was found to be periodic: inside the set
+inline void finishPeriodicPoint(int max_iterations, FractalPoint& result) {
+    result.iterations = max_iterations;
+    result.inside_set = true;
+    result.smooth_value = max_iterations;
+}
+
+// Continue orbits that stopped at start_iterations without escaping, up to
+// max_iterations. z_real/z_imag hold each orbit's z on entry; on return they
+// hold z for points that reached the new limit too and NaN for points that
+// are now decided (escaped or periodic). Returns the periodic count.
+template <typename Formula, typename Vec>
+inline int continueBatch(const typename Vec::Scalar* c_real,
+                         const typename Vec::Scalar* c_imag,
+                         typename Vec::Scalar* z_real, typename Vec::Scalar* z_imag,
+                         int count, int start_iterations, int max_iterations,
+                         double bailout_radius, bool smooth_coloring, double cycle_tolerance,
+                         FractalPoint* results) {
+    using Scalar = typename Vec::Scalar;
+    constexpr int kLanes = Vec::kLanes;
+    constexpr int kBlockSize = blockSize<Vec>();
+
+    const Vec bailout(static_cast<Scalar>(bailout_radius));
+    const Scalar decided = std::numeric_limits<Scalar>::quiet_NaN();
+
+    Scalar cr_lanes[kBlockSize], ci_lanes[kBlockSize];
+    Scalar zr_lanes[kBlockSize], zi_lanes[kBlockSize];
+    Scalar iter_lanes[kBlockSize], mag2_lanes[kBlockSize], start_mag2[kBlockSize];
+    int periodic_bits[kStreams];
+    int cycle_hits = 0;
+
+    for (int base = 0; base < count; base += kBlockSize) {
+        int n = std::min(kBlockSize, count - base);
+
+        // Pad a short final block with copies of its last point
+        for (int i = 0; i < kBlockSize; i++) {
+            int src = base + std::min(i, n - 1);
+            cr_lanes[i] = c_real[src];
+            ci_lanes[i] = c_imag[src];
+            zr_lanes[i] = z_real[src];
+            zi_lanes[i] = z_imag[src];
+            start_mag2[i] = zr_lanes[i] * zr_lanes[i] + zi_lanes[i] * zi_lanes[i];
+        }
+
+        Vec cr[kStreams], ci[kStreams], zr[kStreams], zi[kStreams];
+        Vec active[kStreams], iter[kStreams], mag2[kStreams], periodic[kStreams];
+        for (int s = 0; s < kStreams; s++) {
+            cr[s] = Vec::load(cr_lanes + s * kLanes);
+            ci[s] = Vec::load(ci_lanes + s * kLanes);
+            zr[s] = Vec::load(zr_lanes + s * kLanes);
+            zi[s] = Vec::load(zi_lanes + s * kLanes);
+            active[s] = simd::cmpLe(zr[s] * zr[s] + zi[s] * zi[s], bailout);
+        }
+
+        iterateBlock<Formula>(zr, zi, cr, ci, active, max_iterations - start_iterations,
+                              bailout_radius, cycle_tolerance, iter, mag2, periodic);
+
+        for (int s = 0; s < kStreams; s++) {
+            zr[s].store(zr_lanes + s * kLanes);
+            zi[s].store(zi_lanes + s * kLanes);
+            iter[s].store(iter_lanes + s * kLanes);
+            mag2[s].store(mag2_lanes + s * kLanes);
+            periodic_bits[s] = simd::bits(periodic[s]);
+        }
+
+        for (int i = 0; i < n; i++) {
+            FractalPoint& result = results[base + i];
+
+            if (periodic_bits[i / kLanes] & (1 << (i % kLanes))) {
+                finishPeriodicPoint(max_iterations, result);
+                FRACTAL_PROFILE_ONLY(profile::countPeriodic(static_cast<int>(iter_lanes[i])));
+                z_real[base + i] = decided;
+                z_imag[base + i] = decided;
+                cycle_hits++;
+                continue;
+            }
+
+            // An orbit that escaped on the old limit's last step is outside
+            // the bailout already and escapes at start_iterations
+            Scalar escape_mag2 = iter_lanes[i] > 0 ? mag2_lanes[i] : start_mag2[i];
+            finishPoint(start_iterations + static_cast<int>(iter_lanes[i]), escape_mag2,
+                        max_iterations, smooth_coloring, result, Formula::kDegree);
+            FRACTAL_PROFILE_ONLY(profile::countPoint(static_cast<int>(iter_lanes[i]),
+                                                     result.iterations, !result.inside_set));
+            z_real[base + i] = result.inside_set ? zr_lanes[i] : decided;
+            z_imag[base + i] = result.inside_set ? zi_lanes[i] : decided;
+        }
+    }
+    return cycle_hits;
+}
+
+// Iterate count points of a family in the batch kernel: each point is c
+// over the parameter plane, or the starting z of a Julia set whose c is
+// julia_c. With cycle_tolerance > 0 an orbit that returns within that
+// distance of an earlier value (Brent's method) is classed as inside
+// without running to max_iterations; returns the number of points decided
+// that way. When orbit_real/orbit_imag are given they receive z for points
+// stopped by max_iterations alone (NaN for the rest), from which
+// continueBatch can resume. Everything that varies per family or coloring
+// is a template parameter, so the loops are specialized for each.
+template <typename Family, typename Vec, bool kSmooth>
+inline int computeBatch(const typename Vec::Scalar* real, const typename Vec::Scalar* imag,
+                        int count, double julia_c_real, double julia_c_imag,
+                        int max_iterations, double bailout_radius, double cycle_tolerance,
+                        FractalPoint* results, typename Vec::Scalar* orbit_real,
+                        typename Vec::Scalar* orbit_imag) {
+    using Scalar = typename Vec::Scalar;
+    using Formula = typename Family::Formula;
+    constexpr int kLanes = Vec::kLanes;
+    constexpr int kBlockSize = blockSize<Vec>();
+    constexpr bool kInteriorTest = Formula::kInteriorTest && !Family::kJulia;
+
+    const Vec bailout(static_cast<Scalar>(bailout_radius));
+    const Vec zero(static_cast<Scalar>(0.0));
+
+    Scalar real_lanes[kBlockSize], imag_lanes[kBlockSize];
+    Scalar iter_lanes[kBlockSize], mag2_lanes[kBlockSize];
+    Scalar orbit_lanes_real[kBlockSize], orbit_lanes_imag[kBlockSize];
+    const Scalar decided = std::numeric_limits<Scalar>::quiet_NaN();
+    int skip_bits[kStreams] = {};
+    int periodic_bits[kStreams];
+    int cycle_hits = 0;
+
+    Vec cr[kStreams], ci[kStreams];
+    for (int s = 0; Family::kJulia && s < kStreams; s++) {
+        cr[s] = Vec(static_cast<Scalar>(julia_c_real));
+        ci[s] = Vec(static_cast<Scalar>(julia_c_imag));
+    }
+
+    for (int base = 0; base < count; base += kBlockSize) {
+        int n = std::min(kBlockSize, count - base);
+
+        // Pad a short final block with copies of its last point so the spare
+        // lanes finish together with a real one
+        for (int i = 0; i < kBlockSize; i++) {
+            int src = base + std::min(i, n - 1);
+            real_lanes[i] = real[src];
+            imag_lanes[i] = imag[src];
+        }
+
+        Vec zr[kStreams], zi[kStreams];
+        Vec active[kStreams], iter[kStreams], mag2[kStreams], periodic[kStreams];
+        for (int s = 0; s < kStreams; s++) {
+            Vec point_real = Vec::load(real_lanes + s * kLanes);
+            Vec point_imag = Vec::load(imag_lanes + s * kLanes);
+            if (Family::kJulia) {
+                zr[s] = point_real;
+                zi[s] = point_imag;
+            } else {
+                cr[s] = point_real;
+                ci[s] = point_imag;
+                zr[s] = zero;
+                zi[s] = zero;
+            }
+            active[s] = simd::cmpLe(zr[s] * zr[s] + zi[s] * zi[s], bailout);
+
+            if constexpr (kInteriorTest) {
+                Vec skip = Formula::interior(cr[s], ci[s]);
+                skip_bits[s] = simd::bits(skip);
+                active[s] = simd::andNot(skip, active[s]);
+            }
+        }
+
+        iterateBlock<Formula>(zr, zi, cr, ci, active, max_iterations, bailout_radius,
+                              cycle_tolerance, iter, mag2, periodic);
+
+        for (int s = 0; s < kStreams; s++) {
+            iter[s].store(iter_lanes + s * kLanes);
+            mag2[s].store(mag2_lanes + s * kLanes);
+            periodic_bits[s] = simd::bits(periodic[s]);
+            if (orbit_real) {
+                zr[s].store(orbit_lanes_real + s * kLanes);
+                zi[s].store(orbit_lanes_imag + s * kLanes);
+            }
+        }
+
+        for (int i = 0; i < n; i++) {
+            FractalPoint& result = results[base + i];
+            int bit = 1 << (i % kLanes);
+
+            if (kInteriorTest && (skip_bits[i / kLanes] & bit)) {
+                finishPeriodicPoint(max_iterations, result);
+                FRACTAL_PROFILE_ONLY(profile::countSkipped());
+                continue;
+            }
+
+            if (periodic_bits[i / kLanes] & bit) {
+                finishPeriodicPoint(max_iterations, result);
+                FRACTAL_PROFILE_ONLY(profile::countPeriodic(static_cast<int>(iter_lanes[i])));
+                cycle_hits++;
+                continue;
+            }
+
+            // A Julia starting point outside the bailout never iterates
+            Scalar escape_mag2 = mag2_lanes[i];
+            if (Family::kJulia && iter_lanes[i] == 0) {
+                escape_mag2 = real_lanes[i] * real_lanes[i] + imag_lanes[i] * imag_lanes[i];
+            }
+            finishPoint(static_cast<int>(iter_lanes[i]), escape_mag2, max_iterations, kSmooth,
+                        result, Formula::kDegree);
+            FRACTAL_PROFILE_ONLY(profile::countPoint(result.iterations, result.iterations,
+                                                     !result.inside_set));
+        }
+
+        // z of orbits stopped only by the limit, so they can be continued
+        for (int i = 0; orbit_real && i < n; i++) {
+            int bit = 1 << (i % kLanes);
+            bool decided_early = ((skip_bits[i / kLanes] | periodic_bits[i / kLanes]) & bit) ||
+                                 !results[base + i].inside_set;
+            orbit_real[base + i] = decided_early ? decided : orbit_lanes_real[i];
+            orbit_imag[base + i] = decided_early ? decided : orbit_lanes_imag[i];
+        }
+    }
+    return cycle_hits;
+}
+
+// One point of a family in double-double (~106-bit), for scales past
+// double precision; the point is as for computeBatch. Sets *periodic when
+// the point is decided inside before max_iterations: by the cycle check, or
+// by the interior test (whose points settle on a cycle of period 1 or 2).
+template <typename Family, bool kSmooth>
+inline FractalPoint computePointDD(const DoubleDouble& real, const DoubleDouble& imag,
+                                   double julia_c_real, double julia_c_imag,
+                                   int max_iterations, double bailout_radius,
+                                   double cycle_tolerance, bool* periodic) {
+    using Formula = typename Family::Formula;
+    FractalPoint result;
+
+    DoubleDouble z_real, z_imag, c_real, c_imag;
+    if constexpr (Family::kJulia) {
+        z_real = real;
+        z_imag = imag;
+        c_real = julia_c_real;
+        c_imag = julia_c_imag;
+    } else {
+        c_real = real;
+        c_imag = imag;
+        // The interior test only needs to be right away from its edges
+        if constexpr (Formula::kInteriorTest) {
+            if (Formula::interior(real.hi, imag.hi)) {
+                if (periodic) {
+                    *periodic = true;
+                }
+                finishPeriodicPoint(max_iterations, result);
+                FRACTAL_PROFILE_ONLY(profile::countSkipped());
+                return result;
+            }
+        }
+    }
+
+    DoubleDouble z_real2 = z_real * z_real;
+    DoubleDouble z_imag2 = z_imag * z_imag;
+    double mag2 = z_real2.hi + z_imag2.hi;
+
+    CycleDetector cycles(z_real, z_imag, cycle_tolerance);
+
+    int iter = 0;
+    while (mag2 <= bailout_radius && iter < max_iterations) {
+        if (iter % kCancelInterval == 0 && cancelled()) {
+            iter = max_iterations;
+            break;
+        }
+        Formula::step(z_real, z_imag, z_real2, z_imag2, c_real, c_imag);
+        z_real2 = z_real * z_real;
+        z_imag2 = z_imag * z_imag;
+        mag2 = z_real2.hi + z_imag2.hi;
+        iter++;
+
+        if (cycle_tolerance > 0.0 && cycles.step(iter, z_real, z_imag)) {
+            if (periodic) {
+                *periodic = true;
+            }
+            finishPeriodicPoint(max_iterations, result);
+            FRACTAL_PROFILE_ONLY(profile::countPeriodic(iter));
+            return result;
+        }
+    }
+
+    finishPoint(iter, mag2, max_iterations, kSmooth, result, Formula::kDegree);
+    FRACTAL_PROFILE_ONLY(profile::countPoint(iter, iter, !result.inside_set));
+    return result;
+}
+
+} // namespace kernel
+} // namespace fractal
+
+#endif // ESCAPE_KERNEL_H
@@ -0,0 +1,128 @@
+#ifndef FORMULA_H
+#define FORMULA_H
+
+#include "double_double.h"
+#include "simd.h"
+#include <cmath>
+
+namespace fractal {
+namespace kernel {
+
+// Escape-time formulas as policies for the kernels in escape_kernel.h. A
+// formula's step() advances z by one iteration given the squares of its
+// components, which every kernel keeps for the bailout test anyway; it is
+// written once over the number type, so the same policy runs in the SIMD
+// vectors, in float and double and in double-double. kDegree is the power
+// of z the formula grows by, which smooth coloring needs.
+
+inline float absolute(float x) { return std::fabs(x); }
+inline double absolute(double x) { return std::fabs(x); }
+inline simd::VecF absolute(simd::VecF x) { return simd::abs(x); }
+inline simd::VecD absolute(simd::VecD x) { return simd::abs(x); }
+inline DoubleDouble absolute(const DoubleDouble& x) { return x.hi < 0.0 ? -x : x; }
+
+template <typename T>
+inline T twice(const T& x) { return x + x; }
+inline DoubleDouble twice(const DoubleDouble& x) { return times2(x); }
+
+// z^2 + c. The only formula with a closed-form interior test (the main
+// cardioid and period-2 bulb of the Mandelbrot set).
+struct Quadratic {
+    static constexpr int kDegree = 2;
+    static constexpr bool kInteriorTest = true;
+
+    template <typename T>
+    static void step(T& z_real, T& z_imag, const T& z_real2, const T& z_imag2,
+                     const T& c_real, const T& c_imag) {
+        T zri = z_real * z_imag;
+        z_imag = twice(zri) + c_imag;
+        z_real = z_real2 - z_imag2 + c_real;
+    }
+
+    // Whether c lies in the main cardioid or the period-2 bulb, as a lane
+    // mask for the vectors
+    template <typename Vec>
+    static Vec interior(const Vec& c_real, const Vec& c_imag) {
+        using Scalar = typename Vec::Scalar;
+        const Vec one(static_cast<Scalar>(1.0));
+        const Vec quarter(static_cast<Scalar>(0.25));
+        const Vec sixteenth(static_cast<Scalar>(0.0625));
+        Vec xq = c_real - quarter;
+        Vec ci2 = c_imag * c_imag;
+        Vec q = xq * xq + ci2;
+        Vec dx = c_real + one;
+        return simd::cmpLe(q * (q + xq), quarter * ci2) |
+               simd::cmpLe(dx * dx + ci2, sixteenth);
+    }
+
+    static bool interior(double c_real, double c_imag) {
+        double xq = c_real - 0.25;
+        double q = xq * xq + c_imag * c_imag;
+        double dx = c_real + 1.0;
+        return q * (q + xq) <= 0.25 * c_imag * c_imag ||
+               dx * dx + c_imag * c_imag <= 0.0625;
+    }
+};
+
+// z^D + c, the power multiplied out at compile time
+template <int D>
+struct Multibrot {
+    static_assert(D >= 2, "Multibrot needs a degree of at least 2");
+    static constexpr int kDegree = D;
+    static constexpr bool kInteriorTest = false;
+
+    template <typename T>
+    static void step(T& z_real, T& z_imag, const T& z_real2, const T& z_imag2,
+                     const T& c_real, const T& c_imag) {
+        T power_real = z_real2 - z_imag2;
+        T power_imag = twice(z_real * z_imag);
+        for (int k = 2; k < D; k++) {
+            T next_real = power_real * z_real - power_imag * z_imag;
+            power_imag = power_real * z_imag + power_imag * z_real;
+            power_real = next_real;
+        }
+        z_real = power_real + c_real;
+        z_imag = power_imag + c_imag;
+    }
+};
+
+// (|Re z| + i|Im z|)^2 + c
+struct BurningShip {
+    static constexpr int kDegree = 2;
+    static constexpr bool kInteriorTest = false;
+
+    template <typename T>
+    static void step(T& z_real, T& z_imag, const T& z_real2, const T& z_imag2,
+                     const T& c_real, const T& c_imag) {
+        T zri = absolute(z_real * z_imag);
+        z_imag = twice(zri) + c_imag;
+        z_real = z_real2 - z_imag2 + c_real;
+    }
+};
+
+// conj(z)^2 + c (the Mandelbar set)
+struct Tricorn {
+    static constexpr int kDegree = 2;
+    static constexpr bool kInteriorTest = false;
+
+    template <typename T>
+    static void step(T& z_real, T& z_imag, const T& z_real2, const T& z_imag2,
+                     const T& c_real, const T& c_imag) {
+        T zri = z_real * z_imag;
+        z_imag = c_imag - twice(zri);
+        z_real = z_real2 - z_imag2 + c_real;
+    }
+};
+
+// A formula iterated over the parameter plane (z from 0, c the point) or,
+// with kJulia, over the dynamical plane (z from the point, c fixed)
+template <typename FormulaT, bool kJuliaPlane>
+struct Family {
+    using Formula = FormulaT;
+    static constexpr bool kJulia = kJuliaPlane;
+};
+
+} // namespace kernel
+} // namespace fractal
+
+#endif // FORMULA_H
@@ -2,11 +2,93 @@
 #include "mandelbrot.h"
 #include "julia.h"
 #include "color_palette.h"
+#include "perturbation.h"
+#include "big_fixed.h"
+#include "escape_kernel.h"
+#include "fractal_family.h"
+#include "trace_recorder.h"
+#include <algorithm>
 #include <cmath>
+#include <cstring>
+#include <limits>
 
 namespace fractal {
 
-FractalEngine::FractalEngine() {
+namespace {
+
+// IterationField orbit markers
+const double kOrbitDecided = std::numeric_limits<double>::quiet_NaN();
+const double kOrbitUnrecorded = std::numeric_limits<double>::infinity();
+
+// Integer hash (lowbias32) for reproducible subsample placement
+uint32_t mixBits(uint32_t value) {
+    value ^= value >> 16;
+    value *= 0x7feb352du;
+    value ^= value >> 15;
+    value *= 0x846ca68bu;
+    value ^= value >> 16;
+    return value;
+}
+
+uint32_t hashSample(int x, int y, int level, int i, int j) {
+    uint32_t hash = mixBits(static_cast<uint32_t>(x) * 0x9e3779b9u ^ static_cast<uint32_t>(y));
+    hash = mixBits(hash ^ static_cast<uint32_t>(level) << 24 ^ static_cast<uint32_t>(i) << 12 ^
+                   static_cast<uint32_t>(j));
+    return hash;
+}
+
+// Sum of per-channel differences between two colors
+int colorDistance(const Color& a, const Color& b) {
+    return std::abs(a.r - b.r) + std::abs(a.g - b.g) + std::abs(a.b - b.b);
+}
+
+// Color one computed row into RGBA (if pixels is non-null) and record it in
+// the iteration field (if field is non-null). Without orbit data, a field
+// that keeps orbits marks the row's inside pixels as unrecorded.
+void storeRow(const FractalPoint* points, int count, const ColorPalette& palette,
+              const RenderParams& params, double lut_scale, double lut_offset, uint8_t* row,
+              IterationField* field, int x_start, int screen_y,
+              const double* orbit_real = nullptr, const double* orbit_imag = nullptr) {
+    FRACTAL_PROFILE_ONLY(profile::Timer timer(&RenderStats::color_ms));
+    if (field) {
+        size_t base = field->indexOf(x_start, screen_y);
+        for (int x = 0; x < count; x++) {
+            field->smooth_values[base + x] = static_cast<float>(points[x].smooth_value);
+            field->inside_set[base + x] = points[x].inside_set ? 1 : 0;
+        }
+
+        if (field->keep_orbits && orbit_real) {
+            std::copy_n(orbit_real, count, field->orbit_real.begin() + base);
+            std::copy_n(orbit_imag, count, field->orbit_imag.begin() + base);
+        } else if (field->keep_orbits) {
+            for (int x = 0; x < count; x++) {
+                double orbit = points[x].inside_set ? kOrbitUnrecorded : kOrbitDecided;
+                field->orbit_real[base + x] = orbit;
+                field->orbit_imag[base + x] = orbit;
+            }
+        }
+    }
+
+    if (!row) {
+        return;
+    }
+
+    for (int x = 0; x < count; x++) {
+        // Get color
+        Color color = palette.lookup(ColorPalette::colorValue(params, points[x].smooth_value),
+                                     points[x].inside_set, lut_scale, lut_offset);
+
+        // Write to buffer
+        row[x * 4 + 0] = color.r;
+        row[x * 4 + 1] = color.g;
+        row[x * 4 + 2] = color.b;
+        row[x * 4 + 3] = color.a;
+    }
+}
+
+} // namespace
+
+FractalEngine::FractalEngine() : cycle_points_(0), cycle_hits_(0) {
 }
 
 void FractalEngine::screenToComplex(int screen_x, int screen_y,
@@ -29,45 +111,1113 @@ FractalPoint FractalEngine::computeJulia(double z_real, double z_imag,
                          params.bailout_radius, params.smooth_coloring);
 }
 
+// Precision tiers. A tier with unit roundoff 2^-p represents coordinates and
+// orbit values of magnitude up to M with absolute error <= M * 2^-p. We only
+// use it while that error is at most 1/256 of a pixel:
+//
+//     scale >= M * 2^(8 - p),   M = max(2, largest |coordinate| in the tile)
+//
+// (M >= 2 because every orbit that has not escaped visits |z| up to 2.) With
+// M = 2 this puts float32 (p = 24) above ~3e-5, double (p = 53) above ~6e-14
+// and double-double (p = 106) above ~6e-30. Deeper than that double-double is
+// still used but can no longer resolve pixels; use renderTileDeep instead.
+// The bound covers coordinates and a single step; chaotic orbits amplify any
+// rounding, so iteration counts right on the boundary may differ between
+// tiers, exactly as they already do between neighbouring pixels.
+namespace {
+constexpr int kGuardBits = 8;
+constexpr int kFloatBits = 24;
+constexpr int kDoubleBits = 53;
+
+// Mariani-Silver: rectangles with at most this many pixels are iterated in
+// full rather than split further
+constexpr int kDirectArea = 64;
+
+// Whether a filled region may take the value of a border pixel. With smooth
+// coloring escaped pixels each get their own fractional value, so only the
+// interior of the set can be filled exactly.
+bool fillable(const FractalPoint& a, const FractalPoint& b, bool smooth_coloring) {
+    if (smooth_coloring) {
+        return a.inside_set && b.inside_set;
+    }
+    return a.iterations == b.iterations && a.inside_set == b.inside_set;
+}
+}
+
+Precision FractalEngine::selectPrecision(const Viewport& viewport, int x_start, int y_start,
+                                         int tile_width, int tile_height) {
+    double left = (x_start - viewport.width / 2.0) * viewport.scale + viewport.center_x;
+    double right = (x_start + tile_width - viewport.width / 2.0) * viewport.scale + viewport.center_x;
+    double top = (y_start - viewport.height / 2.0) * viewport.scale + viewport.center_y;
+    double bottom = (y_start + tile_height - viewport.height / 2.0) * viewport.scale + viewport.center_y;
+
+    double magnitude = std::max({std::fabs(left), std::fabs(right),
+                                 std::fabs(top), std::fabs(bottom)});
+    return selectPrecision(viewport.scale, magnitude);
+}
+
+Precision FractalEngine::selectPrecision(double scale, double magnitude) {
+    magnitude = std::max(2.0, magnitude);
+    if (scale >= std::ldexp(magnitude, kGuardBits - kFloatBits)) {
+        return PRECISION_FLOAT;
+    }
+    if (scale >= std::ldexp(magnitude, kGuardBits - kDoubleBits)) {
+        return PRECISION_DOUBLE;
+    }
+    return PRECISION_DOUBLE_DOUBLE;
+}
+
+double FractalEngine::cycleTolerance(const Viewport& viewport) {
+    return cycleTolerance(viewport.scale);
+}
+
+double FractalEngine::cycleTolerance(double scale) {
+    return std::ldexp(scale, -kGuardBits);
+}
+
+PeriodicityStats FractalEngine::periodicityStats() const {
+    PeriodicityStats stats;
+    stats.points = cycle_points_.load(std::memory_order_relaxed);
+    stats.hits = cycle_hits_.load(std::memory_order_relaxed);
+    return stats;
+}
+
+void FractalEngine::resetPeriodicityStats() {
+    cycle_points_.store(0, std::memory_order_relaxed);
+    cycle_hits_.store(0, std::memory_order_relaxed);
+}
+
+RenderStats FractalEngine::renderStats() const {
+    std::lock_guard<std::mutex> lock(stats_mutex_);
+    return stats_;
+}
+
+void FractalEngine::resetRenderStats() {
+    std::lock_guard<std::mutex> lock(stats_mutex_);
+    stats_.reset();
+}
+
+void FractalEngine::computeRow(int x_start, int screen_y, int count, const Viewport& viewport,
+                              const RenderParams& params, FractalType type,
+                              double julia_c_real, double julia_c_imag, Precision precision,
+                              FractalPoint* points, double* orbit_real,
+                              double* orbit_imag) const {
+    thread_local std::vector<int> row_x, row_y;
+    if (static_cast<int>(row_x.size()) < count) {
+        row_x.resize(count);
+        row_y.resize(count);
+    }
+    for (int x = 0; x < count; x++) {
+        row_x[x] = x_start + x;
+        row_y[x] = screen_y;
+    }
+
+    computePixels(row_x.data(), row_y.data(), count, viewport, params, type,
+                  julia_c_real, julia_c_imag, precision, points, orbit_real, orbit_imag);
+}
+
+void FractalEngine::computePixels(const int* screen_x, const int* screen_y, int count,
+                                 const Viewport& viewport, const RenderParams& params,
+                                 FractalType type, double julia_c_real, double julia_c_imag,
+                                 Precision precision, FractalPoint* points,
+                                 double* orbit_real, double* orbit_imag,
+                                 const double* subpixel_x, const double* subpixel_y) const {
+    FRACTAL_PROFILE_ONLY(profile::Timer timer(&RenderStats::iterate_ms));
+    double cycle_tolerance = params.periodicity_check ? cycleTolerance(viewport) : 0.0;
+    int hits = 0;
+
+    if (precision == PRECISION_DOUBLE_DOUBLE) {
+        FamilyKernels::PointDD point_dd =
+            familyKernels(type).point_dd[params.smooth_coloring ? 1 : 0];
+        // Add the pixel offset to the center without rounding
+        for (int i = 0; i < count; i++) {
+            double x = subpixel_x ? screen_x[i] + subpixel_x[i] : screen_x[i];
+            double y = subpixel_y ? screen_y[i] + subpixel_y[i] : screen_y[i];
+            double offset_real = (x - viewport.width / 2.0) * viewport.scale;
+            double offset_imag = (y - viewport.height / 2.0) * viewport.scale;
+            DoubleDouble c_real = DoubleDouble::twoSum(viewport.center_x, offset_real);
+            DoubleDouble c_imag = DoubleDouble::twoSum(viewport.center_y, offset_imag);
+            bool periodic = false;
+            points[i] = point_dd(c_real, c_imag, julia_c_real, julia_c_imag,
+                                 params.max_iterations, params.bailout_radius, cycle_tolerance,
+                                 &periodic);
+            hits += periodic ? 1 : 0;
+
+            // The double-double orbit is not kept, only whether it is decided
+            if (orbit_real) {
+                orbit_real[i] = orbit_imag[i] =
+                    points[i].inside_set && !periodic ? kOrbitUnrecorded : kOrbitDecided;
+            }
+        }
+    } else {
+        // Per-thread scratch, reused across rows and tiles
+        thread_local std::vector<double> row_real, row_imag;
+        if (static_cast<int>(row_real.size()) < count) {
+            row_real.resize(count);
+            row_imag.resize(count);
+        }
+
+        // Convert screen coordinates to complex plane
+        for (int i = 0; i < count; i++) {
+            screenToComplex(screen_x[i], screen_y[i], viewport, row_real[i], row_imag[i]);
+        }
+        for (int i = 0; subpixel_x && i < count; i++) {
+            row_real[i] += subpixel_x[i] * viewport.scale;
+            row_imag[i] += subpixel_y[i] * viewport.scale;
+        }
+
+        hits = iterateBatch(row_real.data(), row_imag.data(), count, params, type,
+                            julia_c_real, julia_c_imag, precision == PRECISION_FLOAT,
+                            cycle_tolerance, points, orbit_real, orbit_imag);
+    }
+
+    if (cycle_tolerance > 0.0) {
+        cycle_points_.fetch_add(count, std::memory_order_relaxed);
+        cycle_hits_.fetch_add(hits, std::memory_order_relaxed);
+    }
+}
+
+void FractalEngine::computePoints(double center_real, double center_imag,
+                                  const double* offset_real, const double* offset_imag,
+                                  int count, double spacing, const RenderParams& params,
+                                  FractalType type, double julia_c_real, double julia_c_imag,
+                                  FractalPoint* points) const {
+    FRACTAL_PROFILE_ONLY(profile::Scope scope(static_cast<uint64_t>(count), params.stats,
+                                              stats_, stats_mutex_));
+    kernel::CancelScope cancel_scope(params.cancel);
+    FRACTAL_PROFILE_ONLY(profile::Timer timer(&RenderStats::iterate_ms));
+    double cycle_tolerance = params.periodicity_check ? cycleTolerance(spacing) : 0.0;
+    int hits = 0;
+
+    Precision precision = params.precision;
+    if (precision == PRECISION_AUTO) {
+        double reach = 0.0;
+        for (int i = 0; i < count; i++) {
+            reach = std::max({reach, std::fabs(offset_real[i]), std::fabs(offset_imag[i])});
+        }
+        precision = selectPrecision(spacing, std::max(std::fabs(center_real),
+                                                      std::fabs(center_imag)) + reach);
+    }
+
+    if (precision == PRECISION_DOUBLE_DOUBLE) {
+        FamilyKernels::PointDD point_dd =
+            familyKernels(type).point_dd[params.smooth_coloring ? 1 : 0];
+        for (int i = 0; i < count; i++) {
+            DoubleDouble c_real = DoubleDouble::twoSum(center_real, offset_real[i]);
+            DoubleDouble c_imag = DoubleDouble::twoSum(center_imag, offset_imag[i]);
+            bool periodic = false;
+            points[i] = point_dd(c_real, c_imag, julia_c_real, julia_c_imag,
+                                 params.max_iterations, params.bailout_radius, cycle_tolerance,
+                                 &periodic);
+            hits += periodic ? 1 : 0;
+        }
+    } else {
+        thread_local std::vector<double> real, imag;
+        if (static_cast<int>(real.size()) < count) {
+            real.resize(count);
+            imag.resize(count);
+        }
+        for (int i = 0; i < count; i++) {
+            real[i] = center_real + offset_real[i];
+            imag[i] = center_imag + offset_imag[i];
+        }
+        hits = iterateBatch(real.data(), imag.data(), count, params, type, julia_c_real,
+                            julia_c_imag, precision == PRECISION_FLOAT, cycle_tolerance, points,
+                            nullptr, nullptr);
+    }
+
+    if (cycle_tolerance > 0.0) {
+        cycle_points_.fetch_add(count, std::memory_order_relaxed);
+        cycle_hits_.fetch_add(hits, std::memory_order_relaxed);
+    }
+}
+
+int FractalEngine::iterateBatch(const double* real, const double* imag, int count,
+                                const RenderParams& params, FractalType type,
+                                double julia_c_real, double julia_c_imag, bool single_precision,
+                                double cycle_tolerance, FractalPoint* points,
+                                double* orbit_real, double* orbit_imag) const {
+    // One fully specialized kernel for the whole batch
+    const FamilyKernels& kernels = familyKernels(type);
+    int smooth = params.smooth_coloring ? 1 : 0;
+
+    thread_local std::vector<float> real_f, imag_f;
+    thread_local std::vector<float> orbit_real_f, orbit_imag_f;
+    if (single_precision) {
+        if (static_cast<int>(real_f.size()) < count) {
+            real_f.resize(count);
+            imag_f.resize(count);
+        }
+        for (int i = 0; i < count; i++) {
+            real_f[i] = static_cast<float>(real[i]);
+            imag_f[i] = static_cast<float>(imag[i]);
+        }
+        float* orbit_f_real = nullptr;
+        float* orbit_f_imag = nullptr;
+        if (orbit_real) {
+            if (static_cast<int>(orbit_real_f.size()) < count) {
+                orbit_real_f.resize(count);
+                orbit_imag_f.resize(count);
+            }
+            orbit_f_real = orbit_real_f.data();
+            orbit_f_imag = orbit_imag_f.data();
+        }
+        int hits = kernels.batch_float[smooth](real_f.data(), imag_f.data(), count,
+                                               julia_c_real, julia_c_imag, params.max_iterations,
+                                               params.bailout_radius, cycle_tolerance, points,
+                                               orbit_f_real, orbit_f_imag);
+        for (int i = 0; orbit_real && i < count; i++) {
+            orbit_real[i] = orbit_f_real[i];
+            orbit_imag[i] = orbit_f_imag[i];
+        }
+        return hits;
+    }
+    return kernels.batch_double[smooth](real, imag, count, julia_c_real, julia_c_imag,
+                                        params.max_iterations, params.bailout_radius,
+                                        cycle_tolerance, points, orbit_real, orbit_imag);
+}
+
 void FractalEngine::renderTile(int x_start, int y_start, int tile_width, int tile_height,
                               const Viewport& viewport, const RenderParams& params,
                               FractalType type, double julia_c_real, double julia_c_imag,
                               std::vector<uint8_t>& pixel_buffer) const {
-    // Initialize color palette
-    ColorPalette palette;
-    palette.initPalette(params.palette_id);
-
     // Ensure buffer is large enough
     pixel_buffer.resize(tile_width * tile_height * 4);  // RGBA
 
-    // Render each pixel
+    renderTile(x_start, y_start, tile_width, tile_height, viewport, params, type,
+               julia_c_real, julia_c_imag, pixel_buffer.data(), tile_width * 4);
+}
+
+void FractalEngine::computeTileSubdivided(int x_start, int y_start, int tile_width,
+                                         int tile_height, const Viewport& viewport,
+                                         const RenderParams& params, FractalType type,
+                                         double julia_c_real, double julia_c_imag,
+                                         Precision precision, FractalPoint* points) const {
+    struct Rect {
+        int x0, y0, x1, y1;  // Inclusive, tile-local
+    };
+
+    thread_local std::vector<uint8_t> known;
+    thread_local std::vector<int> batch_x, batch_y, batch_index;
+    thread_local std::vector<FractalPoint> batch_points;
+    known.assign(static_cast<size_t>(tile_width) * tile_height, 0);
+
+    auto queue = [&](int x, int y) {
+        int index = y * tile_width + x;
+        if (!known[index]) {
+            known[index] = 1;
+            batch_x.push_back(x_start + x);
+            batch_y.push_back(y_start + y);
+            batch_index.push_back(index);
+        }
+    };
+
+    // Iterate every queued pixel in one batch so the SIMD kernels stay busy
+    auto flush = [&]() {
+        int count = static_cast<int>(batch_index.size());
+        if (count == 0) {
+            return;
+        }
+        batch_points.resize(count);
+        computePixels(batch_x.data(), batch_y.data(), count, viewport, params, type,
+                      julia_c_real, julia_c_imag, precision, batch_points.data());
+        for (int i = 0; i < count; i++) {
+            points[batch_index[i]] = batch_points[i];
+        }
+        batch_x.clear();
+        batch_y.clear();
+        batch_index.clear();
+    };
+
+    std::vector<Rect> pending;
+    pending.push_back(Rect{0, 0, tile_width - 1, tile_height - 1});
+
+    while (!pending.empty()) {
+        Rect rect = pending.back();
+        pending.pop_back();
+
+        // Border first
+        for (int x = rect.x0; x <= rect.x1; x++) {
+            queue(x, rect.y0);
+            queue(x, rect.y1);
+        }
+        for (int y = rect.y0 + 1; y < rect.y1; y++) {
+            queue(rect.x0, y);
+            queue(rect.x1, y);
+        }
+        flush();
+
+        int width = rect.x1 - rect.x0 + 1;
+        int height = rect.y1 - rect.y0 + 1;
+        if (width <= 2 || height <= 2) {
+            continue;  // No interior
+        }
+
+        const FractalPoint& corner = points[rect.y0 * tile_width + rect.x0];
+        bool uniform = true;
+        bool any_inside = false;
+        for (int x = rect.x0; x <= rect.x1; x++) {
+            const FractalPoint& top = points[rect.y0 * tile_width + x];
+            const FractalPoint& bottom = points[rect.y1 * tile_width + x];
+            uniform = uniform && fillable(corner, top, params.smooth_coloring) &&
+                      fillable(corner, bottom, params.smooth_coloring);
+            any_inside = any_inside || top.inside_set || bottom.inside_set;
+        }
+        for (int y = rect.y0 + 1; y < rect.y1; y++) {
+            const FractalPoint& left = points[y * tile_width + rect.x0];
+            const FractalPoint& right = points[y * tile_width + rect.x1];
+            uniform = uniform && fillable(corner, left, params.smooth_coloring) &&
+                      fillable(corner, right, params.smooth_coloring);
+            any_inside = any_inside || left.inside_set || right.inside_set;
+        }
+
+        if (uniform) {
+            // Filament guard: a thin feature can slip between adjacent border
+            // samples, so the center must agree before the interior is filled
+            int cx = (rect.x0 + rect.x1) / 2;
+            int cy = (rect.y0 + rect.y1) / 2;
+            queue(cx, cy);
+            flush();
+
+            if (fillable(corner, points[cy * tile_width + cx], params.smooth_coloring)) {
+                FractalPoint fill = corner;
+                for (int y = rect.y0 + 1; y < rect.y1; y++) {
+                    for (int x = rect.x0 + 1; x < rect.x1; x++) {
+                        int index = y * tile_width + x;
+                        if (!known[index]) {
+                            known[index] = 1;
+                            points[index] = fill;
+                        }
+                    }
+                }
+                continue;
+            }
+        }
+
+        // With smooth coloring only the interior of the set is ever filled.
+        // A border that never touches the set (which is connected) leaves
+        // nothing to fill, so iterate the rest in one batch.
+        bool nothing_to_fill = params.smooth_coloring && !any_inside;
+        if (nothing_to_fill || width * height <= kDirectArea) {
+            for (int y = rect.y0 + 1; y < rect.y1; y++) {
+                for (int x = rect.x0 + 1; x < rect.x1; x++) {
+                    queue(x, y);
+                }
+            }
+            flush();
+            continue;
+        }
+
+        // Split across the longer side; both halves share the dividing line
+        if (width >= height) {
+            int mid = (rect.x0 + rect.x1) / 2;
+            pending.push_back(Rect{rect.x0, rect.y0, mid, rect.y1});
+            pending.push_back(Rect{mid, rect.y0, rect.x1, rect.y1});
+        } else {
+            int mid = (rect.y0 + rect.y1) / 2;
+            pending.push_back(Rect{rect.x0, rect.y0, rect.x1, mid});
+            pending.push_back(Rect{rect.x0, mid, rect.x1, rect.y1});
+        }
+    }
+}
+
+int FractalEngine::renderTile(int x_start, int y_start, int tile_width, int tile_height,
+                             const Viewport& viewport, const RenderParams& params,
+                             FractalType type, double julia_c_real, double julia_c_imag,
+                             uint8_t* pixels, int row_stride, IterationField* field) const {
+    TraceSpan span("renderTile", "tile", x_start, y_start, tile_width, tile_height);
+    FRACTAL_PROFILE_ONLY(profile::Scope scope(static_cast<uint64_t>(tile_width) * tile_height,
+                                              params.stats, stats_, stats_mutex_));
+    kernel::CancelScope cancel_scope(params.cancel);
+
+    // Shared, prebuilt palette and its table mapping
+    const ColorPalette& palette = ColorPalette::forParams(params);
+    double lut_scale = ColorPalette::lutScale(params);
+    double lut_offset = ColorPalette::lutOffset(params);
+
+    Precision precision = params.precision;
+    if (precision == PRECISION_AUTO) {
+        precision = selectPrecision(viewport, x_start, y_start, tile_width, tile_height);
+    }
+
+    // Anti-aliasing compares smooth values too, so keep them if the caller
+    // does not
+    bool antialias = pixels && params.antialias_samples > 1;
+    thread_local IterationField tile_field;
+    if (antialias && !field) {
+        tile_field.reset(x_start, y_start, tile_width, tile_height);
+        field = &tile_field;
+    }
+
+    if (params.subdivide) {
+        thread_local std::vector<FractalPoint> tile_points;
+        tile_points.resize(static_cast<size_t>(tile_width) * tile_height);
+        computeTileSubdivided(x_start, y_start, tile_width, tile_height, viewport, params,
+                              type, julia_c_real, julia_c_imag, precision, tile_points.data());
+
+        for (int y = 0; y < tile_height; y++) {
+            uint8_t* row = pixels ? pixels + static_cast<size_t>(y) * row_stride : nullptr;
+            storeRow(tile_points.data() + static_cast<size_t>(y) * tile_width, tile_width,
+                     palette, params, lut_scale, lut_offset, row, field, x_start, y_start + y);
+        }
+    } else {
+        // Render one row at a time so the SIMD kernels see contiguous pixels
+        thread_local std::vector<FractalPoint> row_points;
+        thread_local std::vector<double> row_orbit_real, row_orbit_imag;
+        if (static_cast<int>(row_points.size()) < tile_width) {
+            row_points.resize(tile_width);
+            row_orbit_real.resize(tile_width);
+            row_orbit_imag.resize(tile_width);
+        }
+        bool keep_orbits = field && field->keep_orbits;
+
+        for (int y = 0; y < tile_height; y++) {
+            computeRow(x_start, y_start + y, tile_width, viewport, params, type,
+                       julia_c_real, julia_c_imag, precision, row_points.data(),
+                       keep_orbits ? row_orbit_real.data() : nullptr, row_orbit_imag.data());
+
+            uint8_t* row = pixels ? pixels + static_cast<size_t>(y) * row_stride : nullptr;
+            storeRow(row_points.data(), tile_width, palette, params, lut_scale, lut_offset, row,
+                     field, x_start, y_start + y,
+                     keep_orbits ? row_orbit_real.data() : nullptr, row_orbit_imag.data());
+        }
+    }
+
+    if (!antialias) {
+        return 0;
+    }
+    return antialiasTile(x_start, y_start, tile_width, tile_height, viewport, params, type,
+                         julia_c_real, julia_c_imag, *field, pixels, row_stride);
+}
+
+void FractalEngine::continueTile(int x_start, int y_start, int tile_width, int tile_height,
+                                const Viewport& viewport, const RenderParams& params,
+                                FractalType type, double julia_c_real, double julia_c_imag,
+                                IterationField& field, uint8_t* pixels, int row_stride) const {
+    TraceSpan span("continueTile", "tile", x_start, y_start, tile_width, tile_height);
+    span.setValue("max_iterations", params.max_iterations);
+    FRACTAL_PROFILE_ONLY(profile::Scope scope(static_cast<uint64_t>(tile_width) * tile_height,
+                                              params.stats, stats_, stats_mutex_));
+    kernel::CancelScope cancel_scope(params.cancel);
+    continueSamples(x_start, y_start, tile_width, tile_height, 1, viewport, params, type,
+                    julia_c_real, julia_c_imag, field);
+
+    if (pixels) {
+        recolorTile(field, x_start, y_start, tile_width, tile_height, params, pixels, row_stride);
+    }
+}
+
+int FractalEngine::renderTileProgressive(int x_start, int y_start, int tile_width,
+                                        int tile_height, const Viewport& viewport,
+                                        const RenderParams& params, FractalType type,
+                                        double julia_c_real, double julia_c_imag,
+                                        int step, int previous_step, IterationField& field,
+                                        uint8_t* pixels, int row_stride,
+                                        bool incremental) const {
+    TraceSpan span("renderPass", "tile", x_start, y_start, tile_width, tile_height);
+    span.setValue("step", step);
+    FRACTAL_PROFILE_ONLY(profile::Scope scope(static_cast<uint64_t>(tile_width) * tile_height,
+                                              params.stats, stats_, stats_mutex_));
+    kernel::CancelScope cancel_scope(params.cancel);
+    int x_end = x_start + tile_width;
+    int y_end = y_start + tile_height;
+    int x_first = (x_start + step - 1) / step * step;
+    int y_first = (y_start + step - 1) / step * step;
+
+    // Earlier passes' samples only need the new limit. Their blocks already
+    // hold their color when drawing incrementally, unless they escape now.
+    thread_local std::vector<int> held_x, held_y;
+    held_x.clear();
+    held_y.clear();
+    if (previous_step > 0) {
+        if (incremental && pixels) {
+            int x_held = (x_start + previous_step - 1) / previous_step * previous_step;
+            int y_held = (y_start + previous_step - 1) / previous_step * previous_step;
+            for (int y = y_held; y < y_end; y += previous_step) {
+                for (int x = x_held; x < x_end; x += previous_step) {
+                    if (field.inside_set[field.indexOf(x, y)]) {
+                        held_x.push_back(x);
+                        held_y.push_back(y);
+                    }
+                }
+            }
+        }
+        continueSamples(x_start, y_start, tile_width, tile_height, previous_step, viewport,
+                        params, type, julia_c_real, julia_c_imag, field);
+    }
+
+    // Samples new to this grid, all in one batch so the SIMD lanes stay full:
+    // whole rows where the previous grid has none, else the columns between
+    // its samples
+    Precision precision = params.precision;
+    if (precision == PRECISION_AUTO) {
+        precision = selectPrecision(viewport, x_start, y_start, tile_width, tile_height);
+    }
+    thread_local std::vector<int> batch_x, batch_y;
+    thread_local std::vector<FractalPoint> batch_points;
+    thread_local std::vector<double> batch_orbit_real, batch_orbit_imag;
+    size_t grid_size = static_cast<size_t>((x_end - x_first + step - 1) / step) *
+                       ((y_end - y_first + step - 1) / step);
+    if (batch_x.size() < grid_size) {
+        batch_x.resize(grid_size);
+        batch_y.resize(grid_size);
+        batch_points.resize(grid_size);
+        batch_orbit_real.resize(grid_size);
+        batch_orbit_imag.resize(grid_size);
+    }
+    int count = 0;
+    for (int y = y_first; y < y_end; y += step) {
+        bool held_row = previous_step > 0 && y % previous_step == 0;
+        for (int x = x_first; x < x_end; x += step) {
+            if (held_row && x % previous_step == 0) {
+                continue;
+            }
+            batch_x[count] = x;
+            batch_y[count] = y;
+            count++;
+        }
+    }
+    computePixels(batch_x.data(), batch_y.data(), count, viewport, params, type, julia_c_real,
+                  julia_c_imag, precision, batch_points.data(), batch_orbit_real.data(),
+                  batch_orbit_imag.data());
+
+    // Only inside points' orbits are ever read back
+    for (int i = 0; i < count; i++) {
+        size_t index = field.indexOf(batch_x[i], batch_y[i]);
+        field.smooth_values[index] = static_cast<float>(batch_points[i].smooth_value);
+        field.inside_set[index] = batch_points[i].inside_set ? 1 : 0;
+        if (field.keep_orbits && batch_points[i].inside_set) {
+            field.orbit_real[index] = batch_orbit_real[i];
+            field.orbit_imag[index] = batch_orbit_imag[i];
+        }
+    }
+
+    if (!pixels) {
+        return 0;
+    }
+
+    // Each sample colors the step x step block below and to its right, with
+    // one palette lookup per block
+    FRACTAL_PROFILE_ONLY(profile::Timer timer(&RenderStats::color_ms));
+    const ColorPalette& palette = ColorPalette::forParams(params);
+    double lut_scale = ColorPalette::lutScale(params);
+    double lut_offset = ColorPalette::lutOffset(params);
+    auto colorOf = [&](int sample_x, int sample_y) {
+        size_t index = field.indexOf(sample_x, sample_y);
+        return palette.lookup(ColorPalette::colorValue(params, field.smooth_values[index]),
+                              field.inside_set[index] != 0, lut_scale, lut_offset);
+    };
+    auto fillBlock = [&](int sample_x, int sample_y, const Color& color) {
+        int block_width = std::min(step, x_end - sample_x);
+        int block_height = std::min(step, y_end - sample_y);
+        uint8_t* top = pixels + static_cast<size_t>(sample_y - y_start) * row_stride +
+                       (sample_x - x_start) * 4;
+        const uint8_t rgba[4] = {color.r, color.g, color.b, color.a};
+        for (int x = 0; x < block_width; x++) {
+            std::memcpy(top + x * 4, rgba, 4);
+        }
+        for (int y = 1; y < block_height; y++) {
+            std::memcpy(top + static_cast<size_t>(y) * row_stride, top, block_width * 4);
+        }
+    };
+
+    // Color the top pixel row of each grid row's blocks, then copy it down.
+    // Incrementally the earlier samples' blocks keep their color; they are
+    // uniform, so copying whole rows down leaves them unchanged.
+    bool recolor_held = !incremental || previous_step == 0;
+    for (int y = y_first; y < y_end; y += step) {
+        bool held_row = previous_step > 0 && y % previous_step == 0;
+        uint8_t* top = pixels + static_cast<size_t>(y - y_start) * row_stride;
+        for (int x = x_first; x < x_end; x += step) {
+            if (held_row && !recolor_held && x % previous_step == 0) {
+                continue;
+            }
+            Color color = colorOf(x, y);
+            const uint8_t rgba[4] = {color.r, color.g, color.b, color.a};
+            for (int pixel = x; pixel < std::min(x + step, x_end); pixel++) {
+                std::memcpy(top + (pixel - x_start) * 4, rgba, 4);
+            }
+        }
+        for (int row = 1; row < std::min(step, y_end - y); row++) {
+            std::memcpy(top + static_cast<size_t>(row) * row_stride, top, tile_width * 4);
+        }
+    }
+    for (size_t i = 0; i < held_x.size(); i++) {
+        if (!field.inside_set[field.indexOf(held_x[i], held_y[i])]) {
+            fillBlock(held_x[i], held_y[i], colorOf(held_x[i], held_y[i]));
+        }
+    }
+
+    if (step > 1 || params.antialias_samples <= 1) {
+        return 0;
+    }
+    return antialiasTile(x_start, y_start, tile_width, tile_height, viewport, params, type,
+                         julia_c_real, julia_c_imag, field, pixels, row_stride);
+}
+
+int FractalEngine::antialiasTile(int x_start, int y_start, int tile_width, int tile_height,
+                                 const Viewport& viewport, const RenderParams& params,
+                                 FractalType type, double julia_c_real, double julia_c_imag,
+                                 const IterationField& field, uint8_t* pixels,
+                                 int row_stride) const {
+    TraceSpan span("antialias", "tile", x_start, y_start, tile_width, tile_height);
+
+    // Finest stratification: grid x grid samples per pixel
+    int grid = 1;
+    while (grid * grid * 4 <= params.antialias_samples) {
+        grid *= 2;
+    }
+    if (grid < 2) {
+        return 0;
+    }
+
+    const ColorPalette& palette = ColorPalette::forParams(params);
+    double lut_scale = ColorPalette::lutScale(params);
+    double lut_offset = ColorPalette::lutOffset(params);
+    auto colorOf = [&](const FractalPoint& point) {
+        return palette.lookup(ColorPalette::colorValue(params, point.smooth_value),
+                              point.inside_set, lut_scale, lut_offset);
+    };
+
+    // Palette table position, infinite inside the set: a smooth value that
+    // changes faster than the colors show (the palette may come back to a
+    // similar color) still marks detail between the samples
+    double position_threshold = params.antialias_threshold / 12.0;
+    auto positionOf = [&](double smooth_value, bool inside_set) {
+        return inside_set ? std::numeric_limits<double>::infinity()
+                          : ColorPalette::colorValue(params, smooth_value) * lut_scale;
+    };
+
+    Precision precision = params.precision;
+    if (precision == PRECISION_AUTO) {
+        precision = selectPrecision(viewport, x_start - 1, y_start - 1, tile_width + 2,
+                                    tile_height + 2);
+    }
+
+    thread_local std::vector<int> sample_x, sample_y, sample_owner;
+    thread_local std::vector<double> offset_x, offset_y;
+    thread_local std::vector<FractalPoint> sample_points;
+    auto runSamples = [&]() {
+        int count = static_cast<int>(sample_x.size());
+        sample_points.resize(count);
+        computePixels(sample_x.data(), sample_y.data(), count, viewport, params, type,
+                      julia_c_real, julia_c_imag, precision, sample_points.data(), nullptr,
+                      nullptr, offset_x.empty() ? nullptr : offset_x.data(),
+                      offset_y.empty() ? nullptr : offset_y.data());
+    };
+
+    // One-sample colors and positions of the tile plus a one-pixel apron, so
+    // that pixels on the tile's edge are judged against neighbors in other
+    // tiles
+    int apron_width = tile_width + 2;
+    thread_local std::vector<Color> colors;
+    thread_local std::vector<double> positions;
+    colors.resize(static_cast<size_t>(apron_width) * (tile_height + 2));
+    positions.resize(colors.size());
+    sample_x.clear();
+    sample_y.clear();
+    sample_owner.clear();
+    offset_x.clear();
+    offset_y.clear();
+    for (int y = -1; y <= tile_height; y++) {
+        for (int x = -1; x <= tile_width; x++) {
+            size_t index = static_cast<size_t>(y + 1) * apron_width + (x + 1);
+            if (x >= 0 && x < tile_width && y >= 0 && y < tile_height) {
+                const uint8_t* pixel = pixels + static_cast<size_t>(y) * row_stride + x * 4;
+                size_t field_index = field.indexOf(x_start + x, y_start + y);
+                colors[index] = Color(pixel[0], pixel[1], pixel[2], pixel[3]);
+                positions[index] = positionOf(field.smooth_values[field_index],
+                                              field.inside_set[field_index] != 0);
+                continue;
+            }
+            // Outside the frame the edge pixel stands in for its neighbor
+            int frame_x = std::min(std::max(x_start + x, 0), viewport.width - 1);
+            int frame_y = std::min(std::max(y_start + y, 0), viewport.height - 1);
+            sample_x.push_back(frame_x);
+            sample_y.push_back(frame_y);
+            sample_owner.push_back(static_cast<int>(index));
+        }
+    }
+    runSamples();
+    for (size_t i = 0; i < sample_owner.size(); i++) {
+        colors[sample_owner[i]] = colorOf(sample_points[i]);
+        positions[sample_owner[i]] = positionOf(sample_points[i].smooth_value,
+                                                sample_points[i].inside_set);
+    }
+
+    // Pixels that differ from any of their 8 neighbors
+    struct Candidate {
+        int x, y;       // In the tile
+        int r, g, b;    // Sums over the subsamples so far
+        int count;
+        Color low, high;
+        double position_low, position_high;
+    };
+    thread_local std::vector<Candidate> candidates;
+    candidates.clear();
     for (int y = 0; y < tile_height; y++) {
         for (int x = 0; x < tile_width; x++) {
-            // Convert screen coordinates to complex plane
-            double complex_real, complex_imag;
-            screenToComplex(x_start + x, y_start + y, viewport,
-                          complex_real, complex_imag);
-
-            // Compute fractal
-            FractalPoint point;
-            if (type == MANDELBROT) {
-                point = computeMandelbrot(complex_real, complex_imag, params);
+            size_t center = static_cast<size_t>(y + 1) * apron_width + x + 1;
+            bool edge = false;
+            for (int dy = -1; dy <= 1 && !edge; dy++) {
+                for (int dx = -1; dx <= 1 && !edge; dx++) {
+                    size_t neighbor = center + dy * apron_width + dx;
+                    edge = colorDistance(colors[center], colors[neighbor]) >
+                               params.antialias_threshold ||
+                           std::abs(positions[center] - positions[neighbor]) >
+                               position_threshold;
+                }
+            }
+            if (edge) {
+                candidates.push_back(Candidate{x, y, 0, 0, 0, 0, Color(255, 255, 255),
+                                               Color(0, 0, 0),
+                                               std::numeric_limits<double>::infinity(),
+                                               -std::numeric_limits<double>::infinity()});
+            }
+        }
+    }
+
+    // Nested stratified sampling: at level n a pixel has one jittered sample
+    // per cell of an n x n grid. Each cell's sample lies in one of its four
+    // children's at level 2n, so refining reuses every earlier sample and
+    // the finest level is a plain jittered grid x grid supersample.
+    auto finestCell = [&](int px, int py, int level, int& i, int& j) {
+        for (; level < grid; level *= 2) {
+            uint32_t child = hashSample(px, py, level, i, j) & 3;
+            i = 2 * i + static_cast<int>(child & 1);
+            j = 2 * j + static_cast<int>(child >> 1);
+        }
+    };
+
+    int added = 0;
+    thread_local std::vector<int> active;
+    active.resize(candidates.size());
+    for (size_t i = 0; i < candidates.size(); i++) {
+        active[i] = static_cast<int>(i);
+    }
+
+    for (int level = 2; level <= grid && !active.empty(); level *= 2) {
+        sample_x.clear();
+        sample_y.clear();
+        sample_owner.clear();
+        offset_x.clear();
+        offset_y.clear();
+        for (int owner : active) {
+            const Candidate& candidate = candidates[owner];
+            int px = x_start + candidate.x;
+            int py = y_start + candidate.y;
+            for (int j = 0; j < level; j++) {
+                for (int i = 0; i < level; i++) {
+                    // Skip cells whose sample the coarser level already took
+                    if (level > 2) {
+                        uint32_t child = hashSample(px, py, level / 2, i / 2, j / 2) & 3;
+                        if ((i & 1) == static_cast<int>(child & 1) &&
+                            (j & 1) == static_cast<int>(child >> 1)) {
+                            continue;
+                        }
+                    }
+                    int u = i;
+                    int v = j;
+                    finestCell(px, py, level, u, v);
+                    uint32_t jitter = hashSample(px, py, 0, u, v);
+                    sample_x.push_back(px);
+                    sample_y.push_back(py);
+                    sample_owner.push_back(owner);
+                    offset_x.push_back((u + (jitter & 0xffff) / 65536.0) / grid - 0.5);
+                    offset_y.push_back((v + (jitter >> 16) / 65536.0) / grid - 0.5);
+                }
+            }
+        }
+        runSamples();
+        added += static_cast<int>(sample_x.size());
+
+        for (size_t k = 0; k < sample_owner.size(); k++) {
+            Candidate& candidate = candidates[sample_owner[k]];
+            Color color = colorOf(sample_points[k]);
+            double position = positionOf(sample_points[k].smooth_value,
+                                         sample_points[k].inside_set);
+            candidate.r += color.r;
+            candidate.g += color.g;
+            candidate.b += color.b;
+            candidate.count++;
+            candidate.low = Color(std::min(candidate.low.r, color.r),
+                                  std::min(candidate.low.g, color.g),
+                                  std::min(candidate.low.b, color.b));
+            candidate.high = Color(std::max(candidate.high.r, color.r),
+                                   std::max(candidate.high.g, color.g),
+                                   std::max(candidate.high.b, color.b));
+            candidate.position_low = std::min(candidate.position_low, position);
+            candidate.position_high = std::max(candidate.position_high, position);
+        }
+
+        // Write the average; pixels whose samples still disagree refine
+        size_t kept = 0;
+        for (int owner : active) {
+            const Candidate& candidate = candidates[owner];
+            uint8_t* pixel = pixels + static_cast<size_t>(candidate.y) * row_stride +
+                             candidate.x * 4;
+            int half = candidate.count / 2;
+            pixel[0] = static_cast<uint8_t>((candidate.r + half) / candidate.count);
+            pixel[1] = static_cast<uint8_t>((candidate.g + half) / candidate.count);
+            pixel[2] = static_cast<uint8_t>((candidate.b + half) / candidate.count);
+            pixel[3] = 255;
+            if (colorDistance(candidate.low, candidate.high) > params.antialias_threshold ||
+                candidate.position_high - candidate.position_low > position_threshold) {
+                active[kept++] = owner;
+            }
+        }
+        active.resize(kept);
+    }
+    span.setValue("samples", added);
+    return added;
+}
+
+void FractalEngine::continueSamples(int x_start, int y_start, int tile_width, int tile_height,
+                                   int step, const Viewport& viewport,
+                                   const RenderParams& params, FractalType type,
+                                   double julia_c_real, double julia_c_imag,
+                                   IterationField& field) const {
+    Precision precision = params.precision;
+    if (precision == PRECISION_AUTO) {
+        precision = selectPrecision(viewport, x_start, y_start, tile_width, tile_height);
+    }
+    double cycle_tolerance = params.periodicity_check ? cycleTolerance(viewport) : 0.0;
+
+    // Sort the tile's inside pixels: decided ones only take the new limit,
+    // recorded orbits are continued (grouped by the limit they stopped at),
+    // the rest are recomputed from the start
+    struct Resume {
+        int start;
+        size_t index;
+        int screen_x, screen_y;
+    };
+    thread_local std::vector<Resume> resumes;
+    thread_local std::vector<int> restart_x, restart_y;
+    thread_local std::vector<size_t> restart_index;
+    resumes.clear();
+    restart_x.clear();
+    restart_y.clear();
+    restart_index.clear();
+
+    for (int y = (y_start + step - 1) / step * step; y < y_start + tile_height; y += step) {
+        for (int x = (x_start + step - 1) / step * step; x < x_start + tile_width; x += step) {
+            size_t index = field.indexOf(x, y);
+            if (!field.inside_set[index]) {
+                continue;
+            }
+            int start = static_cast<int>(field.smooth_values[index]);
+            double orbit = field.keep_orbits ? field.orbit_real[index] : kOrbitUnrecorded;
+            if (std::isnan(orbit) || start >= params.max_iterations) {
+                field.smooth_values[index] = static_cast<float>(params.max_iterations);
+            } else if (std::isinf(orbit) || precision == PRECISION_DOUBLE_DOUBLE) {
+                restart_x.push_back(x);
+                restart_y.push_back(y);
+                restart_index.push_back(index);
+            } else {
+                resumes.push_back(Resume{start, index, x, y});
+            }
+        }
+    }
+
+    auto store = [&](size_t index, const FractalPoint& point, double orbit_real,
+                     double orbit_imag) {
+        field.smooth_values[index] = static_cast<float>(point.smooth_value);
+        field.inside_set[index] = point.inside_set ? 1 : 0;
+        if (field.keep_orbits) {
+            field.orbit_real[index] = orbit_real;
+            field.orbit_imag[index] = orbit_imag;
+        }
+    };
+
+    thread_local std::vector<FractalPoint> batch_points;
+    thread_local std::vector<double> batch_real, batch_imag;
+    int hits = 0;
+
+    if (!restart_index.empty()) {
+        int count = static_cast<int>(restart_index.size());
+        batch_points.resize(count);
+        batch_real.resize(count);
+        batch_imag.resize(count);
+        computePixels(restart_x.data(), restart_y.data(), count, viewport, params, type,
+                      julia_c_real, julia_c_imag, precision, batch_points.data(),
+                      batch_real.data(), batch_imag.data());
+        for (int i = 0; i < count; i++) {
+            store(restart_index[i], batch_points[i], batch_real[i], batch_imag[i]);
+        }
+    }
+
+    std::stable_sort(resumes.begin(), resumes.end(),
+                     [](const Resume& a, const Resume& b) { return a.start < b.start; });
+
+    thread_local std::vector<double> c_real, c_imag;
+    thread_local std::vector<float> c_real_f, c_imag_f, z_real_f, z_imag_f;
+    const FamilyKernels& kernels = familyKernels(type);
+    FRACTAL_PROFILE_ONLY(profile::Timer timer(&RenderStats::iterate_ms));
+    for (size_t first = 0; first < resumes.size();) {
+        size_t last = first;
+        while (last < resumes.size() && resumes[last].start == resumes[first].start) {
+            last++;
+        }
+        int count = static_cast<int>(last - first);
+        int start = resumes[first].start;
+
+        // Same coordinates as computePixels, so continuing matches a full
+        // render at the new limit (up to the cycle check, which restarts)
+        c_real.resize(count);
+        c_imag.resize(count);
+        batch_real.resize(count);
+        batch_imag.resize(count);
+        batch_points.resize(count);
+        for (int i = 0; i < count; i++) {
+            const Resume& resume = resumes[first + i];
+            if (!kernels.julia) {
+                screenToComplex(resume.screen_x, resume.screen_y, viewport, c_real[i], c_imag[i]);
             } else {
-                point = computeJulia(complex_real, complex_imag,
-                                    julia_c_real, julia_c_imag, params);
+                c_real[i] = julia_c_real;
+                c_imag[i] = julia_c_imag;
+            }
+            batch_real[i] = field.orbit_real[resume.index];
+            batch_imag[i] = field.orbit_imag[resume.index];
+        }
+
+        if (precision == PRECISION_FLOAT) {
+            c_real_f.assign(c_real.begin(), c_real.end());
+            c_imag_f.assign(c_imag.begin(), c_imag.end());
+            z_real_f.assign(batch_real.begin(), batch_real.end());
+            z_imag_f.assign(batch_imag.begin(), batch_imag.end());
+            hits += kernels.continue_float(
+                c_real_f.data(), c_imag_f.data(), z_real_f.data(), z_imag_f.data(), count,
+                start, params.max_iterations, params.bailout_radius, params.smooth_coloring,
+                cycle_tolerance, batch_points.data());
+            batch_real.assign(z_real_f.begin(), z_real_f.end());
+            batch_imag.assign(z_imag_f.begin(), z_imag_f.end());
+        } else {
+            hits += kernels.continue_double(
+                c_real.data(), c_imag.data(), batch_real.data(), batch_imag.data(), count,
+                start, params.max_iterations, params.bailout_radius, params.smooth_coloring,
+                cycle_tolerance, batch_points.data());
+        }
+
+        for (int i = 0; i < count; i++) {
+            store(resumes[first + i].index, batch_points[i], batch_real[i], batch_imag[i]);
+        }
+        first = last;
+    }
+
+    if (cycle_tolerance > 0.0) {
+        cycle_points_.fetch_add(resumes.size(), std::memory_order_relaxed);
+        cycle_hits_.fetch_add(hits, std::memory_order_relaxed);
+    }
+}
+
+void FractalEngine::renderTileDeep(int x_start, int y_start, int tile_width, int tile_height,
+                                  const DeepViewport& viewport, const RenderParams& params,
+                                  std::vector<uint8_t>& pixel_buffer) const {
+    pixel_buffer.resize(tile_width * tile_height * 4);  // RGBA
+
+    renderTileDeep(x_start, y_start, tile_width, tile_height, viewport, params,
+                   pixel_buffer.data(), tile_width * 4);
+}
+
+void FractalEngine::renderTileDeep(int x_start, int y_start, int tile_width, int tile_height,
+                                  const DeepViewport& viewport, const RenderParams& params,
+                                  uint8_t* pixels, int row_stride, IterationField* field) const {
+    TraceSpan span("renderTileDeep", "tile", x_start, y_start, tile_width, tile_height);
+    FRACTAL_PROFILE_ONLY(profile::Scope scope(static_cast<uint64_t>(tile_width) * tile_height,
+                                              params.stats, stats_, stats_mutex_));
+    kernel::CancelScope cancel_scope(params.cancel);
+
+    // Fetch or build the reference orbit for this view
+    std::shared_ptr<const ReferenceOrbit> reference;
+    {
+        std::lock_guard<std::mutex> lock(reference_mutex_);
+        int limbs = BigFixed::limbsForScale(viewport.scale);
+        if (!reference_orbit_ || !reference_orbit_->matches(viewport, limbs, params)) {
+            reference_orbit_ = Perturbation::computeReference(viewport, params);
+        }
+        reference = reference_orbit_;
+    }
+
+    if (!reference) {
+        // Unparseable center
+        for (int y = 0; pixels && y < tile_height; y++) {
+            std::fill_n(pixels + static_cast<size_t>(y) * row_stride, tile_width * 4, 0);
+        }
+        for (int y = 0; field && y < tile_height; y++) {
+            size_t base = field->indexOf(x_start, y_start + y);
+            std::fill_n(field->smooth_values.begin() + base, tile_width, 0.0f);
+            std::fill_n(field->inside_set.begin() + base, tile_width, 1);
+        }
+        return;
+    }
+
+    const ColorPalette& palette = ColorPalette::forParams(params);
+    double lut_scale = ColorPalette::lutScale(params);
+    double lut_offset = ColorPalette::lutOffset(params);
+
+    thread_local std::vector<FractalPoint> row_points;
+    if (static_cast<int>(row_points.size()) < tile_width) {
+        row_points.resize(tile_width);
+    }
+
+    int rebases = 0;
+    for (int y = 0; y < tile_height; y++) {
+        // Offsets from the center keep full double precision at any depth
+        double dc_imag = (y_start + y - viewport.height / 2.0) * viewport.scale;
+        {
+            FRACTAL_PROFILE_ONLY(profile::Timer timer(&RenderStats::iterate_ms));
+            for (int x = 0; x < tile_width; x++) {
+                double dc_real = (x_start + x - viewport.width / 2.0) * viewport.scale;
+
+                row_points[x] = Perturbation::compute(*reference, dc_real, dc_imag,
+                                                      params.max_iterations,
+                                                      params.bailout_radius,
+                                                      params.smooth_coloring, rebases);
+                FRACTAL_PROFILE_ONLY(profile::countPoint(row_points[x].iterations,
+                                                         row_points[x].iterations,
+                                                         !row_points[x].inside_set));
             }
+        }
+
+        uint8_t* row = pixels ? pixels + static_cast<size_t>(y) * row_stride : nullptr;
+        storeRow(row_points.data(), tile_width, palette, params, lut_scale, lut_offset, row,
+                 field, x_start, y_start + y);
+    }
+    span.setValue("rebases", rebases);
+}
 
-            // Get color
-            Color color = palette.getColor(point.smooth_value, params.max_iterations);
+void FractalEngine::recolorTile(const IterationField& field, int x_start, int y_start,
+                               int tile_width, int tile_height, const RenderParams& params,
+                               uint8_t* pixels, int row_stride) {
+    TraceSpan span("recolorTile", "tile", x_start, y_start, tile_width, tile_height);
+    FRACTAL_PROFILE_ONLY(profile::Timer timer(&RenderStats::color_ms));
+    const ColorPalette& palette = ColorPalette::forParams(params);
+    double lut_scale = ColorPalette::lutScale(params);
+    double lut_offset = ColorPalette::lutOffset(params);
+
+    for (int y = 0; y < tile_height; y++) {
+        size_t base = field.indexOf(x_start, y_start + y);
+        const float* smooth = field.smooth_values.data() + base;
+        const uint8_t* inside = field.inside_set.data() + base;
+        uint8_t* row = pixels + static_cast<size_t>(y) * row_stride;
 
-            // Write to buffer
-            int offset = (y * tile_width + x) * 4;
-            pixel_buffer[offset + 0] = color.r;
-            pixel_buffer[offset + 1] = color.g;
-            pixel_buffer[offset + 2] = color.b;
-            pixel_buffer[offset + 3] = color.a;
+        for (int x = 0; x < tile_width; x++) {
+            Color color = palette.lookup(ColorPalette::colorValue(params, smooth[x]),
+                                         inside[x] != 0, lut_scale, lut_offset);
+            row[x * 4 + 0] = color.r;
+            row[x * 4 + 1] = color.g;
+            row[x * 4 + 2] = color.b;
+            row[x * 4 + 3] = color.a;
         }
     }
 }
 
+void FractalEngine::recolorFrame(const IterationField& field, const RenderParams& params,
+                                std::vector<uint8_t>& frame_buffer) {
+    frame_buffer.resize(static_cast<size_t>(field.width) * field.height * 4);  // RGBA
+
+    recolorTile(field, field.origin_x, field.origin_y, field.width, field.height, params,
+                frame_buffer.data(), field.width * 4);
+}
+
 } // namespace fractal
@@ -1,11 +1,20 @@
 #ifndef FRACTAL_ENGINE_H
 #define FRACTAL_ENGINE_H
 
+#include "render_stats.h"
+#include <atomic>
 #include <cstdint>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <string>
 #include <vector>
 
 namespace fractal {
 
+class ColorHistogram;
+class ColorPalette;
+
 // Viewport represents the visible region in the complex plane
 struct Viewport {
     double center_x;
@@ -19,21 +28,82 @@ struct Viewport {
         : center_x(cx), center_y(cy), scale(s), width(w), height(h) {}
 };
 
+// Viewport whose center is given as decimal strings, for zooms past the
+// ~1e-13 scale where double-precision pixel coordinates run out. Scale stays
+// a double: perturbation deltas are fine down to roughly 1e-290.
+struct DeepViewport {
+    std::string center_x;
+    std::string center_y;
+    double scale;  // Units per pixel
+    int width;
+    int height;
+
+    DeepViewport() : center_x("-0.5"), center_y("0"), scale(0.004), width(800), height(600) {}
+    DeepViewport(const std::string& cx, const std::string& cy, double s, int w, int h)
+        : center_x(cx), center_y(cy), scale(s), width(w), height(h) {}
+};
+
+// Numeric type used for per-pixel iteration. With PRECISION_AUTO the engine
+// picks the cheapest tier that resolves the tile (see selectPrecision).
+enum Precision {
+    PRECISION_AUTO = -1,
+    PRECISION_FLOAT = 0,          // float32, twice the SIMD lanes of double
+    PRECISION_DOUBLE = 1,
+    PRECISION_DOUBLE_DOUBLE = 2   // ~106-bit, scalar
+};
+
 // Render parameters
 struct RenderParams {
     int max_iterations;
     double bailout_radius;
     bool smooth_coloring;
     int palette_id;
+    const ColorPalette* palette;  // Used instead of palette_id when set (not owned)
+    double color_offset;  // Palette shift, in palette cycles
+    double color_speed;   // Palette cycles per max_iterations
+    int color_iterations; // Limit the palette is scaled to, 0 for max_iterations
+    const ColorHistogram* color_histogram;  // Equalized coloring when set (finalized)
+    Precision precision;
+    bool subdivide;       // Mariani-Silver: fill rectangles with a uniform border
+    bool periodicity_check;  // Stop orbits that settle into a cycle (inside points)
+
+    // Adaptive anti-aliasing (off at <= 1): pixels whose color differs from
+    // a neighbor's by more than antialias_threshold (|dR| + |dG| + |dB|), or
+    // whose palette position does by more than antialias_threshold / 12 of
+    // the palette's 4096 table entries, get jittered, stratified
+    // subsamples, refined 4 -> 16 -> 64 while they still disagree, up to
+    // antialias_samples per pixel
+    int antialias_samples;
+    int antialias_threshold;
+
+    // Receives the counters of each render call made with these params
+    // (profiling builds only). Not synchronized: give each thread its own.
+    RenderStats* stats;
+
+    // Render calls stop early once this is set: the kernels poll it every
+    // kernel::kCancelInterval iterations and report the points still
+    // running as stopped by the limit. The output of a cancelled call is
+    // incomplete and should be discarded.
+    const std::atomic<bool>* cancel;
 
     RenderParams() : max_iterations(1000), bailout_radius(4.0),
-                     smooth_coloring(true), palette_id(0) {}
+                     smooth_coloring(true), palette_id(0), palette(nullptr),
+                     color_offset(0.0),
+                     color_speed(1.0), color_iterations(0), color_histogram(nullptr),
+                     precision(PRECISION_AUTO), subdivide(false), periodicity_check(true),
+                     antialias_samples(1), antialias_threshold(48), stats(nullptr),
+                     cancel(nullptr) {}
 };
 
-// Fractal type
+// Fractal type; the kernels of each are listed in fractal_family.cpp
 enum FractalType {
     MANDELBROT = 0,
-    JULIA = 1
+    JULIA = 1,
+    BURNING_SHIP = 2,
+    TRICORN = 3,
+    MULTIBROT_3 = 4,   // z^3 + c
+    MULTIBROT_4 = 5,   // z^4 + c
+    FRACTAL_TYPE_COUNT
 };
 
 // Fractal point result
@@ -45,6 +115,48 @@ struct FractalPoint {
     FractalPoint() : iterations(0), smooth_value(0.0), inside_set(false) {}
 };
 
+// Per-pixel escape data retained apart from the RGBA output, so that a
+// palette, offset or speed change is a recolor pass instead of a re-render.
+// Struct-of-arrays: 5 bytes per pixel rather than a padded FractalPoint.
+// Covers the frame rectangle starting at (origin_x, origin_y).
+//
+// With keep_orbits set (before reset) the field also holds z for every pixel
+// that was stopped by max_iterations alone, whose smooth value is then that
+// limit, so a render with a higher limit can continue the orbit instead of
+// restarting it (FractalEngine::continueTile). An orbit of NaN marks a pixel
+// that is decided (escaped or known periodic), infinity one whose orbit was
+// not recorded (subdivision fill, double-double, perturbation).
+struct IterationField {
+    int origin_x;
+    int origin_y;
+    int width;
+    int height;
+    std::vector<float> smooth_values;
+    std::vector<uint8_t> inside_set;
+    bool keep_orbits;
+    std::vector<double> orbit_real;  // Empty unless keep_orbits
+    std::vector<double> orbit_imag;
+
+    IterationField() : origin_x(0), origin_y(0), width(0), height(0), keep_orbits(false) {}
+
+    void reset(int x, int y, int w, int h) {
+        origin_x = x;
+        origin_y = y;
+        width = w;
+        height = h;
+        smooth_values.assign(static_cast<size_t>(w) * h, 0.0f);
+        inside_set.assign(static_cast<size_t>(w) * h, 0);
+        size_t orbits = keep_orbits ? static_cast<size_t>(w) * h : 0;
+        orbit_real.assign(orbits, std::numeric_limits<double>::infinity());
+        orbit_imag.assign(orbits, std::numeric_limits<double>::infinity());
+    }
+
+    // Index of frame pixel (x, y)
+    size_t indexOf(int x, int y) const {
+        return static_cast<size_t>(y - origin_y) * width + (x - origin_x);
+    }
+};
+
 // Color structure
 struct Color {
     uint8_t r, g, b, a;
@@ -54,6 +166,17 @@ struct Color {
         : r(red), g(green), b(blue), a(alpha) {}
 };
 
+// Points iterated with the periodicity check on, and how many of them it
+// decided (each saving the rest of the max_iterations loop)
+struct PeriodicityStats {
+    uint64_t points;
+    uint64_t hits;
+
+    PeriodicityStats() : points(0), hits(0) {}
+};
+
+struct ReferenceOrbit;
+
 // Fractal Engine class
 class FractalEngine {
 public:
@@ -71,13 +194,167 @@ public:
                              double c_real, double c_imag,
                              const RenderParams& params) const;
 
+    // Cheapest precision tier whose rounding error stays below 1/256 of a
+    // pixel over the given tile (see fractal_engine.cpp for the bound)
+    static Precision selectPrecision(const Viewport& viewport, int x_start, int y_start,
+                                     int tile_width, int tile_height);
+
+    // Distance within which a repeating orbit counts as periodic: the same
+    // 1/256-pixel margin selectPrecision allows for rounding
+    static double cycleTolerance(const Viewport& viewport);
+
+    // The same two choices for a point spacing (units per sample) rather
+    // than a viewport: magnitude is the largest coordinate involved
+    static Precision selectPrecision(double scale, double magnitude);
+    static double cycleTolerance(double scale);
+
+    // Iterate arbitrary points center + offset[i] (e.g. polar samples) in
+    // the batch kernels. spacing is the distance between neighbouring
+    // points; it picks the precision tier (with PRECISION_AUTO) and the
+    // periodicity tolerance, as the viewport scale does for a tile.
+    // Double-double adds each offset to the center without rounding.
+    void computePoints(double center_real, double center_imag, const double* offset_real,
+                       const double* offset_imag, int count, double spacing,
+                       const RenderParams& params, FractalType type,
+                       double julia_c_real, double julia_c_imag, FractalPoint* points) const;
+
     // Render a tile
     void renderTile(int x_start, int y_start, int tile_width, int tile_height,
                    const Viewport& viewport, const RenderParams& params,
                    FractalType type, double julia_c_real, double julia_c_imag,
                    std::vector<uint8_t>& pixel_buffer) const;
 
+    // Render a tile straight into caller-owned RGBA memory. Rows are
+    // row_stride bytes apart, so a tile can be written in place into a
+    // larger frame buffer. When given, field (which must cover the tile)
+    // also receives the iteration data; pixels may then be null. Returns
+    // the anti-aliasing samples added beyond one per pixel (the field only
+    // holds the one-per-pixel data).
+    int renderTile(int x_start, int y_start, int tile_width, int tile_height,
+                   const Viewport& viewport, const RenderParams& params,
+                   FractalType type, double julia_c_real, double julia_c_imag,
+                   uint8_t* pixels, int row_stride, IterationField* field = nullptr) const;
+
+    // Raise the iteration limit of a tile already rendered into field with
+    // keep_orbits: pixels stopped by the old limit continue from their saved
+    // z and unrecorded ones are recomputed; escaped and periodic pixels are
+    // kept. Viewport, type and Julia c must match the original render and
+    // params.max_iterations must not be lower. Recolors into pixels if given.
+    // Without the periodicity check the result matches a render at the new
+    // limit exactly. With it, cycle detection restarts at the old limit, so
+    // a rare pixel whose orbit the check stops in one render but not the
+    // other can differ (about 0.001% of a Julia view in fractal_native).
+    void continueTile(int x_start, int y_start, int tile_width, int tile_height,
+                      const Viewport& viewport, const RenderParams& params,
+                      FractalType type, double julia_c_real, double julia_c_imag,
+                      IterationField& field, uint8_t* pixels, int row_stride) const;
+
+    // One pass of a progressive render into field, which must cover the
+    // tile and should keep orbits. Samples are the frame pixels whose
+    // coordinates are multiples of step; a pass computes the ones not on
+    // the previous pass's grid (previous_step, 0 for the first pass),
+    // continues those to params.max_iterations and colors each step x step
+    // block from its sample; the new samples are iterated as one batch.
+    // Passes with steps 8, 4, 2, 1 iterate about as much as one render,
+    // except that double-double samples and inside samples without a kept
+    // orbit restart from z = 0. Tile origins must be multiples of the first
+    // pass's step.
+    // The full-resolution pass is anti-aliased like renderTile and returns
+    // the samples added. With incremental, pixels already hold the tile's
+    // previous pass colored the same way (params.color_iterations fixed
+    // across passes), and only the new samples and the earlier ones that
+    // escaped in this pass are recolored.
+    int renderTileProgressive(int x_start, int y_start, int tile_width, int tile_height,
+                              const Viewport& viewport, const RenderParams& params,
+                              FractalType type, double julia_c_real, double julia_c_imag,
+                              int step, int previous_step, IterationField& field,
+                              uint8_t* pixels, int row_stride,
+                              bool incremental = false) const;
+
+    // Render a Mandelbrot tile with perturbation theory: one high-precision
+    // reference orbit per view (cached across tiles), double deltas per pixel
+    void renderTileDeep(int x_start, int y_start, int tile_width, int tile_height,
+                       const DeepViewport& viewport, const RenderParams& params,
+                       std::vector<uint8_t>& pixel_buffer) const;
+    void renderTileDeep(int x_start, int y_start, int tile_width, int tile_height,
+                       const DeepViewport& viewport, const RenderParams& params,
+                       uint8_t* pixels, int row_stride, IterationField* field = nullptr) const;
+
+    // Color a tile from retained iteration data using params' palette,
+    // offset and speed (scaled by params.max_iterations, as in renderTile)
+    static void recolorTile(const IterationField& field, int x_start, int y_start,
+                            int tile_width, int tile_height, const RenderParams& params,
+                            uint8_t* pixels, int row_stride);
+
+    // Color the whole field into frame_buffer (field.width x field.height RGBA)
+    static void recolorFrame(const IterationField& field, const RenderParams& params,
+                             std::vector<uint8_t>& frame_buffer);
+
+    // Periodicity check totals since construction or the last reset
+    PeriodicityStats periodicityStats() const;
+    void resetPeriodicityStats();
+
+    // Hot-path counters summed over every render call since construction or
+    // the last reset (all zero unless built with FRACTAL_PROFILE)
+    RenderStats renderStats() const;
+    void resetRenderStats();
+
 private:
+    mutable std::atomic<uint64_t> cycle_points_;
+    mutable std::atomic<uint64_t> cycle_hits_;
+    mutable std::mutex stats_mutex_;
+    mutable RenderStats stats_;
+
+    // Reference orbit for the most recent deep view
+    mutable std::mutex reference_mutex_;
+    mutable std::shared_ptr<const ReferenceOrbit> reference_orbit_;
+
+    // Compute one row of a tile at the given precision
+    void computeRow(int x_start, int screen_y, int count, const Viewport& viewport,
+                   const RenderParams& params, FractalType type,
+                   double julia_c_real, double julia_c_imag, Precision precision,
+                   FractalPoint* points, double* orbit_real = nullptr,
+                   double* orbit_imag = nullptr) const;
+
+    // Compute arbitrary pixels (screen_x[i], screen_y[i]) at the given
+    // precision. The orbit outputs follow IterationField's conventions.
+    // subpixel_x/y, if given, offset each point within its pixel.
+    void computePixels(const int* screen_x, const int* screen_y, int count,
+                      const Viewport& viewport, const RenderParams& params, FractalType type,
+                      double julia_c_real, double julia_c_imag, Precision precision,
+                      FractalPoint* points, double* orbit_real = nullptr,
+                      double* orbit_imag = nullptr, const double* subpixel_x = nullptr,
+                      const double* subpixel_y = nullptr) const;
+
+    // Run the float or double batch kernel over points (real[i], imag[i]);
+    // returns the periodicity check's hits
+    int iterateBatch(const double* real, const double* imag, int count,
+                     const RenderParams& params, FractalType type, double julia_c_real,
+                     double julia_c_imag, bool single_precision, double cycle_tolerance,
+                     FractalPoint* points, double* orbit_real, double* orbit_imag) const;
+
+    // Adaptive anti-aliasing of a tile already rendered at one sample per
+    // pixel, whose smooth values are in field: see
+    // RenderParams::antialias_samples. Returns the samples added.
+    int antialiasTile(int x_start, int y_start, int tile_width, int tile_height,
+                      const Viewport& viewport, const RenderParams& params, FractalType type,
+                      double julia_c_real, double julia_c_imag, const IterationField& field,
+                      uint8_t* pixels, int row_stride) const;
+
+    // continueTile for the tile's samples on the grid of spacing step
+    void continueSamples(int x_start, int y_start, int tile_width, int tile_height, int step,
+                         const Viewport& viewport, const RenderParams& params,
+                         FractalType type, double julia_c_real, double julia_c_imag,
+                         IterationField& field) const;
+
+    // Mariani-Silver subdivision of a tile into points (tile_width x
+    // tile_height): rectangle borders are iterated first and a rectangle
+    // whose border (and center) agree is filled instead of iterated
+    void computeTileSubdivided(int x_start, int y_start, int tile_width, int tile_height,
+                               const Viewport& viewport, const RenderParams& params,
+                               FractalType type, double julia_c_real, double julia_c_imag,
+                               Precision precision, FractalPoint* points) const;
+
     // Helper methods
     double computeSmoothValue(double z_real, double z_imag, int iterations,
                             int max_iterations, double bailout) const;
@@ -0,0 +1,57 @@
+#include "fractal_family.h"
+#include "escape_kernel.h"
+
+namespace fractal {
+
+namespace {
+
+template <typename Family>
+FamilyKernels makeKernels(const char* name) {
+    FamilyKernels kernels;
+    kernels.name = name;
+    kernels.julia = Family::kJulia;
+    kernels.batch_double[0] = kernel::computeBatch<Family, simd::VecD, false>;
+    kernels.batch_double[1] = kernel::computeBatch<Family, simd::VecD, true>;
+    kernels.batch_float[0] = kernel::computeBatch<Family, simd::VecF, false>;
+    kernels.batch_float[1] = kernel::computeBatch<Family, simd::VecF, true>;
+    kernels.continue_double = kernel::continueBatch<typename Family::Formula, simd::VecD>;
+    kernels.continue_float = kernel::continueBatch<typename Family::Formula, simd::VecF>;
+    kernels.point_dd[0] = kernel::computePointDD<Family, false>;
+    kernels.point_dd[1] = kernel::computePointDD<Family, true>;
+    return kernels;
+}
+
+// In FractalType order
+const FamilyKernels kFamilies[FRACTAL_TYPE_COUNT] = {
+    makeKernels<kernel::Family<kernel::Quadratic, false>>("mandelbrot"),
+    makeKernels<kernel::Family<kernel::Quadratic, true>>("julia"),
+    makeKernels<kernel::Family<kernel::BurningShip, false>>("burning-ship"),
+    makeKernels<kernel::Family<kernel::Tricorn, false>>("tricorn"),
+    makeKernels<kernel::Family<kernel::Multibrot<3>, false>>("multibrot3"),
+    makeKernels<kernel::Family<kernel::Multibrot<4>, false>>("multibrot4"),
+};
+
+} // namespace
+
+const FamilyKernels& familyKernels(FractalType type) {
+    if (type < 0 || type >= FRACTAL_TYPE_COUNT) {
+        return kFamilies[MANDELBROT];
+    }
+    return kFamilies[type];
+}
+
+const char* fractalTypeName(FractalType type) {
+    return familyKernels(type).name;
+}
+
+bool fractalTypeFromName(const std::string& name, FractalType& type) {
+    for (int i = 0; i < FRACTAL_TYPE_COUNT; i++) {
+        if (name == kFamilies[i].name) {
+            type = static_cast<FractalType>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+} // namespace fractal
@@ -0,0 +1,48 @@
+#ifndef FRACTAL_FAMILY_H
+#define FRACTAL_FAMILY_H
+
+#include "fractal_engine.h"
+#include "double_double.h"
+#include <string>
+
+namespace fractal {
+
+// The kernels of one fractal family, instantiated from the formula
+// policies in formula.h. Each coloring option has its own fully specialized
+// loop; callers pick one per batch instead of branching per pixel. Arrays
+// are indexed by smooth_coloring.
+struct FamilyKernels {
+    template <typename Scalar>
+    using Batch = int (*)(const Scalar* real, const Scalar* imag, int count,
+                          double julia_c_real, double julia_c_imag, int max_iterations,
+                          double bailout_radius, double cycle_tolerance,
+                          FractalPoint* results, Scalar* orbit_real, Scalar* orbit_imag);
+    template <typename Scalar>
+    using Continue = int (*)(const Scalar* c_real, const Scalar* c_imag, Scalar* z_real,
+                             Scalar* z_imag, int count, int start_iterations,
+                             int max_iterations, double bailout_radius, bool smooth_coloring,
+                             double cycle_tolerance, FractalPoint* results);
+    using PointDD = FractalPoint (*)(const DoubleDouble& real, const DoubleDouble& imag,
+                                     double julia_c_real, double julia_c_imag,
+                                     int max_iterations, double bailout_radius,
+                                     double cycle_tolerance, bool* periodic);
+
+    const char* name;
+    bool julia;  // Iterated over the dynamical plane, c fixed
+    Batch<double> batch_double[2];
+    Batch<float> batch_float[2];
+    Continue<double> continue_double;
+    Continue<float> continue_float;
+    PointDD point_dd[2];
+};
+
+// Kernels for a type; an unknown value gets Mandelbrot's
+const FamilyKernels& familyKernels(FractalType type);
+
+// Command-line name of a type ("mandelbrot", "burning-ship", ...) and back
+const char* fractalTypeName(FractalType type);
+bool fractalTypeFromName(const std::string& name, FractalType& type);
+
+} // namespace fractal
+
+#endif // FRACTAL_FAMILY_H
@@ -0,0 +1,116 @@
+#include "perturbation.h"
+#include "big_fixed.h"
+#include "escape_kernel.h"
+
+namespace fractal {
+
+bool ReferenceOrbit::matches(const DeepViewport& viewport, int limbs,
+                             const RenderParams& params) const {
+    return center_x == viewport.center_x && center_y == viewport.center_y &&
+           frac_limbs == limbs && max_iterations == params.max_iterations &&
+           bailout_radius == params.bailout_radius;
+}
+
+std::shared_ptr<const ReferenceOrbit> Perturbation::computeReference(
+    const DeepViewport& viewport, const RenderParams& params) {
+    int limbs = BigFixed::limbsForScale(viewport.scale);
+
+    BigFixed c_real(limbs), c_imag(limbs);
+    if (!BigFixed::fromString(viewport.center_x, limbs, c_real) ||
+        !BigFixed::fromString(viewport.center_y, limbs, c_imag)) {
+        return nullptr;
+    }
+
+    auto orbit = std::make_shared<ReferenceOrbit>();
+    orbit->center_x = viewport.center_x;
+    orbit->center_y = viewport.center_y;
+    orbit->frac_limbs = limbs;
+    orbit->max_iterations = params.max_iterations;
+    orbit->bailout_radius = params.bailout_radius;
+    orbit->z_real.reserve(params.max_iterations + 1);
+    orbit->z_imag.reserve(params.max_iterations + 1);
+    orbit->z_real.push_back(0.0);
+    orbit->z_imag.push_back(0.0);
+
+    BigFixed z_real(limbs), z_imag(limbs);
+    for (int iter = 0; iter < params.max_iterations; iter++) {
+        BigFixed z_real2 = z_real * z_real;
+        BigFixed z_imag2 = z_imag * z_imag;
+        BigFixed z_cross = z_real * z_imag;
+        z_imag = z_cross + z_cross + c_imag;
+        z_real = z_real2 - z_imag2 + c_real;
+
+        double zr = z_real.toDouble();
+        double zi = z_imag.toDouble();
+        orbit->z_real.push_back(zr);
+        orbit->z_imag.push_back(zi);
+
+        if (zr * zr + zi * zi > params.bailout_radius) {
+            break;
+        }
+    }
+
+    return orbit;
+}
+
+FractalPoint Perturbation::compute(const ReferenceOrbit& reference,
+                                   double dc_real, double dc_imag,
+                                   int max_iterations, double bailout_radius,
+                                   bool smooth_coloring, int& rebases) {
+    const double* ref_real = reference.z_real.data();
+    const double* ref_imag = reference.z_imag.data();
+    const int last = static_cast<int>(reference.z_real.size()) - 1;
+
+    // z = Z_n + dz, starting from z = 0
+    double dz_real = 0.0;
+    double dz_imag = 0.0;
+    double z_real = 0.0;
+    double z_imag = 0.0;
+    double mag2 = 0.0;
+    int n = 0;
+
+    int iter = 0;
+    while (mag2 <= bailout_radius && iter < max_iterations) {
+        if (iter % kernel::kCancelInterval == 0 && kernel::cancelled()) {
+            iter = max_iterations;
+            break;
+        }
+
+        // Reference exhausted (it escaped first): continue from Z_0 = 0
+        if (n == last) {
+            dz_real = z_real;
+            dz_imag = z_imag;
+            n = 0;
+            rebases++;
+        }
+
+        // dz' = 2 Z dz + dz^2 + dc = (2Z + dz) dz + dc
+        double t_real = 2.0 * ref_real[n] + dz_real;
+        double t_imag = 2.0 * ref_imag[n] + dz_imag;
+        double new_real = t_real * dz_real - t_imag * dz_imag + dc_real;
+        double new_imag = t_real * dz_imag + t_imag * dz_real + dc_imag;
+        dz_real = new_real;
+        dz_imag = new_imag;
+        n++;
+        iter++;
+
+        z_real = ref_real[n] + dz_real;
+        z_imag = ref_imag[n] + dz_imag;
+        mag2 = z_real * z_real + z_imag * z_imag;
+
+        // Glitch guard: once |z| < |dz| the delta has lost its precision
+        // advantage, so rebase so that the delta is z itself
+        if (mag2 < dz_real * dz_real + dz_imag * dz_imag) {
+            dz_real = z_real;
+            dz_imag = z_imag;
+            n = 0;
+            rebases++;
+        }
+    }
+
+    FractalPoint result;
+    kernel::finishPoint(iter, mag2, max_iterations, smooth_coloring, result);
+    return result;
+}
+
+} // namespace fractal
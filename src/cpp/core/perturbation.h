@@ -0,0 +1,48 @@
+#ifndef PERTURBATION_H
+#define PERTURBATION_H
+
+#include "fractal_engine.h"
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace fractal {
+
+// High-precision Mandelbrot orbit of the view center, rounded to double.
+// Every pixel is then iterated as a small double-precision delta from it.
+struct ReferenceOrbit {
+    std::string center_x;
+    std::string center_y;
+    int frac_limbs;
+    int max_iterations;
+    double bailout_radius;
+
+    // Z_0 .. Z_n; Z_0 = 0. Ends early if the reference itself escapes.
+    std::vector<double> z_real;
+    std::vector<double> z_imag;
+
+    bool matches(const DeepViewport& viewport, int limbs,
+                 const RenderParams& params) const;
+};
+
+class Perturbation {
+public:
+    // Compute the reference orbit at the viewport center with enough
+    // precision for viewport.scale. Returns nullptr if the center strings
+    // do not parse.
+    static std::shared_ptr<const ReferenceOrbit> computeReference(
+        const DeepViewport& viewport, const RenderParams& params);
+
+    // Iterate one pixel at offset (dc_real, dc_imag) from the reference.
+    // Rebases onto the start of the reference whenever |z| drops below the
+    // delta or the reference runs out, which removes perturbation glitches
+    // without secondary references. `rebases` is incremented per rebase.
+    static FractalPoint compute(const ReferenceOrbit& reference,
+                                double dc_real, double dc_imag,
+                                int max_iterations, double bailout_radius,
+                                bool smooth_coloring, int& rebases);
+};
+
+} // namespace fractal
+
+#endif // PERTURBATION_H
@@ -0,0 +1,176 @@
+#ifndef RENDER_STATS_H
+#define RENDER_STATS_H
+
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+
+namespace fractal {
+
+// Hot-path counters for one render call, or summed over a frame. They are
+// only collected in builds with FRACTAL_PROFILE defined (the CMake option of
+// the same name); otherwise every counting site compiles to nothing and the
+// stats stay zero.
+struct RenderStats {
+    // Escape counts by bit length: bin b holds counts in [2^(b-1), 2^b)
+    static constexpr int kHistogramBins = 32;
+
+    uint64_t pixels;        // Pixels covered by the render calls
+    uint64_t points;        // Points the kernels decided (fewer with subdivision)
+    uint64_t iterations;    // z^2 + c steps actually taken
+    uint64_t bulb_skipped;  // Decided by the cardioid/bulb tests
+    uint64_t periodic;      // Decided by the periodicity check
+    uint64_t escaped;
+    uint64_t limit_reached;  // Stopped by max_iterations
+    uint64_t escape_histogram[kHistogramBins];
+    double iterate_ms;  // Time in the kernels
+    double color_ms;    // Time coloring and storing pixels
+
+    RenderStats() { reset(); }
+
+    void reset() {
+        pixels = points = iterations = bulb_skipped = periodic = escaped = limit_reached = 0;
+        for (uint64_t& bin : escape_histogram) {
+            bin = 0;
+        }
+        iterate_ms = color_ms = 0.0;
+    }
+
+    void merge(const RenderStats& other) {
+        pixels += other.pixels;
+        points += other.points;
+        iterations += other.iterations;
+        bulb_skipped += other.bulb_skipped;
+        periodic += other.periodic;
+        escaped += other.escaped;
+        limit_reached += other.limit_reached;
+        for (int i = 0; i < kHistogramBins; i++) {
+            escape_histogram[i] += other.escape_histogram[i];
+        }
+        iterate_ms += other.iterate_ms;
+        color_ms += other.color_ms;
+    }
+
+    static constexpr bool enabled() {
+#ifdef FRACTAL_PROFILE
+        return true;
+#else
+        return false;
+#endif
+    }
+};
+
+#ifdef FRACTAL_PROFILE
+
+// FRACTAL_PROFILE_ONLY(statement) keeps statement only in profiling builds
+#define FRACTAL_PROFILE_ONLY(statement) statement
+
+namespace profile {
+
+// Stats of the render call running on this thread (null outside one)
+inline RenderStats*& sink() {
+    thread_local RenderStats* current = nullptr;
+    return current;
+}
+
+inline void countSkipped() {
+    if (RenderStats* stats = sink()) {
+        stats->points++;
+        stats->bulb_skipped++;
+    }
+}
+
+// `run` is the iterations taken in this call, which differs from the
+// point's escape count when an orbit is continued
+inline void countPeriodic(int run) {
+    if (RenderStats* stats = sink()) {
+        stats->points++;
+        stats->iterations += run;
+        stats->periodic++;
+    }
+}
+
+inline void countPoint(int run, int iterations, bool escaped) {
+    if (RenderStats* stats = sink()) {
+        stats->points++;
+        stats->iterations += run;
+        if (!escaped) {
+            stats->limit_reached++;
+            return;
+        }
+        stats->escaped++;
+        int bin = 0;
+        for (unsigned value = static_cast<unsigned>(iterations); value; value >>= 1) {
+            bin++;
+        }
+        stats->escape_histogram[bin < RenderStats::kHistogramBins
+                                    ? bin : RenderStats::kHistogramBins - 1]++;
+    }
+}
+
+// Collects one top-level render call into its own stats, then adds them to
+// the caller's (if any) and to the running totals. Nested calls (a render
+// that continues or anti-aliases) count into the outermost scope.
+class Scope {
+public:
+    Scope(uint64_t pixels, RenderStats* caller, RenderStats& totals, std::mutex& totals_mutex)
+        : outer_(sink() != nullptr), caller_(caller), totals_(totals),
+          totals_mutex_(totals_mutex) {
+        if (!outer_) {
+            sink() = &stats_;
+            stats_.pixels = pixels;
+        }
+    }
+
+    ~Scope() {
+        if (outer_) {
+            return;
+        }
+        sink() = nullptr;
+        if (caller_) {
+            caller_->merge(stats_);
+        }
+        std::lock_guard<std::mutex> lock(totals_mutex_);
+        totals_.merge(stats_);
+    }
+
+    Scope(const Scope&) = delete;
+    Scope& operator=(const Scope&) = delete;
+
+private:
+    bool outer_;
+    RenderStats* caller_;
+    RenderStats& totals_;
+    std::mutex& totals_mutex_;
+    RenderStats stats_;
+};
+
+// Adds the lifetime of the timer to one of the current stats' times
+class Timer {
+public:
+    explicit Timer(double RenderStats::*field)
+        : field_(field), start_(std::chrono::steady_clock::now()) {}
+
+    ~Timer() {
+        if (RenderStats* stats = sink()) {
+            stats->*field_ += std::chrono::duration<double, std::milli>(
+                std::chrono::steady_clock::now() - start_).count();
+        }
+    }
+
+private:
+    double RenderStats::*field_;
+    std::chrono::steady_clock::time_point start_;
+};
+
+} // namespace profile
+
+#else
+
+#define FRACTAL_PROFILE_ONLY(statement)
+
+#endif // FRACTAL_PROFILE
+
+} // namespace fractal
+
+#endif // RENDER_STATS_H
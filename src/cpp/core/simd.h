@@ -0,0 +1,244 @@
+#ifndef SIMD_H
+#define SIMD_H
+
+// Thin wrappers over the vector instruction sets we target. Only the handful
+// of operations the escape-time kernels need are exposed. Masks are kept in
+// the same register type as the data (all-ones / all-zeros per lane), which
+// is how every backend below represents comparison results; bits() packs a
+// mask into one bit per lane, lane 0 in bit 0.
+
+#if defined(__wasm_simd128__)
+#include <wasm_simd128.h>
+#elif defined(__AVX2__) || defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
+
+namespace fractal {
+namespace simd {
+
+#if defined(__wasm_simd128__)
+
+// WebAssembly simd128: 2 x double
+struct VecD {
+    static constexpr int kLanes = 2;
+    using Scalar = double;
+    v128_t v;
+
+    VecD() : v(wasm_f64x2_splat(0.0)) {}
+    explicit VecD(v128_t x) : v(x) {}
+    explicit VecD(double x) : v(wasm_f64x2_splat(x)) {}
+
+    static VecD load(const double* p) { return VecD(wasm_v128_load(p)); }
+    void store(double* p) const { wasm_v128_store(p, v); }
+};
+
+inline VecD operator+(VecD a, VecD b) { return VecD(wasm_f64x2_add(a.v, b.v)); }
+inline VecD operator-(VecD a, VecD b) { return VecD(wasm_f64x2_sub(a.v, b.v)); }
+inline VecD operator*(VecD a, VecD b) { return VecD(wasm_f64x2_mul(a.v, b.v)); }
+inline VecD operator&(VecD a, VecD b) { return VecD(wasm_v128_and(a.v, b.v)); }
+inline VecD operator|(VecD a, VecD b) { return VecD(wasm_v128_or(a.v, b.v)); }
+inline VecD cmpLe(VecD a, VecD b) { return VecD(wasm_f64x2_le(a.v, b.v)); }
+inline VecD andNot(VecD mask, VecD a) { return VecD(wasm_v128_andnot(a.v, mask.v)); }
+inline VecD select(VecD mask, VecD a, VecD b) { return VecD(wasm_v128_bitselect(a.v, b.v, mask.v)); }
+inline bool any(VecD mask) { return wasm_v128_any_true(mask.v); }
+inline int bits(VecD mask) { return static_cast<int>(wasm_i64x2_bitmask(mask.v)); }
+inline VecD abs(VecD a) { return VecD(wasm_f64x2_abs(a.v)); }
+
+// WebAssembly simd128: 4 x float
+struct VecF {
+    static constexpr int kLanes = 4;
+    using Scalar = float;
+    v128_t v;
+
+    VecF() : v(wasm_f32x4_splat(0.0f)) {}
+    explicit VecF(v128_t x) : v(x) {}
+    explicit VecF(float x) : v(wasm_f32x4_splat(x)) {}
+
+    static VecF load(const float* p) { return VecF(wasm_v128_load(p)); }
+    void store(float* p) const { wasm_v128_store(p, v); }
+};
+
+inline VecF operator+(VecF a, VecF b) { return VecF(wasm_f32x4_add(a.v, b.v)); }
+inline VecF operator-(VecF a, VecF b) { return VecF(wasm_f32x4_sub(a.v, b.v)); }
+inline VecF operator*(VecF a, VecF b) { return VecF(wasm_f32x4_mul(a.v, b.v)); }
+inline VecF operator&(VecF a, VecF b) { return VecF(wasm_v128_and(a.v, b.v)); }
+inline VecF operator|(VecF a, VecF b) { return VecF(wasm_v128_or(a.v, b.v)); }
+inline VecF cmpLe(VecF a, VecF b) { return VecF(wasm_f32x4_le(a.v, b.v)); }
+inline VecF andNot(VecF mask, VecF a) { return VecF(wasm_v128_andnot(a.v, mask.v)); }
+inline VecF select(VecF mask, VecF a, VecF b) { return VecF(wasm_v128_bitselect(a.v, b.v, mask.v)); }
+inline bool any(VecF mask) { return wasm_v128_any_true(mask.v); }
+inline int bits(VecF mask) { return static_cast<int>(wasm_i32x4_bitmask(mask.v)); }
+inline VecF abs(VecF a) { return VecF(wasm_f32x4_abs(a.v)); }
+
+#elif defined(__AVX2__) || defined(__AVX__)
+
+// AVX/AVX2: 4 x double
+struct VecD {
+    static constexpr int kLanes = 4;
+    using Scalar = double;
+    __m256d v;
+
+    VecD() : v(_mm256_setzero_pd()) {}
+    explicit VecD(__m256d x) : v(x) {}
+    explicit VecD(double x) : v(_mm256_set1_pd(x)) {}
+
+    static VecD load(const double* p) { return VecD(_mm256_loadu_pd(p)); }
+    void store(double* p) const { _mm256_storeu_pd(p, v); }
+};
+
+inline VecD operator+(VecD a, VecD b) { return VecD(_mm256_add_pd(a.v, b.v)); }
+inline VecD operator-(VecD a, VecD b) { return VecD(_mm256_sub_pd(a.v, b.v)); }
+inline VecD operator*(VecD a, VecD b) { return VecD(_mm256_mul_pd(a.v, b.v)); }
+inline VecD operator&(VecD a, VecD b) { return VecD(_mm256_and_pd(a.v, b.v)); }
+inline VecD operator|(VecD a, VecD b) { return VecD(_mm256_or_pd(a.v, b.v)); }
+inline VecD cmpLe(VecD a, VecD b) { return VecD(_mm256_cmp_pd(a.v, b.v, _CMP_LE_OQ)); }
+inline VecD andNot(VecD mask, VecD a) { return VecD(_mm256_andnot_pd(mask.v, a.v)); }
+inline VecD select(VecD mask, VecD a, VecD b) { return VecD(_mm256_blendv_pd(b.v, a.v, mask.v)); }
+inline bool any(VecD mask) { return _mm256_movemask_pd(mask.v) != 0; }
+inline int bits(VecD mask) { return _mm256_movemask_pd(mask.v); }
+inline VecD abs(VecD a) { return VecD(_mm256_andnot_pd(_mm256_set1_pd(-0.0), a.v)); }
+
+// AVX/AVX2: 8 x float
+struct VecF {
+    static constexpr int kLanes = 8;
+    using Scalar = float;
+    __m256 v;
+
+    VecF() : v(_mm256_setzero_ps()) {}
+    explicit VecF(__m256 x) : v(x) {}
+    explicit VecF(float x) : v(_mm256_set1_ps(x)) {}
+
+    static VecF load(const float* p) { return VecF(_mm256_loadu_ps(p)); }
+    void store(float* p) const { _mm256_storeu_ps(p, v); }
+};
+
+inline VecF operator+(VecF a, VecF b) { return VecF(_mm256_add_ps(a.v, b.v)); }
+inline VecF operator-(VecF a, VecF b) { return VecF(_mm256_sub_ps(a.v, b.v)); }
+inline VecF operator*(VecF a, VecF b) { return VecF(_mm256_mul_ps(a.v, b.v)); }
+inline VecF operator&(VecF a, VecF b) { return VecF(_mm256_and_ps(a.v, b.v)); }
+inline VecF operator|(VecF a, VecF b) { return VecF(_mm256_or_ps(a.v, b.v)); }
+inline VecF cmpLe(VecF a, VecF b) { return VecF(_mm256_cmp_ps(a.v, b.v, _CMP_LE_OQ)); }
+inline VecF andNot(VecF mask, VecF a) { return VecF(_mm256_andnot_ps(mask.v, a.v)); }
+inline VecF select(VecF mask, VecF a, VecF b) { return VecF(_mm256_blendv_ps(b.v, a.v, mask.v)); }
+inline bool any(VecF mask) { return _mm256_movemask_ps(mask.v) != 0; }
+inline int bits(VecF mask) { return _mm256_movemask_ps(mask.v); }
+inline VecF abs(VecF a) { return VecF(_mm256_andnot_ps(_mm256_set1_ps(-0.0f), a.v)); }
+
+#elif defined(__SSE2__) || defined(_M_X64)
+
+// SSE2: 2 x double
+struct VecD {
+    static constexpr int kLanes = 2;
+    using Scalar = double;
+    __m128d v;
+
+    VecD() : v(_mm_setzero_pd()) {}
+    explicit VecD(__m128d x) : v(x) {}
+    explicit VecD(double x) : v(_mm_set1_pd(x)) {}
+
+    static VecD load(const double* p) { return VecD(_mm_loadu_pd(p)); }
+    void store(double* p) const { _mm_storeu_pd(p, v); }
+};
+
+inline VecD operator+(VecD a, VecD b) { return VecD(_mm_add_pd(a.v, b.v)); }
+inline VecD operator-(VecD a, VecD b) { return VecD(_mm_sub_pd(a.v, b.v)); }
+inline VecD operator*(VecD a, VecD b) { return VecD(_mm_mul_pd(a.v, b.v)); }
+inline VecD operator&(VecD a, VecD b) { return VecD(_mm_and_pd(a.v, b.v)); }
+inline VecD operator|(VecD a, VecD b) { return VecD(_mm_or_pd(a.v, b.v)); }
+inline VecD cmpLe(VecD a, VecD b) { return VecD(_mm_cmple_pd(a.v, b.v)); }
+inline VecD andNot(VecD mask, VecD a) { return VecD(_mm_andnot_pd(mask.v, a.v)); }
+inline VecD select(VecD mask, VecD a, VecD b) {
+    return VecD(_mm_or_pd(_mm_and_pd(mask.v, a.v), _mm_andnot_pd(mask.v, b.v)));
+}
+inline bool any(VecD mask) { return _mm_movemask_pd(mask.v) != 0; }
+inline int bits(VecD mask) { return _mm_movemask_pd(mask.v); }
+inline VecD abs(VecD a) { return VecD(_mm_andnot_pd(_mm_set1_pd(-0.0), a.v)); }
+
+// SSE2: 4 x float
+struct VecF {
+    static constexpr int kLanes = 4;
+    using Scalar = float;
+    __m128 v;
+
+    VecF() : v(_mm_setzero_ps()) {}
+    explicit VecF(__m128 x) : v(x) {}
+    explicit VecF(float x) : v(_mm_set1_ps(x)) {}
+
+    static VecF load(const float* p) { return VecF(_mm_loadu_ps(p)); }
+    void store(float* p) const { _mm_storeu_ps(p, v); }
+};
+
+inline VecF operator+(VecF a, VecF b) { return VecF(_mm_add_ps(a.v, b.v)); }
+inline VecF operator-(VecF a, VecF b) { return VecF(_mm_sub_ps(a.v, b.v)); }
+inline VecF operator*(VecF a, VecF b) { return VecF(_mm_mul_ps(a.v, b.v)); }
+inline VecF operator&(VecF a, VecF b) { return VecF(_mm_and_ps(a.v, b.v)); }
+inline VecF operator|(VecF a, VecF b) { return VecF(_mm_or_ps(a.v, b.v)); }
+inline VecF cmpLe(VecF a, VecF b) { return VecF(_mm_cmple_ps(a.v, b.v)); }
+inline VecF andNot(VecF mask, VecF a) { return VecF(_mm_andnot_ps(mask.v, a.v)); }
+inline VecF select(VecF mask, VecF a, VecF b) {
+    return VecF(_mm_or_ps(_mm_and_ps(mask.v, a.v), _mm_andnot_ps(mask.v, b.v)));
+}
+inline bool any(VecF mask) { return _mm_movemask_ps(mask.v) != 0; }
+inline int bits(VecF mask) { return _mm_movemask_ps(mask.v); }
+inline VecF abs(VecF a) { return VecF(_mm_andnot_ps(_mm_set1_ps(-0.0f), a.v)); }
+
+#else
+
+// Scalar fallback: 1 x double, masks are 0.0 / 1.0
+struct VecD {
+    static constexpr int kLanes = 1;
+    using Scalar = double;
+    double v;
+
+    VecD() : v(0.0) {}
+    explicit VecD(double x) : v(x) {}
+
+    static VecD load(const double* p) { return VecD(*p); }
+    void store(double* p) const { *p = v; }
+};
+
+inline VecD operator+(VecD a, VecD b) { return VecD(a.v + b.v); }
+inline VecD operator-(VecD a, VecD b) { return VecD(a.v - b.v); }
+inline VecD operator*(VecD a, VecD b) { return VecD(a.v * b.v); }
+inline VecD operator&(VecD a, VecD b) { return VecD(a.v != 0.0 ? b.v : 0.0); }
+inline VecD operator|(VecD a, VecD b) { return VecD(a.v != 0.0 || b.v != 0.0 ? 1.0 : 0.0); }
+inline VecD cmpLe(VecD a, VecD b) { return VecD(a.v <= b.v ? 1.0 : 0.0); }
+inline VecD andNot(VecD mask, VecD a) { return VecD(mask.v != 0.0 ? 0.0 : a.v); }
+inline VecD select(VecD mask, VecD a, VecD b) { return mask.v != 0.0 ? a : b; }
+inline bool any(VecD mask) { return mask.v != 0.0; }
+inline int bits(VecD mask) { return mask.v != 0.0 ? 1 : 0; }
+inline VecD abs(VecD a) { return VecD(a.v < 0.0 ? -a.v : a.v); }
+
+// Scalar fallback: 1 x float, masks are 0.0f / 1.0f
+struct VecF {
+    static constexpr int kLanes = 1;
+    using Scalar = float;
+    float v;
+
+    VecF() : v(0.0f) {}
+    explicit VecF(float x) : v(x) {}
+
+    static VecF load(const float* p) { return VecF(*p); }
+    void store(float* p) const { *p = v; }
+};
+
+inline VecF operator+(VecF a, VecF b) { return VecF(a.v + b.v); }
+inline VecF operator-(VecF a, VecF b) { return VecF(a.v - b.v); }
+inline VecF operator*(VecF a, VecF b) { return VecF(a.v * b.v); }
+inline VecF operator&(VecF a, VecF b) { return VecF(a.v != 0.0f ? b.v : 0.0f); }
+inline VecF operator|(VecF a, VecF b) { return VecF(a.v != 0.0f || b.v != 0.0f ? 1.0f : 0.0f); }
+inline VecF cmpLe(VecF a, VecF b) { return VecF(a.v <= b.v ? 1.0f : 0.0f); }
+inline VecF andNot(VecF mask, VecF a) { return VecF(mask.v != 0.0f ? 0.0f : a.v); }
+inline VecF select(VecF mask, VecF a, VecF b) { return mask.v != 0.0f ? a : b; }
+inline bool any(VecF mask) { return mask.v != 0.0f; }
+inline int bits(VecF mask) { return mask.v != 0.0f ? 1 : 0; }
+inline VecF abs(VecF a) { return VecF(a.v < 0.0f ? -a.v : a.v); }
+
+#endif
+
+} // namespace simd
+} // namespace fractal
+
+#endif // SIMD_H
@@ -0,0 +1,164 @@
+#include "trace_recorder.h"
+#include <chrono>
+#include <fstream>
+#include <map>
+#include <set>
+#include <sstream>
+
+namespace fractal {
+
+namespace {
+
+std::atomic<int> next_thread_id(0);
+
+thread_local int current_thread_id = -1;
+
+// Thread names outlive any one recorder: scheduler threads name themselves
+// when they start, possibly before tracing does
+std::mutex& threadNamesMutex() {
+    static std::mutex mutex;
+    return mutex;
+}
+
+std::map<int, std::string>& threadNames() {
+    static std::map<int, std::string> names;
+    return names;
+}
+
+void appendEscaped(std::ostringstream& out, const std::string& text) {
+    for (char c : text) {
+        if (c == '"' || c == '\\') {
+            out << '\\';
+        }
+        out << c;
+    }
+}
+
+} // namespace
+
+std::atomic<TraceRecorder*> TraceRecorder::active_(nullptr);
+
+TraceRecorder::TraceRecorder() {
+}
+
+TraceRecorder::~TraceRecorder() {
+    stop();
+}
+
+void TraceRecorder::start() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        events_.clear();
+    }
+    active_.store(this, std::memory_order_release);
+}
+
+void TraceRecorder::stop() {
+    TraceRecorder* expected = this;
+    active_.compare_exchange_strong(expected, nullptr, std::memory_order_acq_rel);
+}
+
+int TraceRecorder::threadID() {
+    if (current_thread_id < 0) {
+        current_thread_id = next_thread_id.fetch_add(1, std::memory_order_relaxed);
+    }
+    return current_thread_id;
+}
+
+void TraceRecorder::setThreadID(int id) {
+    current_thread_id = id;
+}
+
+void TraceRecorder::setThreadName(const std::string& name) {
+    int id = threadID();
+    std::lock_guard<std::mutex> lock(threadNamesMutex());
+    threadNames()[id] = name;
+}
+
+int64_t TraceRecorder::nowMicros() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void TraceRecorder::complete(const char* name, const char* category, int64_t start_us,
+                             int64_t end_us, const Args& args) {
+    Event event{name, category, 'X', threadID(), start_us, end_us - start_us, args};
+    std::lock_guard<std::mutex> lock(mutex_);
+    events_.push_back(event);
+}
+
+void TraceRecorder::instant(const char* name, const char* category, const Args& args) {
+    Event event{name, category, 'i', threadID(), nowMicros(), 0, args};
+    std::lock_guard<std::mutex> lock(mutex_);
+    events_.push_back(event);
+}
+
+size_t TraceRecorder::eventCount() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return events_.size();
+}
+
+std::string TraceRecorder::eventsJSON() const {
+    std::ostringstream out;
+    out << "[";
+    bool first = true;
+
+    std::map<int, std::string> names;
+    {
+        std::lock_guard<std::mutex> lock(threadNamesMutex());
+        names = threadNames();
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::set<int> used;
+    for (const Event& event : events_) {
+        used.insert(event.tid);
+    }
+    for (const auto& entry : names) {
+        if (!used.count(entry.first)) {
+            continue;
+        }
+        out << (first ? "\n" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,"
+            << "\"tid\":" << entry.first << ",\"args\":{\"name\":\"";
+        appendEscaped(out, entry.second);
+        out << "\"}}";
+        first = false;
+    }
+
+    for (const Event& event : events_) {
+        out << (first ? "\n" : ",\n") << "{\"name\":\"" << event.name << "\",\"cat\":\""
+            << event.category << "\",\"ph\":\"" << event.phase << "\",\"pid\":1,\"tid\":"
+            << event.tid << ",\"ts\":" << event.ts;
+        if (event.phase == 'X') {
+            out << ",\"dur\":" << event.duration;
+        } else {
+            out << ",\"s\":\"t\"";
+        }
+
+        const Args& args = event.args;
+        out << ",\"args\":{";
+        if (args.x >= 0) {
+            out << "\"x\":" << args.x << ",\"y\":" << args.y << ",\"width\":" << args.width
+                << ",\"height\":" << args.height;
+        }
+        if (args.key) {
+            out << (args.x >= 0 ? "," : "") << "\"" << args.key << "\":" << args.value;
+        }
+        out << "}}";
+        first = false;
+    }
+    out << "\n]";
+    return out.str();
+}
+
+std::string TraceRecorder::toJSON() const {
+    return "{\"traceEvents\":" + eventsJSON() + ",\"displayTimeUnit\":\"ms\"}\n";
+}
+
+bool TraceRecorder::writeFile(const std::string& path) const {
+    std::ofstream file(path);
+    file << toJSON();
+    return static_cast<bool>(file);
+}
+
+} // namespace fractal
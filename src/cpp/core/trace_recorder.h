@@ -0,0 +1,129 @@
+#ifndef TRACE_RECORDER_H
+#define TRACE_RECORDER_H
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace fractal {
+
+// Timeline of the render pipeline in Chrome trace-event format (loadable in
+// chrome://tracing or Perfetto). While a recorder is started, TraceSpans in
+// tile generation, the engine's tile calls and the scheduler record complete
+// events with the thread and tile they ran on. With no recorder started a
+// span costs one atomic load.
+//
+// Only one recorder is active at a time. Stop it after the renders being
+// traced have finished.
+class TraceRecorder {
+public:
+    TraceRecorder();
+    ~TraceRecorder();
+
+    TraceRecorder(const TraceRecorder&) = delete;
+    TraceRecorder& operator=(const TraceRecorder&) = delete;
+
+    // Clear the events and make this the active recorder
+    void start();
+    void stop();
+
+    static TraceRecorder* active() { return active_.load(std::memory_order_acquire); }
+
+    // Trace thread id of the calling thread: assigned in order of first use
+    // unless set (the wasm build sets each worker's index)
+    static int threadID();
+    static void setThreadID(int id);
+
+    // Label for the calling thread's row in the viewer
+    static void setThreadName(const std::string& name);
+
+    // Microseconds on the clock every event uses
+    static int64_t nowMicros();
+
+    // Event arguments: the tile (x < 0 for none) and one named value
+    struct Args {
+        int x, y, width, height;
+        const char* key;  // Null for no value
+        int64_t value;
+
+        Args() : x(-1), y(0), width(0), height(0), key(nullptr), value(0) {}
+    };
+
+    // Record a span from start_us to end_us, or an instant at start_us
+    void complete(const char* name, const char* category, int64_t start_us, int64_t end_us,
+                  const Args& args);
+    void instant(const char* name, const char* category, const Args& args);
+
+    size_t eventCount() const;
+
+    // The events as a JSON array, thread names included
+    std::string eventsJSON() const;
+
+    // A complete trace file: {"traceEvents": [...], "displayTimeUnit": "ms"}
+    std::string toJSON() const;
+    bool writeFile(const std::string& path) const;
+
+private:
+    struct Event {
+        const char* name;
+        const char* category;
+        char phase;  // 'X' complete, 'i' instant
+        int tid;
+        int64_t ts;
+        int64_t duration;
+        Args args;
+    };
+
+    static std::atomic<TraceRecorder*> active_;
+
+    mutable std::mutex mutex_;
+    std::vector<Event> events_;
+};
+
+// Records the lifetime of a scope as a complete event in the active
+// recorder, if there is one when the span starts
+class TraceSpan {
+public:
+    TraceSpan(const char* name, const char* category)
+        : recorder_(TraceRecorder::active()), name_(name), category_(category), start_(0) {
+        if (recorder_) {
+            start_ = TraceRecorder::nowMicros();
+        }
+    }
+
+    TraceSpan(const char* name, const char* category, int x, int y, int width, int height)
+        : TraceSpan(name, category) {
+        args_.x = x;
+        args_.y = y;
+        args_.width = width;
+        args_.height = height;
+    }
+
+    ~TraceSpan() {
+        if (recorder_) {
+            recorder_->complete(name_, category_, start_, TraceRecorder::nowMicros(), args_);
+        }
+    }
+
+    // Attach a named value (e.g. a tile count), replacing any earlier one
+    void setValue(const char* key, int64_t value) {
+        args_.key = key;
+        args_.value = value;
+    }
+
+    TraceSpan(const TraceSpan&) = delete;
+    TraceSpan& operator=(const TraceSpan&) = delete;
+
+private:
+    TraceRecorder* recorder_;
+    const char* name_;
+    const char* category_;
+    int64_t start_;
+    TraceRecorder::Args args_;
+};
+
+} // namespace fractal
+
+#endif // TRACE_RECORDER_H
@@ -0,0 +1,85 @@
+#include "binary_file.h"
+#include <algorithm>
+#include <filesystem>
+#include <system_error>
+
+namespace fractal {
+
+bool truncateForResume(const std::string& path, uint64_t size) {
+    std::error_code error;
+    uint64_t existing = std::filesystem::file_size(path, error);
+    if (error || existing < size) {
+        return false;
+    }
+    std::filesystem::resize_file(path, size, error);
+    return !error;
+}
+
+IndexedFile::IndexedFile() : header_size_(0), size_(0), failed_(false) {
+}
+
+bool IndexedFile::open(const std::string& path, const uint8_t* header, int header_size,
+                       uint64_t entries, const uint64_t* resume) {
+    header_size_ = header_size;
+    failed_ = false;
+    uint64_t data_start = header_size + entries * 16;
+
+    if (!resume) {
+        file_.open(path, std::ios::binary | std::ios::in | std::ios::out | std::ios::trunc);
+        file_.write(reinterpret_cast<const char*>(header), header_size);
+        std::vector<char> zeros(1 << 16, 0);
+        for (uint64_t left = data_start - header_size; left > 0 && file_;) {
+            uint64_t size = std::min<uint64_t>(left, zeros.size());
+            file_.write(zeros.data(), static_cast<std::streamsize>(size));
+            left -= size;
+        }
+        size_ = data_start;
+        return static_cast<bool>(file_.flush());
+    }
+
+    // The same file at least as far as the checkpoint, cut back to it
+    if (*resume < data_start) {
+        return false;
+    }
+    file_.open(path, std::ios::binary | std::ios::in | std::ios::out);
+    std::vector<uint8_t> existing(header_size);
+    if (!file_.read(reinterpret_cast<char*>(existing.data()), header_size) ||
+        std::memcmp(existing.data(), header, header_size) != 0) {
+        return false;
+    }
+    file_.close();
+    if (!truncateForResume(path, *resume)) {
+        return false;
+    }
+    file_.open(path, std::ios::binary | std::ios::in | std::ios::out);
+    size_ = *resume;
+    return static_cast<bool>(file_);
+}
+
+bool IndexedFile::append(uint64_t entry, const uint8_t* data, size_t size) {
+    uint8_t index[16];
+    putU64(index, size_);
+    putU64(index + 8, size);
+    file_.seekp(static_cast<std::streamoff>(size_));
+    file_.write(reinterpret_cast<const char*>(data), static_cast<std::streamsize>(size));
+    file_.seekp(static_cast<std::streamoff>(header_size_ + entry * 16));
+    file_.write(reinterpret_cast<const char*>(index), sizeof(index));
+    size_ += size;
+    failed_ = failed_ || !file_;
+    return !failed_;
+}
+
+bool IndexedFile::flush() {
+    return !failed_ && file_.flush();
+}
+
+bool IndexedFile::finish(int complete_offset) {
+    uint8_t complete[4];
+    putU32(complete, 1);
+    file_.seekp(complete_offset);
+    file_.write(reinterpret_cast<const char*>(complete), sizeof(complete));
+    file_.close();
+    return !failed_ && !file_.fail();
+}
+
+} // namespace fractal
@@ -0,0 +1,113 @@
+#ifndef BINARY_FILE_H
+#define BINARY_FILE_H
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace fractal {
+
+// Little-endian fields of the file formats, stored at out or read from in
+inline void putU32(uint8_t* out, uint32_t value) {
+    for (int i = 0; i < 4; i++) {
+        out[i] = static_cast<uint8_t>(value >> (i * 8));
+    }
+}
+
+inline void putU64(uint8_t* out, uint64_t value) {
+    for (int i = 0; i < 8; i++) {
+        out[i] = static_cast<uint8_t>(value >> (i * 8));
+    }
+}
+
+inline void putF64(uint8_t* out, double value) {
+    uint64_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    putU64(out, bits);
+}
+
+inline uint32_t getU32(const uint8_t* in) {
+    uint32_t value = 0;
+    for (int i = 0; i < 4; i++) {
+        value |= static_cast<uint32_t>(in[i]) << (i * 8);
+    }
+    return value;
+}
+
+inline uint64_t getU64(const uint8_t* in) {
+    uint64_t value = 0;
+    for (int i = 0; i < 8; i++) {
+        value |= static_cast<uint64_t>(in[i]) << (i * 8);
+    }
+    return value;
+}
+
+inline double getF64(const uint8_t* in) {
+    uint64_t bits = getU64(in);
+    double value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+// The same fields appended to out
+inline void putU16(std::vector<uint8_t>& out, uint16_t value) {
+    out.push_back(value & 0xff);
+    out.push_back(value >> 8);
+}
+
+inline void putU32(std::vector<uint8_t>& out, uint32_t value) {
+    uint8_t bytes[4];
+    putU32(bytes, value);
+    out.insert(out.end(), bytes, bytes + 4);
+}
+
+inline void putU64(std::vector<uint8_t>& out, uint64_t value) {
+    uint8_t bytes[8];
+    putU64(bytes, value);
+    out.insert(out.end(), bytes, bytes + 8);
+}
+
+// Cut a file written at least up to size bytes back to size, dropping
+// whatever an interrupted run wrote after its last checkpoint. False if the
+// file is shorter (it never got that far) or cannot be truncated.
+bool truncateForResume(const std::string& path, uint64_t size);
+
+// A fixed header, an index of u64 offset, u64 size entries, then records
+// appended in the order they are written. The index is reserved when the
+// file is created and each entry filled in place as its record lands, so
+// the file needs no separate index and one cut off after a flush() can be
+// resumed from its size() then. Entries never written stay zero.
+class IndexedFile {
+public:
+    IndexedFile();
+
+    // Create path with header and entries zeroed index entries, or with
+    // resume reopen one with the same header written up to that size and
+    // drop anything after it. Returns false on I/O errors or a mismatch.
+    bool open(const std::string& path, const uint8_t* header, int header_size,
+              uint64_t entries, const uint64_t* resume);
+
+    // Append a record and point index entry at it
+    bool append(uint64_t entry, const uint8_t* data, size_t size);
+
+    // Flush what was appended to the OS, so size() is safe to record
+    bool flush();
+
+    // Set the header's u32 at complete_offset to 1 and close the file
+    bool finish(int complete_offset);
+
+    // File length after the records appended so far
+    uint64_t size() const { return size_; }
+
+private:
+    std::fstream file_;
+    int header_size_;
+    uint64_t size_;
+    bool failed_;
+};
+
+} // namespace fractal
+
+#endif // BINARY_FILE_H
@@ -0,0 +1,571 @@
+#include "field_file.h"
+#include "binary_file.h"
+#include "../core/trace_recorder.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace fractal {
+
+namespace {
+
+const char kFieldMagic[4] = {'F', 'F', 'L', 'D'};
+const uint32_t kFieldVersion = 1;
+const int kHeaderSize = 128;
+const int kCompleteOffset = 20;
+
+// Unary quotients this long are escaped to an explicit bit length
+const int kEscapeLength = 24;
+
+void writeHeader(uint8_t* header, int chunk_size, double step, const FieldMetadata& metadata) {
+    const Viewport& viewport = metadata.viewport;
+    const RenderParams& params = metadata.params;
+    std::memset(header, 0, kHeaderSize);
+    std::memcpy(header, kFieldMagic, 4);
+    putU32(header + 4, kFieldVersion);
+    putU32(header + 8, viewport.width);
+    putU32(header + 12, viewport.height);
+    putU32(header + 16, chunk_size);
+    putU32(header + kCompleteOffset, 0);
+    putF64(header + 24, step);
+    putF64(header + 32, viewport.center_x);
+    putF64(header + 40, viewport.center_y);
+    putF64(header + 48, viewport.scale);
+    putU32(header + 56, metadata.type);
+    putU32(header + 60, params.max_iterations);
+    putF64(header + 64, metadata.julia_c_real);
+    putF64(header + 72, metadata.julia_c_imag);
+    putF64(header + 80, params.bailout_radius);
+    putF64(header + 88, params.color_offset);
+    putF64(header + 96, params.color_speed);
+    putU32(header + 104, params.palette_id);
+    putU32(header + 108, params.color_iterations);
+    putU32(header + 112, params.precision);
+    putU32(header + 116, params.antialias_samples);
+    putU32(header + 120, params.antialias_threshold);
+    header[124] = params.smooth_coloring;
+    header[125] = params.subdivide;
+    header[126] = params.periodicity_check;
+}
+
+void readHeader(const uint8_t* header, FieldMetadata& metadata) {
+    Viewport& viewport = metadata.viewport;
+    RenderParams& params = metadata.params;
+    viewport = Viewport(getF64(header + 32), getF64(header + 40), getF64(header + 48),
+                        static_cast<int>(getU32(header + 8)),
+                        static_cast<int>(getU32(header + 12)));
+    metadata.type = static_cast<FractalType>(getU32(header + 56));
+    params.max_iterations = static_cast<int>(getU32(header + 60));
+    metadata.julia_c_real = getF64(header + 64);
+    metadata.julia_c_imag = getF64(header + 72);
+    params.bailout_radius = getF64(header + 80);
+    params.color_offset = getF64(header + 88);
+    params.color_speed = getF64(header + 96);
+    params.palette_id = static_cast<int>(getU32(header + 104));
+    params.color_iterations = static_cast<int>(getU32(header + 108));
+    params.precision = static_cast<Precision>(static_cast<int32_t>(getU32(header + 112)));
+    params.antialias_samples = static_cast<int>(getU32(header + 116));
+    params.antialias_threshold = static_cast<int>(getU32(header + 120));
+    params.smooth_coloring = header[124] != 0;
+    params.subdivide = header[125] != 0;
+    params.periodicity_check = header[126] != 0;
+}
+
+// Bits packed least significant first
+class BitWriter {
+public:
+    explicit BitWriter(std::vector<uint8_t>& out) : out_(out), buffer_(0), count_(0) {}
+
+    // n <= 32
+    void put(uint64_t bits, int n) {
+        buffer_ |= bits << count_;
+        count_ += n;
+        while (count_ >= 8) {
+            out_.push_back(static_cast<uint8_t>(buffer_));
+            buffer_ >>= 8;
+            count_ -= 8;
+        }
+    }
+
+    void putWide(uint64_t bits, int n) {
+        if (n > 32) {
+            put(bits & 0xffffffffu, 32);
+            put(bits >> 32, n - 32);
+        } else {
+            put(bits, n);
+        }
+    }
+
+    void flush() {
+        if (count_ > 0) {
+            out_.push_back(static_cast<uint8_t>(buffer_));
+        }
+        buffer_ = 0;
+        count_ = 0;
+    }
+
+private:
+    std::vector<uint8_t>& out_;
+    uint64_t buffer_;
+    int count_;
+};
+
+// Reads past the end as zero bits; overrun() tells whether it did
+class BitReader {
+public:
+    BitReader(const uint8_t* data, size_t size)
+        : data_(data), size_(size), position_(0), buffer_(0), count_(0) {}
+
+    // n <= 32
+    uint64_t get(int n) {
+        refill();
+        uint64_t bits = n ? buffer_ & (~uint64_t(0) >> (64 - n)) : 0;
+        buffer_ >>= n;
+        count_ -= n;
+        return bits;
+    }
+
+    uint64_t getWide(int n) {
+        if (n > 32) {
+            uint64_t low = get(32);
+            return low | (get(n - 32) << 32);
+        }
+        return get(n);
+    }
+
+    // Zeros before the next one, up to kEscapeLength (the one is consumed
+    // when found)
+    int zeros() {
+        refill();
+        uint64_t window = buffer_ & ((uint64_t(1) << (kEscapeLength + 1)) - 1);
+        if (!(window & ((uint64_t(1) << kEscapeLength) - 1))) {
+            buffer_ >>= kEscapeLength;
+            count_ -= kEscapeLength;
+            return kEscapeLength;
+        }
+        int length = __builtin_ctzll(window);
+        buffer_ >>= length + 1;
+        count_ -= length + 1;
+        return length;
+    }
+
+    bool overrun() const { return position_ > size_ + 8; }
+
+private:
+    void refill() {
+        while (count_ <= 56) {
+            uint64_t byte = position_ < size_ ? data_[position_] : 0;
+            position_++;
+            buffer_ |= byte << count_;
+            count_ += 8;
+        }
+    }
+
+    const uint8_t* data_;
+    size_t size_;
+    size_t position_;
+    uint64_t buffer_;
+    int count_;
+};
+
+// Golomb-Rice coding whose parameter follows the running mean, as in LOCO-I
+class RiceCoder {
+public:
+    RiceCoder() : sum_(16), count_(1) {}
+
+    void encode(BitWriter& out, uint64_t value) {
+        int k = parameter();
+        uint64_t quotient = value >> k;
+        if (quotient < kEscapeLength) {
+            out.put(uint64_t(1) << quotient, static_cast<int>(quotient) + 1);
+            out.putWide(value & lowBits(k), k);
+        } else {
+            int length = 64 - __builtin_clzll(value);
+            out.put(0, kEscapeLength);
+            out.put(length, 7);
+            out.putWide(value, length);
+        }
+        update(value);
+    }
+
+    uint64_t decode(BitReader& in) {
+        int k = parameter();
+        int quotient = in.zeros();
+        uint64_t value;
+        if (quotient < kEscapeLength) {
+            value = (static_cast<uint64_t>(quotient) << k) | in.getWide(k);
+        } else {
+            value = in.getWide(static_cast<int>(in.get(7)));
+        }
+        update(value);
+        return value;
+    }
+
+private:
+    static uint64_t lowBits(int k) {
+        return k ? ~uint64_t(0) >> (64 - k) : 0;
+    }
+
+    int parameter() const {
+        int k = 0;
+        while ((count_ << k) < sum_ && k < 60) {
+            k++;
+        }
+        return k;
+    }
+
+    void update(uint64_t value) {
+        sum_ += std::min<uint64_t>(value, uint64_t(1) << 40);
+        if (++count_ == 64) {
+            sum_ >>= 1;
+            count_ >>= 1;
+        }
+    }
+
+    uint64_t sum_;
+    uint64_t count_;
+};
+
+// Median edge detector: a is left, b above, c above-left
+int64_t predict(int64_t a, int64_t b, int64_t c) {
+    if (c >= std::max(a, b)) {
+        return std::min(a, b);
+    }
+    if (c <= std::min(a, b)) {
+        return std::max(a, b);
+    }
+    return a + b - c;
+}
+
+int64_t quantize(float value, double step) {
+    if (step > 0.0) {
+        return std::llround(value / step);
+    }
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+float dequantize(int64_t value, double step) {
+    if (step > 0.0) {
+        return static_cast<float>(value * step);
+    }
+    uint32_t bits = static_cast<uint32_t>(value);
+    float result;
+    std::memcpy(&result, &bits, sizeof(result));
+    return result;
+}
+
+// Residual prediction over a chunk, shared by both directions: code(i,
+// predicted) returns pixel i's value (coding or decoding its residual)
+template <typename Code>
+void predictChunk(int width, int height, std::vector<int64_t>& values, Code code) {
+    values.resize(static_cast<size_t>(width) * height);
+    for (int y = 0; y < height; y++) {
+        int64_t* row = &values[static_cast<size_t>(y) * width];
+        const int64_t* above = y > 0 ? row - width : nullptr;
+        for (int x = 0; x < width; x++) {
+            int64_t predicted;
+            if (above && x > 0) {
+                predicted = predict(row[x - 1], above[x], above[x - 1]);
+            } else if (above) {
+                predicted = above[x];
+            } else {
+                predicted = x > 0 ? row[x - 1] : 0;
+            }
+            row[x] = code(static_cast<size_t>(y) * width + x, predicted);
+        }
+    }
+}
+
+void encodeChunk(const float* smooth_values, const uint8_t* inside_set, int stride, int width,
+                 int height, double step, std::vector<uint8_t>& out) {
+    out.clear();
+    BitWriter bits(out);
+
+    // Inside mask as run lengths, starting with an escaped run
+    RiceCoder runs;
+    uint8_t state = 0;
+    uint64_t run = 0;
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            uint8_t inside = inside_set[static_cast<size_t>(y) * stride + x] ? 1 : 0;
+            if (inside != state) {
+                runs.encode(bits, run);
+                state = inside;
+                run = 0;
+            }
+            run++;
+        }
+    }
+    runs.encode(bits, run);
+
+    RiceCoder residuals;
+    std::vector<int64_t> values;
+    predictChunk(width, height, values, [&](size_t i, int64_t predicted) {
+        size_t source = (i / width) * stride + i % width;
+        if (inside_set[source]) {
+            return predicted;
+        }
+        int64_t value = quantize(smooth_values[source], step);
+        uint64_t residual = static_cast<uint64_t>(value - predicted);
+        residuals.encode(bits, (residual << 1) ^ (0 - (residual >> 63)));
+        return value;
+    });
+    bits.flush();
+}
+
+bool decodeChunk(const uint8_t* data, size_t size, int width, int height, double step,
+                 float* smooth_values, uint8_t* inside_set) {
+    BitReader bits(data, size);
+    size_t pixels = static_cast<size_t>(width) * height;
+
+    RiceCoder runs;
+    uint8_t state = 0;
+    for (size_t done = 0; done < pixels;) {
+        uint64_t run = runs.decode(bits);
+        if (run > pixels - done || bits.overrun()) {
+            return false;
+        }
+        std::fill_n(inside_set + done, run, state);
+        done += run;
+        state ^= 1;
+    }
+
+    RiceCoder residuals;
+    std::vector<int64_t> values;
+    predictChunk(width, height, values, [&](size_t i, int64_t predicted) {
+        if (inside_set[i]) {
+            smooth_values[i] = 0.0f;
+            return predicted;
+        }
+        uint64_t coded = residuals.decode(bits);
+        int64_t value = predicted + static_cast<int64_t>((coded >> 1) ^ (0 - (coded & 1)));
+        smooth_values[i] = dequantize(value, step);
+        return value;
+    });
+    return !bits.overrun();
+}
+
+} // namespace
+
+FieldWriter::FieldWriter(double step, int chunk_size)
+    : step_(std::max(0.0, step)), chunk_size_(std::max(8, chunk_size)), width_(0), height_(0),
+      pending_rows_(0) {
+}
+
+bool FieldWriter::open(const std::string& path, const FieldMetadata& metadata,
+                       const ImageCheckpoint* resume) {
+    width_ = metadata.viewport.width;
+    height_ = metadata.viewport.height;
+    pending_rows_ = 0;
+    if (width_ <= 0 || height_ <= 0) {
+        return false;
+    }
+    uint8_t header[kHeaderSize];
+    writeHeader(header, chunk_size_, step_, metadata);
+    uint64_t chunks = static_cast<uint64_t>((width_ + chunk_size_ - 1) / chunk_size_) *
+                      ((height_ + chunk_size_ - 1) / chunk_size_);
+
+    // Only whole rows of chunks can be continued
+    if (resume && (resume->rows > height_ ||
+                   (resume->rows % chunk_size_ && resume->rows != height_))) {
+        return false;
+    }
+    if (!file_.open(path, header, kHeaderSize, chunks, resume ? &resume->file_size : nullptr)) {
+        return false;
+    }
+    checkpoint_ = resume ? *resume : ImageCheckpoint();
+    checkpoint_.file_size = file_.size();
+    return true;
+}
+
+bool FieldWriter::writeRows(const IterationField& field) {
+    int done = checkpoint_.rows + pending_rows_;
+    if (field.width != width_ || field.height <= 0 || done + field.height > height_) {
+        return false;
+    }
+    for (int row = 0; row < field.height; row++) {
+        if (pending_rows_ == 0) {
+            pending_.reset(0, checkpoint_.rows, width_,
+                           std::min(chunk_size_, height_ - checkpoint_.rows));
+        }
+        size_t from = static_cast<size_t>(row) * width_;
+        size_t to = static_cast<size_t>(pending_rows_) * width_;
+        std::copy_n(&field.smooth_values[from], width_, &pending_.smooth_values[to]);
+        std::copy_n(&field.inside_set[from], width_, &pending_.inside_set[to]);
+        if (++pending_rows_ == pending_.height && !writeChunkRow(pending_rows_)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool FieldWriter::writeChunkRow(int rows) {
+    TraceSpan span("writeFieldRows", "io", 0, checkpoint_.rows, width_, rows);
+    int chunk_y = checkpoint_.rows / chunk_size_;
+    int chunks_x = (width_ + chunk_size_ - 1) / chunk_size_;
+    for (int chunk_x = 0; chunk_x < chunks_x; chunk_x++) {
+        int x = chunk_x * chunk_size_;
+        int width = std::min(chunk_size_, width_ - x);
+        encodeChunk(&pending_.smooth_values[x], &pending_.inside_set[x], width_, width, rows,
+                    step_, encoded_);
+
+        file_.append(static_cast<uint64_t>(chunk_y) * chunks_x + chunk_x, encoded_.data(),
+                     encoded_.size());
+    }
+    if (!file_.flush()) {
+        return false;
+    }
+    checkpoint_.file_size = file_.size();
+    checkpoint_.rows += rows;
+    pending_rows_ = 0;
+    return true;
+}
+
+bool FieldWriter::finish() {
+    if (checkpoint_.rows != height_) {
+        return false;
+    }
+    return file_.finish(kCompleteOffset);
+}
+
+FieldReader::FieldReader(int cache_chunks)
+    : data_(nullptr), size_(0), width_(0), height_(0), chunk_size_(0), chunks_x_(0), step_(0.0),
+      cache_chunks_(std::max(1, cache_chunks)) {
+}
+
+FieldReader::~FieldReader() {
+    close();
+}
+
+bool FieldReader::open(const std::string& path) {
+    close();
+    int descriptor = ::open(path.c_str(), O_RDONLY);
+    if (descriptor < 0) {
+        return false;
+    }
+    struct stat status;
+    void* mapping = MAP_FAILED;
+    if (fstat(descriptor, &status) == 0 && status.st_size >= kHeaderSize) {
+        mapping = mmap(nullptr, static_cast<size_t>(status.st_size), PROT_READ, MAP_SHARED,
+                       descriptor, 0);
+    }
+    ::close(descriptor);
+    if (mapping == MAP_FAILED) {
+        return false;
+    }
+    data_ = static_cast<const uint8_t*>(mapping);
+    size_ = static_cast<uint64_t>(status.st_size);
+
+    if (std::memcmp(data_, kFieldMagic, 4) != 0 || getU32(data_ + 4) != kFieldVersion ||
+        getU32(data_ + kCompleteOffset) != 1) {
+        close();
+        return false;
+    }
+    width_ = static_cast<int>(getU32(data_ + 8));
+    height_ = static_cast<int>(getU32(data_ + 12));
+    chunk_size_ = static_cast<int>(getU32(data_ + 16));
+    step_ = getF64(data_ + 24);
+    readHeader(data_, metadata_);
+    chunks_x_ = chunk_size_ > 0 ? (width_ + chunk_size_ - 1) / chunk_size_ : 0;
+    uint64_t chunks = static_cast<uint64_t>(chunks_x_) *
+                      (chunk_size_ > 0 ? (height_ + chunk_size_ - 1) / chunk_size_ : 0);
+    if (width_ <= 0 || height_ <= 0 || chunk_size_ <= 0 || size_ < kHeaderSize + chunks * 16) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+void FieldReader::close() {
+    if (data_) {
+        munmap(const_cast<uint8_t*>(data_), static_cast<size_t>(size_));
+    }
+    data_ = nullptr;
+    size_ = 0;
+    std::lock_guard<std::mutex> lock(mutex_);
+    recent_.clear();
+    cache_.clear();
+}
+
+std::shared_ptr<const FieldReader::Chunk> FieldReader::chunk(int chunk_x, int chunk_y) {
+    int64_t index = static_cast<int64_t>(chunk_y) * chunks_x_ + chunk_x;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto cached = cache_.find(index);
+        if (cached != cache_.end()) {
+            recent_.splice(recent_.begin(), recent_, cached->second.second);
+            return cached->second.first;
+        }
+    }
+
+    // Decoded unlocked, so threads reading different chunks do not wait
+    TraceSpan span("decodeFieldChunk", "io", chunk_x * chunk_size_, chunk_y * chunk_size_,
+                   chunk_size_, chunk_size_);
+    const uint8_t* entry = data_ + kHeaderSize + index * 16;
+    uint64_t offset = getU64(entry);
+    uint64_t size = getU64(entry + 8);
+    if (offset < kHeaderSize || offset > size_ || size > size_ - offset) {
+        return nullptr;
+    }
+    auto decoded = std::make_shared<Chunk>();
+    decoded->width = std::min(chunk_size_, width_ - chunk_x * chunk_size_);
+    decoded->height = std::min(chunk_size_, height_ - chunk_y * chunk_size_);
+    size_t pixels = static_cast<size_t>(decoded->width) * decoded->height;
+    decoded->smooth_values.resize(pixels);
+    decoded->inside_set.resize(pixels);
+    if (!decodeChunk(data_ + offset, size, decoded->width, decoded->height, step_,
+                     decoded->smooth_values.data(), decoded->inside_set.data())) {
+        return nullptr;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto cached = cache_.find(index);
+    if (cached != cache_.end()) {
+        return cached->second.first;
+    }
+    recent_.push_front(index);
+    cache_[index] = std::make_pair(decoded, recent_.begin());
+    while (cache_.size() > cache_chunks_) {
+        cache_.erase(recent_.back());
+        recent_.pop_back();
+    }
+    return decoded;
+}
+
+bool FieldReader::readRegion(int x, int y, int w, int h, IterationField& field) {
+    if (!data_ || x < 0 || y < 0 || w <= 0 || h <= 0 || x + w > width_ || y + h > height_) {
+        return false;
+    }
+    field.reset(x, y, w, h);
+    for (int chunk_y = y / chunk_size_; chunk_y <= (y + h - 1) / chunk_size_; chunk_y++) {
+        for (int chunk_x = x / chunk_size_; chunk_x <= (x + w - 1) / chunk_size_; chunk_x++) {
+            std::shared_ptr<const Chunk> decoded = chunk(chunk_x, chunk_y);
+            if (!decoded) {
+                return false;
+            }
+            int left = chunk_x * chunk_size_;
+            int top = chunk_y * chunk_size_;
+            int from_x = std::max(x, left);
+            int to_x = std::min(x + w, left + decoded->width);
+            for (int row = std::max(y, top); row < std::min(y + h, top + decoded->height);
+                 row++) {
+                size_t source = static_cast<size_t>(row - top) * decoded->width + from_x - left;
+                size_t target = field.indexOf(from_x, row);
+                std::copy_n(&decoded->smooth_values[source], to_x - from_x,
+                            &field.smooth_values[target]);
+                std::copy_n(&decoded->inside_set[source], to_x - from_x,
+                            &field.inside_set[target]);
+            }
+        }
+    }
+    return true;
+}
+
+} // namespace fractal
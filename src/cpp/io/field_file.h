@@ -0,0 +1,139 @@
+#ifndef FIELD_FILE_H
+#define FIELD_FILE_H
+
+#include "../core/fractal_engine.h"
+#include "binary_file.h"
+#include "image_writer.h"
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace fractal {
+
+// What a field was rendered from, stored with it so it can be recolored
+// or continued later. The viewport's size is the field's.
+struct FieldMetadata {
+    Viewport viewport;
+    RenderParams params;  // color_histogram and stats are not stored
+    FractalType type;
+    double julia_c_real;
+    double julia_c_imag;
+
+    FieldMetadata() : type(MANDELBROT), julia_c_real(0.0), julia_c_imag(0.0) {}
+};
+
+// Iteration fields on disk (.ffield), cut into square chunks that decode
+// independently (little-endian):
+//
+//   header  "FFLD", u32 version (1), u32 width, u32 height, u32 chunk_size,
+//           u32 complete (1 once finished), f64 step, then the metadata
+//           (kHeaderSize bytes in all)
+//   index   u64 offset, u64 size per chunk, row-major over the chunk grid
+//   chunks  one bitstream each
+//
+// A chunk holds the inside-set mask as alternating run lengths, then each
+// escaped pixel's smooth value as a residual from the median edge
+// predictor of its left, upper and upper-left neighbours (LOCO-I), all
+// Rice-coded with adaptive parameters. Values are the float's bits with
+// step 0 (lossless) or round(value / step) otherwise, which bounds the
+// error by step / 2. Inside pixels take their predicted value, so the
+// interior costs only its runs.
+
+// Writes a field a band of rows at a time; chunks are encoded as each row
+// of chunks fills. Like ImageWriter, a file cut off after a checkpoint can
+// be truncated back to it and continued, when checkpoints fall on chunk
+// rows (they do after every chunk_size rows and at the end).
+class FieldWriter {
+public:
+    // step 0 is lossless
+    explicit FieldWriter(double step = 0.0, int chunk_size = 256);
+
+    // Create the file and reserve its index, or with resume reopen one
+    // written up to that checkpoint with the same header
+    bool open(const std::string& path, const FieldMetadata& metadata,
+              const ImageCheckpoint* resume = nullptr);
+
+    // Append field's rows (field.width must be the field's width)
+    bool writeRows(const IterationField& field);
+
+    // Mark the file complete once every row is in and close it
+    bool finish();
+
+    // Rows on disk and the file length after them (checksum unused)
+    ImageCheckpoint checkpoint() const { return checkpoint_; }
+    int chunkSize() const { return chunk_size_; }
+
+private:
+    bool writeChunkRow(int rows);
+
+    double step_;
+    int chunk_size_;
+    int width_;
+    int height_;
+    IndexedFile file_;
+    ImageCheckpoint checkpoint_;
+    IterationField pending_;  // Rows of the chunk row being filled
+    int pending_rows_;
+    std::vector<uint8_t> encoded_;
+};
+
+// Reads regions of a field from a memory-mapped file, decoding only the
+// chunks they touch and keeping recently decoded ones, so fields far larger
+// than memory can be browsed and recolored. Safe to share between threads.
+class FieldReader {
+public:
+    // cache_chunks decoded chunks are kept (least recently used dropped)
+    explicit FieldReader(int cache_chunks = 64);
+    ~FieldReader();
+
+    FieldReader(const FieldReader&) = delete;
+    FieldReader& operator=(const FieldReader&) = delete;
+
+    // Map path; false if it is not a complete field file
+    bool open(const std::string& path);
+    void close();
+
+    const FieldMetadata& metadata() const { return metadata_; }
+    int width() const { return width_; }
+    int height() const { return height_; }
+    int chunkSize() const { return chunk_size_; }
+    double step() const { return step_; }
+    uint64_t fileSize() const { return size_; }
+
+    // Decode the region (x, y, w, h) into field, reset to cover it (frame
+    // coordinates, so it can go straight to FractalEngine::recolorTile)
+    bool readRegion(int x, int y, int w, int h, IterationField& field);
+
+private:
+    struct Chunk {
+        int width;
+        int height;
+        std::vector<float> smooth_values;
+        std::vector<uint8_t> inside_set;
+    };
+
+    std::shared_ptr<const Chunk> chunk(int chunk_x, int chunk_y);
+
+    const uint8_t* data_;
+    uint64_t size_;
+    int width_;
+    int height_;
+    int chunk_size_;
+    int chunks_x_;
+    double step_;
+    FieldMetadata metadata_;
+
+    std::mutex mutex_;
+    size_t cache_chunks_;
+    std::list<int64_t> recent_;  // Chunk indices, most recent first
+    std::unordered_map<int64_t, std::pair<std::shared_ptr<const Chunk>,
+                                          std::list<int64_t>::iterator>> cache_;
+};
+
+} // namespace fractal
+
+#endif // FIELD_FILE_H
@@ -0,0 +1,453 @@
+#include "image_writer.h"
+#include "binary_file.h"
+#include "../core/trace_recorder.h"
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+
+#ifdef FRACTAL_HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+namespace fractal {
+
+namespace {
+
+void putU32BigEndian(std::vector<uint8_t>& out, uint32_t value) {
+    for (int shift = 24; shift >= 0; shift -= 8) {
+        out.push_back((value >> shift) & 0xff);
+    }
+}
+
+// Binary PPM (P6): a text header, then raw rows
+class PpmWriter : public ImageWriter {
+protected:
+    bool writeHeader() override {
+        std::string header = "P6\n" + std::to_string(width_) + " " + std::to_string(height_) +
+                             "\n255\n";
+        return write(header.data(), header.size());
+    }
+
+    bool writeRGB(const uint8_t* rgb, int rows) override {
+        return write(rgb, static_cast<size_t>(width_) * 3 * rows);
+    }
+};
+
+// Baseline uncompressed RGB TIFF with the IFD and strip tables ahead of the
+// pixel data: every strip's offset is known before any row is rendered, so
+// the rows stream straight after the header. Files past 4 GiB use BigTIFF.
+class TiffWriter : public ImageWriter {
+protected:
+    enum {
+        TYPE_SHORT = 3,
+        TYPE_LONG = 4,
+        TYPE_RATIONAL = 5,
+        TYPE_LONG8 = 16
+    };
+
+    struct Entry {
+        uint16_t tag;
+        uint16_t type;
+        uint64_t count;
+        std::vector<uint8_t> value;  // Little-endian
+    };
+
+    static size_t typeSize(uint16_t type) {
+        return type == TYPE_SHORT ? 2 : type == TYPE_LONG ? 4 : 8;
+    }
+
+    bool writeHeader() override {
+        uint64_t row_bytes = static_cast<uint64_t>(width_) * 3;
+        int rows_per_strip = static_cast<int>(
+            std::max<uint64_t>(1, std::min<uint64_t>(height_, (1u << 20) / row_bytes)));
+        int strips = (height_ + rows_per_strip - 1) / rows_per_strip;
+        uint64_t data_size = row_bytes * height_;
+
+        std::vector<uint8_t> header = layout(false, rows_per_strip, strips, data_size);
+        if (header.size() + data_size > 0xffffffffull) {
+            header = layout(true, rows_per_strip, strips, data_size);
+        }
+        return write(header.data(), header.size());
+    }
+
+    bool writeRGB(const uint8_t* rgb, int rows) override {
+        return write(rgb, static_cast<size_t>(width_) * 3 * rows);
+    }
+
+private:
+    // Header, IFD and out-of-line tag values, ending where the data starts
+    std::vector<uint8_t> layout(bool big, int rows_per_strip, int strips,
+                                uint64_t data_size) const {
+        uint16_t offset_type = big ? TYPE_LONG8 : TYPE_LONG;
+        std::vector<Entry> entries = {
+            {256, TYPE_LONG, 1, {}},             // ImageWidth
+            {257, TYPE_LONG, 1, {}},             // ImageLength
+            {258, TYPE_SHORT, 3, {}},            // BitsPerSample
+            {259, TYPE_SHORT, 1, {}},            // Compression: none
+            {262, TYPE_SHORT, 1, {}},            // PhotometricInterpretation: RGB
+            {273, offset_type, static_cast<uint64_t>(strips), {}},  // StripOffsets
+            {277, TYPE_SHORT, 1, {}},            // SamplesPerPixel
+            {278, TYPE_LONG, 1, {}},             // RowsPerStrip
+            {279, offset_type, static_cast<uint64_t>(strips), {}},  // StripByteCounts
+            {282, TYPE_RATIONAL, 1, {}},         // XResolution
+            {283, TYPE_RATIONAL, 1, {}},         // YResolution
+            {284, TYPE_SHORT, 1, {}},            // PlanarConfiguration: chunky
+            {296, TYPE_SHORT, 1, {}},            // ResolutionUnit: inch
+        };
+
+        size_t header_size = big ? 16 : 8;
+        size_t entry_size = big ? 20 : 12;
+        size_t inline_size = big ? 8 : 4;
+        size_t ifd_size = (big ? 8 : 2) + entries.size() * entry_size + (big ? 8 : 4);
+
+        // Out-of-line values follow the IFD, each at an even offset
+        uint64_t data_start = header_size + ifd_size;
+        for (const Entry& entry : entries) {
+            size_t size = typeSize(entry.type) * entry.count;
+            if (size > inline_size) {
+                data_start += size + (size & 1);
+            }
+        }
+
+        uint64_t row_bytes = static_cast<uint64_t>(width_) * 3;
+        uint64_t strip_bytes = row_bytes * rows_per_strip;
+        for (Entry& entry : entries) {
+            std::vector<uint8_t>& value = entry.value;
+            switch (entry.tag) {
+                case 256: putU32(value, width_); break;
+                case 257: putU32(value, height_); break;
+                case 258: putU16(value, 8); putU16(value, 8); putU16(value, 8); break;
+                case 259: putU16(value, 1); break;
+                case 262: putU16(value, 2); break;
+                case 277: putU16(value, 3); break;
+                case 278: putU32(value, rows_per_strip); break;
+                case 282:
+                case 283: putU32(value, 72); putU32(value, 1); break;
+                case 284: putU16(value, 1); break;
+                case 296: putU16(value, 2); break;
+                case 273:
+                case 279:
+                    for (int strip = 0; strip < strips; strip++) {
+                        uint64_t number = entry.tag == 273
+                            ? data_start + strip * strip_bytes
+                            : std::min(strip_bytes, data_size - strip * strip_bytes);
+                        if (big) {
+                            putU64(value, number);
+                        } else {
+                            putU32(value, static_cast<uint32_t>(number));
+                        }
+                    }
+                    break;
+            }
+        }
+
+        std::vector<uint8_t> out;
+        out.push_back('I');
+        out.push_back('I');
+        if (big) {
+            putU16(out, 43);
+            putU16(out, 8);
+            putU16(out, 0);
+            putU64(out, header_size);
+            putU64(out, entries.size());
+        } else {
+            putU16(out, 42);
+            putU32(out, static_cast<uint32_t>(header_size));
+            putU16(out, static_cast<uint16_t>(entries.size()));
+        }
+
+        std::vector<uint8_t> extra;
+        uint64_t extra_start = header_size + ifd_size;
+        for (const Entry& entry : entries) {
+            putU16(out, entry.tag);
+            putU16(out, entry.type);
+            big ? putU64(out, entry.count) : putU32(out, static_cast<uint32_t>(entry.count));
+            if (entry.value.size() <= inline_size) {
+                std::vector<uint8_t> field = entry.value;
+                field.resize(inline_size, 0);
+                out.insert(out.end(), field.begin(), field.end());
+            } else {
+                uint64_t offset = extra_start + extra.size();
+                big ? putU64(out, offset) : putU32(out, static_cast<uint32_t>(offset));
+                extra.insert(extra.end(), entry.value.begin(), entry.value.end());
+                if (extra.size() & 1) {
+                    extra.push_back(0);
+                }
+            }
+        }
+        big ? putU64(out, 0) : putU32(out, 0);  // No next IFD
+        out.insert(out.end(), extra.begin(), extra.end());
+        return out;
+    }
+};
+
+#ifdef FRACTAL_HAVE_ZLIB
+// PNG whose zlib stream is raw deflate framed by hand: each band is one
+// IDAT, deflated with a full flush so that a resumed write can start a fresh
+// compressor there, and the Adler-32 is carried in the checkpoint. Rows are
+// Paeth-filtered, except the first of a band (Sub), which has no row above
+// it after a resume.
+class PngWriter : public ImageWriter {
+public:
+    PngWriter() {
+        std::memset(&stream_, 0, sizeof(stream_));
+        ready_ = deflateInit2(&stream_, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -15, 8,
+                              Z_DEFAULT_STRATEGY) == Z_OK;
+    }
+
+    ~PngWriter() override {
+        if (ready_) {
+            deflateEnd(&stream_);
+        }
+    }
+
+protected:
+    bool writeHeader() override {
+        static const uint8_t signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'};
+        if (!ready_ || !write(signature, sizeof(signature))) {
+            return false;
+        }
+
+        std::vector<uint8_t> header;
+        putU32BigEndian(header, width_);
+        putU32BigEndian(header, height_);
+        header.push_back(8);  // Bit depth
+        header.push_back(2);  // Truecolor
+        header.push_back(0);  // Deflate
+        header.push_back(0);  // Adaptive filtering
+        header.push_back(0);  // No interlace
+        static const uint8_t zlib_header[2] = {0x78, 0x01};
+        checkpoint_.checksum = adler32(0, nullptr, 0);
+        return writeChunk("IHDR", header.data(), header.size()) &&
+               writeChunk("IDAT", zlib_header, sizeof(zlib_header));
+    }
+
+    bool resumeFrom(const ImageCheckpoint&) override {
+        return ready_;
+    }
+
+    bool writeRGB(const uint8_t* rgb, int rows) override {
+        size_t row_bytes = static_cast<size_t>(width_) * 3;
+        filtered_.resize((row_bytes + 1) * rows);
+        for (int y = 0; y < rows; y++) {
+            const uint8_t* row = rgb + y * row_bytes;
+            const uint8_t* above = y > 0 ? row - row_bytes : nullptr;
+            uint8_t* out = &filtered_[y * (row_bytes + 1)];
+            out[0] = above ? 4 : 1;
+            for (size_t i = 0; i < row_bytes; i++) {
+                int left = i >= 3 ? row[i - 3] : 0;
+                if (!above) {
+                    out[i + 1] = static_cast<uint8_t>(row[i] - left);
+                    continue;
+                }
+                int up = above[i];
+                int up_left = i >= 3 ? above[i - 3] : 0;
+                int estimate = left + up - up_left;
+                int distance_left = std::abs(estimate - left);
+                int distance_up = std::abs(estimate - up);
+                int distance_up_left = std::abs(estimate - up_left);
+                int predictor = distance_left <= distance_up && distance_left <= distance_up_left
+                    ? left : distance_up <= distance_up_left ? up : up_left;
+                out[i + 1] = static_cast<uint8_t>(row[i] - predictor);
+            }
+        }
+
+        checkpoint_.checksum = adler32(checkpoint_.checksum, filtered_.data(),
+                                       static_cast<uInt>(filtered_.size()));
+        return deflateChunk(filtered_.data(), filtered_.size(), Z_FULL_FLUSH);
+    }
+
+    bool writeTrailer() override {
+        if (!deflateChunk(nullptr, 0, Z_FINISH)) {
+            return false;
+        }
+        std::vector<uint8_t> adler;
+        putU32BigEndian(adler, checkpoint_.checksum);
+        return writeChunk("IDAT", adler.data(), adler.size()) && writeChunk("IEND", nullptr, 0);
+    }
+
+private:
+    // Compress data and write the output as one IDAT chunk
+    bool deflateChunk(const uint8_t* data, size_t size, int flush) {
+        compressed_.clear();
+        stream_.next_in = const_cast<Bytef*>(data);
+        stream_.avail_in = static_cast<uInt>(size);
+        uint8_t buffer[1 << 16];
+        int result;
+        do {
+            stream_.next_out = buffer;
+            stream_.avail_out = sizeof(buffer);
+            result = deflate(&stream_, flush);
+            if (result == Z_STREAM_ERROR) {
+                return false;
+            }
+            compressed_.insert(compressed_.end(), buffer,
+                               buffer + sizeof(buffer) - stream_.avail_out);
+        } while (stream_.avail_out == 0 || (flush == Z_FINISH && result != Z_STREAM_END));
+        return writeChunk("IDAT", compressed_.data(), compressed_.size());
+    }
+
+    bool writeChunk(const char* type, const uint8_t* data, size_t size) {
+        std::vector<uint8_t> length;
+        putU32BigEndian(length, static_cast<uint32_t>(size));
+        uLong crc = crc32(0, reinterpret_cast<const Bytef*>(type), 4);
+        if (size) {
+            crc = crc32(crc, data, static_cast<uInt>(size));
+        }
+        std::vector<uint8_t> trailer;
+        putU32BigEndian(trailer, static_cast<uint32_t>(crc));
+        return write(length.data(), length.size()) && write(type, 4) &&
+               (!size || write(data, size)) && write(trailer.data(), trailer.size());
+    }
+
+    z_stream stream_;
+    bool ready_;
+    std::vector<uint8_t> filtered_;
+    std::vector<uint8_t> compressed_;
+};
+#endif
+
+} // namespace
+
+std::unique_ptr<ImageWriter> ImageWriter::create(Format format) {
+    switch (format) {
+        case FORMAT_PPM:
+            return std::make_unique<PpmWriter>();
+        case FORMAT_TIFF:
+            return std::make_unique<TiffWriter>();
+        case FORMAT_PNG:
+#ifdef FRACTAL_HAVE_ZLIB
+            return std::make_unique<PngWriter>();
+#else
+            return nullptr;
+#endif
+    }
+    return nullptr;
+}
+
+bool ImageWriter::formatFromPath(const std::string& path, Format& format) {
+    std::string extension = std::filesystem::path(path).extension().string();
+    std::transform(extension.begin(), extension.end(), extension.begin(),
+                   [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    if (extension == ".ppm") {
+        format = FORMAT_PPM;
+    } else if (extension == ".png") {
+        format = FORMAT_PNG;
+    } else if (extension == ".tif" || extension == ".tiff") {
+        format = FORMAT_TIFF;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+const char* ImageWriter::formatName(Format format) {
+    switch (format) {
+        case FORMAT_PPM: return "ppm";
+        case FORMAT_PNG: return "png";
+        case FORMAT_TIFF: return "tiff";
+    }
+    return "unknown";
+}
+
+ImageWriter::ImageWriter() : width_(0), height_(0), memory_(nullptr) {
+}
+
+ImageWriter::~ImageWriter() {
+}
+
+bool ImageWriter::open(const std::string& path, int width, int height,
+                       const ImageCheckpoint* resume) {
+    width_ = width;
+    height_ = height;
+    if (width <= 0 || height <= 0) {
+        return false;
+    }
+
+    if (!resume) {
+        checkpoint_ = ImageCheckpoint();
+        file_.open(path, std::ios::binary | std::ios::out | std::ios::trunc);
+        return file_ && writeHeader() && file_.flush();
+    }
+
+    // Drop whatever was written after the checkpoint
+    if (resume->rows > height || !truncateForResume(path, resume->file_size)) {
+        return false;
+    }
+    file_.open(path, std::ios::binary | std::ios::in | std::ios::out);
+    file_.seekp(0, std::ios::end);
+    checkpoint_ = *resume;
+    return file_ && resumeFrom(*resume);
+}
+
+bool ImageWriter::writeRows(const uint8_t* rgba, int rows) {
+    if (rows <= 0 || checkpoint_.rows + rows > height_) {
+        return false;
+    }
+    TraceSpan span("writeRows", "io", 0, checkpoint_.rows, width_, rows);
+
+    if (!writeRGB(packRGB(rgba, rows), rows) || !file_.flush()) {
+        return false;
+    }
+    checkpoint_.rows += rows;
+    return true;
+}
+
+bool ImageWriter::encode(const uint8_t* rgba, int width, int height,
+                         std::vector<uint8_t>& bytes) {
+    width_ = width;
+    height_ = height;
+    if (width <= 0 || height <= 0) {
+        return false;
+    }
+    checkpoint_ = ImageCheckpoint();
+    bytes.clear();
+    memory_ = &bytes;
+    bool encoded = writeHeader() && writeRGB(packRGB(rgba, height), height);
+    checkpoint_.rows = height;
+    encoded = encoded && writeTrailer();
+    memory_ = nullptr;
+    return encoded;
+}
+
+bool ImageWriter::finish() {
+    if (checkpoint_.rows != height_ || !writeTrailer()) {
+        return false;
+    }
+    file_.close();
+    return !file_.fail();
+}
+
+bool ImageWriter::resumeFrom(const ImageCheckpoint&) {
+    return true;
+}
+
+bool ImageWriter::writeTrailer() {
+    return true;
+}
+
+const uint8_t* ImageWriter::packRGB(const uint8_t* rgba, int rows) {
+    size_t pixels = static_cast<size_t>(width_) * rows;
+    rgb_.resize(pixels * 3);
+    for (size_t i = 0; i < pixels; i++) {
+        rgb_[i * 3] = rgba[i * 4];
+        rgb_[i * 3 + 1] = rgba[i * 4 + 1];
+        rgb_[i * 3 + 2] = rgba[i * 4 + 2];
+    }
+    return rgb_.data();
+}
+
+bool ImageWriter::write(const void* data, size_t size) {
+    checkpoint_.file_size += size;
+    if (memory_) {
+        const uint8_t* bytes = static_cast<const uint8_t*>(data);
+        memory_->insert(memory_->end(), bytes, bytes + size);
+        return true;
+    }
+    file_.write(static_cast<const char*>(data), static_cast<std::streamsize>(size));
+    return static_cast<bool>(file_);
+}
+
+} // namespace fractal
@@ -0,0 +1,96 @@
+#ifndef IMAGE_WRITER_H
+#define IMAGE_WRITER_H
+
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace fractal {
+
+// How far a streamed image has been written: the rows so far, the file
+// length after them and the running checksum the format needs to append
+// more (PNG's zlib Adler-32). Enough to resume an interrupted write.
+struct ImageCheckpoint {
+    int rows;
+    uint64_t file_size;
+    uint32_t checksum;
+
+    ImageCheckpoint() : rows(0), file_size(0), checksum(1) {}
+};
+
+// Streams an 8-bit RGB image to disk a band of rows at a time, so an image
+// far larger than memory can be written from RGBA bands (alpha is dropped).
+// Every format writes its header up front and appends rows, so a file cut
+// off after a checkpoint can be truncated back to it and continued.
+class ImageWriter {
+public:
+    enum Format {
+        FORMAT_PPM,
+        FORMAT_PNG,   // Needs zlib (FRACTAL_HAVE_ZLIB)
+        FORMAT_TIFF   // Uncompressed; BigTIFF past 4 GiB
+    };
+
+    // Writer for format, or null if this build cannot write it
+    static std::unique_ptr<ImageWriter> create(Format format);
+
+    // Format from a file extension (.ppm, .png, .tif/.tiff); false if unknown
+    static bool formatFromPath(const std::string& path, Format& format);
+    static const char* formatName(Format format);
+
+    virtual ~ImageWriter();
+
+    // Create the file and write the header, or with resume reopen a file
+    // written up to that checkpoint, truncate anything after it and
+    // continue from there. Returns false on I/O errors.
+    bool open(const std::string& path, int width, int height,
+              const ImageCheckpoint* resume = nullptr);
+
+    // Append rows of RGBA, width * 4 bytes apart. Flushed to the OS before
+    // returning, so checkpoint() is then safe to record.
+    bool writeRows(const uint8_t* rgba, int rows);
+
+    // Write the trailer once every row is in and close the file
+    bool finish();
+
+    // Encode a whole RGBA image into bytes instead of a file, for
+    // containers of many small images. Like open(), once per writer.
+    bool encode(const uint8_t* rgba, int width, int height, std::vector<uint8_t>& bytes);
+
+    ImageCheckpoint checkpoint() const { return checkpoint_; }
+    int width() const { return width_; }
+    int height() const { return height_; }
+
+protected:
+    ImageWriter();
+
+    // Header for a new file, written at offset 0
+    virtual bool writeHeader() = 0;
+
+    // Restore format state from a checkpoint after the file is reopened
+    virtual bool resumeFrom(const ImageCheckpoint& checkpoint);
+
+    // Append rows whose RGB bytes are packed in rgb (width * 3 per row)
+    virtual bool writeRGB(const uint8_t* rgb, int rows) = 0;
+
+    virtual bool writeTrailer();
+
+    bool write(const void* data, size_t size);
+
+    std::ofstream file_;
+    int width_;
+    int height_;
+    ImageCheckpoint checkpoint_;
+
+private:
+    // RGB bytes of rows of RGBA, in rgb_
+    const uint8_t* packRGB(const uint8_t* rgba, int rows);
+
+    std::vector<uint8_t> rgb_;
+    std::vector<uint8_t>* memory_;  // Where write() appends while encoding
+};
+
+} // namespace fractal
+
+#endif // IMAGE_WRITER_H
@@ -0,0 +1,47 @@
+#include "progress_file.h"
+#include "../core/color_palette.h"
+#include <cstdio>
+#include <iomanip>
+
+namespace fractal {
+
+void writeParamsSignature(std::ostream& out, const RenderParams& params) {
+    out << " iter " << params.max_iterations << " " << params.bailout_radius
+        << " " << params.smooth_coloring << " " << params.precision
+        << " " << params.periodicity_check << " " << params.subdivide
+        << " color " << params.palette_id << " " << params.color_offset
+        << " " << params.color_speed << " " << params.color_iterations
+        << " aa " << params.antialias_samples << " " << params.antialias_threshold;
+    if (params.palette) {
+        out << " palette " << std::hex << std::setfill('0');
+        for (const Color& color : params.palette->colors()) {
+            out << std::setw(2) << static_cast<int>(color.r) << std::setw(2)
+                << static_cast<int>(color.g) << std::setw(2) << static_cast<int>(color.b);
+        }
+        out << std::dec << std::setfill(' ');
+    }
+}
+
+bool readProgress(const std::string& path, const char* magic, const std::string& signature,
+                  std::ifstream& file) {
+    file.open(path, std::ios::binary);
+    std::string magic_line, job;
+    return std::getline(file, magic_line) && magic_line == magic &&
+           std::getline(file, job) && job == signature;
+}
+
+bool writeProgress(const std::string& path, const char* magic, const std::string& signature,
+                   const std::function<void(std::ostream&)>& write_state) {
+    std::string temporary = path + ".tmp";
+    {
+        std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+        file << magic << "\n" << signature << "\n";
+        write_state(file);
+        if (!file.flush()) {
+            return false;
+        }
+    }
+    return std::rename(temporary.c_str(), path.c_str()) == 0;
+}
+
+} // namespace fractal
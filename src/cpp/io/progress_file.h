@@ -0,0 +1,35 @@
+#ifndef PROGRESS_FILE_H
+#define PROGRESS_FILE_H
+
+#include "../core/fractal_engine.h"
+#include <fstream>
+#include <functional>
+#include <ostream>
+#include <string>
+
+namespace fractal {
+
+// Progress files of resumable jobs: a magic line naming the job kind, a
+// line with the job's signature, then whatever state the job needs to
+// continue. A run only resumes from a file whose first two lines match its
+// own, so changing any setting starts the job over.
+
+// Append params' iteration, coloring and anti-aliasing settings to a
+// signature line. A custom palette is identified by its colors, since the
+// pointer does not outlive the run.
+void writeParamsSignature(std::ostream& out, const RenderParams& params);
+
+// Open the progress file at path if it has this magic and signature; the
+// job's state can then be read from file
+bool readProgress(const std::string& path, const char* magic, const std::string& signature,
+                  std::ifstream& file);
+
+// Replace the progress file at path with magic, signature and the state
+// write_state appends. The file is written aside and renamed over the old
+// one, so an interruption leaves either the previous progress or this one.
+bool writeProgress(const std::string& path, const char* magic, const std::string& signature,
+                   const std::function<void(std::ostream&)>& write_state);
+
+} // namespace fractal
+
+#endif // PROGRESS_FILE_H
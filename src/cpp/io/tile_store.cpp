@@ -0,0 +1,212 @@
+#include "tile_store.h"
+#include "binary_file.h"
+#include <cstring>
+#include <filesystem>
+#include <system_error>
+
+namespace fractal {
+
+namespace {
+
+const char kArchiveMagic[4] = {'F', 'P', 'Y', 'R'};
+const uint32_t kArchiveVersion = 1;
+
+uint64_t archiveTileCount(int levels) {
+    return ArchiveTileStore::tileIndex(levels, 0, 0);
+}
+
+int log2Of(int value) {
+    int log = 0;
+    while ((1 << (log + 1)) <= value) {
+        log++;
+    }
+    return log;
+}
+
+// XYZ or Deep Zoom: one file per tile. Files are simply rewritten on resume,
+// since every tile after the checkpoint is rendered again.
+class DirectoryTileStore : public TileStore {
+public:
+    explicit DirectoryTileStore(bool deep_zoom) : deep_zoom_(deep_zoom), tile_size_(0),
+                                                  levels_(0) {}
+
+    bool open(const std::string& path, int tile_size, int levels, ImageWriter::Format format,
+              const uint64_t*) override {
+        path_ = path;
+        tile_size_ = tile_size;
+        levels_ = levels;
+        extension_ = std::string(".") + ImageWriter::formatName(format);
+        if (deep_zoom_) {
+            std::filesystem::path descriptor(path);
+            root_ = descriptor.parent_path() / (descriptor.stem().string() + "_files");
+        } else {
+            root_ = path;
+        }
+        std::error_code error;
+        std::filesystem::create_directories(root_, error);
+        return std::filesystem::is_directory(root_, error);
+    }
+
+    bool writeTile(int level, int x, int y, const std::vector<uint8_t>& bytes) override {
+        std::filesystem::path file;
+        if (deep_zoom_) {
+            // Deep Zoom numbers levels from the 1x1 image up
+            file = root_ / std::to_string(level + log2Of(tile_size_)) /
+                   (std::to_string(x) + "_" + std::to_string(y) + extension_);
+        } else if (level >= 0) {
+            file = root_ / std::to_string(level) / std::to_string(x) /
+                   (std::to_string(y) + extension_);
+        } else {
+            return true;
+        }
+
+        // Creating a directory another thread just made is not an error;
+        // failing to open the file below is
+        std::error_code error;
+        std::filesystem::create_directories(file.parent_path(), error);
+        std::ofstream out(file, std::ios::binary | std::ios::trunc);
+        out.write(reinterpret_cast<const char*>(bytes.data()),
+                  static_cast<std::streamsize>(bytes.size()));
+        return static_cast<bool>(out.flush());
+    }
+
+    int overviewLevels() const override {
+        return deep_zoom_ ? log2Of(tile_size_) : 0;
+    }
+
+    bool sync(uint64_t& checkpoint) override {
+        checkpoint = 0;
+        return true;
+    }
+
+    bool finish() override {
+        if (!deep_zoom_) {
+            return true;
+        }
+        // Written last, so a descriptor means a complete pyramid
+        int64_t size = static_cast<int64_t>(tile_size_) << (levels_ - 1);
+        std::ofstream out(path_, std::ios::trunc);
+        out << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+            << "<Image xmlns=\"http://schemas.microsoft.com/deepzoom/2008\" Format=\""
+            << extension_.substr(1) << "\" Overlap=\"0\" TileSize=\"" << tile_size_ << "\">\n"
+            << "  <Size Width=\"" << size << "\" Height=\"" << size << "\"/>\n"
+            << "</Image>\n";
+        return static_cast<bool>(out.flush());
+    }
+
+private:
+    bool deep_zoom_;
+    std::string path_;
+    std::filesystem::path root_;
+    std::string extension_;
+    int tile_size_;
+    int levels_;
+};
+
+} // namespace
+
+bool TileStore::layoutFromName(const std::string& name, Layout& layout) {
+    if (name == "xyz") {
+        layout = LAYOUT_XYZ;
+    } else if (name == "dzi") {
+        layout = LAYOUT_DEEP_ZOOM;
+    } else if (name == "archive") {
+        layout = LAYOUT_ARCHIVE;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+const char* TileStore::layoutName(Layout layout) {
+    switch (layout) {
+        case LAYOUT_XYZ: return "xyz";
+        case LAYOUT_DEEP_ZOOM: return "dzi";
+        case LAYOUT_ARCHIVE: return "archive";
+    }
+    return "unknown";
+}
+
+std::unique_ptr<TileStore> TileStore::create(Layout layout) {
+    switch (layout) {
+        case LAYOUT_XYZ:
+            return std::make_unique<DirectoryTileStore>(false);
+        case LAYOUT_DEEP_ZOOM:
+            return std::make_unique<DirectoryTileStore>(true);
+        case LAYOUT_ARCHIVE:
+            return std::make_unique<ArchiveTileStore>();
+    }
+    return nullptr;
+}
+
+TileStore::~TileStore() {
+}
+
+uint64_t ArchiveTileStore::tileIndex(int level, int x, int y) {
+    return ((uint64_t(1) << (2 * level)) - 1) / 3 + (static_cast<uint64_t>(y) << level) + x;
+}
+
+bool ArchiveTileStore::open(const std::string& path, int tile_size, int levels,
+                            ImageWriter::Format format, const uint64_t* resume) {
+    levels_ = levels;
+    uint8_t header[kHeaderSize] = {};
+    std::memcpy(header, kArchiveMagic, 4);
+    putU32(header + 4, kArchiveVersion);
+    putU32(header + 8, tile_size);
+    putU32(header + 12, levels);
+    putU32(header + 16, format);
+    putU32(header + 20, 0);
+    putU64(header + 24, archiveTileCount(levels));
+    return file_.open(path, header, kHeaderSize, archiveTileCount(levels), resume);
+}
+
+bool ArchiveTileStore::writeTile(int level, int x, int y, const std::vector<uint8_t>& bytes) {
+    if (level < 0) {
+        return true;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    return file_.append(tileIndex(level, x, y), bytes.data(), bytes.size());
+}
+
+bool ArchiveTileStore::sync(uint64_t& checkpoint) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    checkpoint = file_.size();
+    return file_.flush();
+}
+
+bool ArchiveTileStore::finish() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return file_.finish(20);
+}
+
+bool ArchiveTileStore::readTile(const std::string& path, int level, int x, int y,
+                                std::vector<uint8_t>& bytes) {
+    std::ifstream file(path, std::ios::binary);
+    uint8_t header[kHeaderSize];
+    if (!file.read(reinterpret_cast<char*>(header), kHeaderSize) ||
+        std::memcmp(header, kArchiveMagic, 4) != 0 || getU32(header + 4) != kArchiveVersion) {
+        return false;
+    }
+    int levels = static_cast<int>(getU32(header + 12));
+    if (level < 0 || level >= levels || x < 0 || y < 0 || x >= (1 << level) ||
+        y >= (1 << level)) {
+        return false;
+    }
+
+    uint8_t entry[16];
+    file.seekg(static_cast<std::streamoff>(kHeaderSize + tileIndex(level, x, y) * 16));
+    if (!file.read(reinterpret_cast<char*>(entry), sizeof(entry))) {
+        return false;
+    }
+    uint64_t offset = getU64(entry);
+    uint64_t size = getU64(entry + 8);
+    if (!offset) {
+        return false;  // Not written yet
+    }
+    bytes.resize(size);
+    file.seekg(static_cast<std::streamoff>(offset));
+    return static_cast<bool>(file.read(reinterpret_cast<char*>(bytes.data()),
+                                       static_cast<std::streamsize>(size)));
+}
+
+} // namespace fractal
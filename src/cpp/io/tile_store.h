@@ -0,0 +1,89 @@
+#ifndef TILE_STORE_H
+#define TILE_STORE_H
+
+#include "binary_file.h"
+#include "image_writer.h"
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace fractal {
+
+// Where the encoded tiles of a pyramid go. Level z of a pyramid is 2^z x 2^z
+// tiles, level 0 being the whole region in one tile. Tiles can be written
+// from several threads at once and in any order.
+class TileStore {
+public:
+    enum Layout {
+        LAYOUT_XYZ,        // path/z/x/y.ext, as map viewers fetch them
+        LAYOUT_DEEP_ZOOM,  // path is the .dzi descriptor, tiles in <stem>_files/
+        LAYOUT_ARCHIVE     // path is one indexed file (see ArchiveTileStore)
+    };
+
+    // Layout from its name (xyz, dzi, archive); false if unknown
+    static bool layoutFromName(const std::string& name, Layout& layout);
+    static const char* layoutName(Layout layout);
+    static std::unique_ptr<TileStore> create(Layout layout);
+
+    virtual ~TileStore();
+
+    // Prepare path for levels levels of tile_size tiles in format. With
+    // resume, reopen a store left at that checkpoint() and drop anything
+    // written after it. Returns false on I/O errors.
+    virtual bool open(const std::string& path, int tile_size, int levels,
+                      ImageWriter::Format format, const uint64_t* resume) = 0;
+
+    // Store one encoded tile. Levels below 0 are the overview images
+    // smaller than a tile that some layouts want: level -k is the level 0
+    // tile shrunk 2^k times.
+    virtual bool writeTile(int level, int x, int y, const std::vector<uint8_t>& bytes) = 0;
+
+    // Overview levels this layout wants (the -k of writeTile)
+    virtual int overviewLevels() const { return 0; }
+
+    // Flush the tiles written so far to the OS and return a checkpoint
+    // that open() can resume from
+    virtual bool sync(uint64_t& checkpoint) = 0;
+
+    virtual bool finish() = 0;
+};
+
+// Every tile in one file (little-endian):
+//
+//   header  "FPYR", u32 version (1), u32 tile_size, u32 levels,
+//           u32 format (ImageWriter::Format), u32 complete (1 once finished),
+//           u64 tile count
+//   index   u64 offset, u64 size per tile, level by level and row by row,
+//           so tile (z, x, y) is entry (4^z - 1) / 3 + y * 2^z + x
+//   tiles   the encoded images, in the order they were written
+//
+// Tiles are appended and their index entries filled in place, so the file
+// is usable without a separate index and a truncated one can be resumed.
+class ArchiveTileStore : public TileStore {
+public:
+    static const int kHeaderSize = 32;
+
+    // One tile of a finished archive
+    static bool readTile(const std::string& path, int level, int x, int y,
+                         std::vector<uint8_t>& bytes);
+
+    static uint64_t tileIndex(int level, int x, int y);
+
+    bool open(const std::string& path, int tile_size, int levels, ImageWriter::Format format,
+              const uint64_t* resume) override;
+    bool writeTile(int level, int x, int y, const std::vector<uint8_t>& bytes) override;
+    bool sync(uint64_t& checkpoint) override;
+    bool finish() override;
+
+private:
+    IndexedFile file_;
+    std::mutex mutex_;
+    int levels_;
+};
+
+} // namespace fractal
+
+#endif // TILE_STORE_H
@@ -7,10 +7,90 @@
  */
 
 #include "core/fractal_engine.h"
+#include "core/fractal_family.h"
+#include "core/trace_recorder.h"
 #include "rendering/viewport.h"
+#include "rendering/tile_manager.h"
+#include "rendering/render_scheduler.h"
+#include "rendering/tile_cache.h"
+#include "rendering/pan_renderer.h"
+#include "rendering/progressive_renderer.h"
+#include "rendering/render_session.h"
+#include "rendering/zoom_video.h"
+#include "rendering/pyramid_renderer.h"
+#include "io/field_file.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
 #include <iostream>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
 
 #ifndef __EMSCRIPTEN__
+// Percentage of pixels whose color differs noticeably between two renders
+static double percentDiffering(const std::vector<uint8_t>& a, const std::vector<uint8_t>& b) {
+    int differing = 0;
+    for (size_t i = 0; i < a.size(); i += 4) {
+        int delta = std::abs(a[i] - b[i]) + std::abs(a[i + 1] - b[i + 1]) +
+                    std::abs(a[i + 2] - b[i + 2]);
+        if (delta > 8) {
+            differing++;
+        }
+    }
+    return 100.0 * differing / (a.size() / 4);
+}
+
+// Number of distinct RGB colors in a frame
+static size_t distinctColors(const std::vector<uint8_t>& frame) {
+    std::unordered_set<uint32_t> colors;
+    for (size_t i = 0; i < frame.size(); i += 4) {
+        colors.insert(frame[i] | frame[i + 1] << 8 | frame[i + 2] << 16);
+    }
+    return colors.size();
+}
+
+// Hot-path counters of a render (profiling builds only)
+static void printRenderStats(const char* name, const fractal::RenderStats& stats) {
+    std::cout << name << " counters: " << stats.pixels << " pixels, " << stats.points
+              << " points (" << stats.bulb_skipped << " cardioid/bulb, " << stats.periodic
+              << " periodic, " << stats.escaped << " escaped, " << stats.limit_reached
+              << " at the limit), " << stats.iterations << " iterations, iterate "
+              << stats.iterate_ms << " ms, color " << stats.color_ms << " ms" << std::endl;
+    std::cout << name << " escape counts by bit length:";
+    for (int bin = 0; bin < fractal::RenderStats::kHistogramBins; bin++) {
+        if (stats.escape_histogram[bin]) {
+            std::cout << " " << bin << ":" << stats.escape_histogram[bin];
+        }
+    }
+    std::cout << std::endl;
+}
+
+// Render the same view with two precision tiers and report how many pixels
+// disagree. Only boundary pixels, where the orbit is chaotic, should differ.
+static void comparePrecision(const char* name, const fractal::Viewport& viewport,
+                             fractal::Precision lower, fractal::Precision higher,
+                             int max_iterations) {
+    fractal::FractalEngine engine;
+    fractal::RenderParams params;
+    params.max_iterations = max_iterations;
+
+    std::vector<uint8_t> lower_pixels, higher_pixels;
+    params.precision = lower;
+    engine.renderTile(0, 0, viewport.width, viewport.height, viewport, params,
+                      fractal::MANDELBROT, 0.0, 0.0, lower_pixels);
+    params.precision = higher;
+    engine.renderTile(0, 0, viewport.width, viewport.height, viewport, params,
+                      fractal::MANDELBROT, 0.0, 0.0, higher_pixels);
+
+    std::cout << "Precision " << name << ": "
+              << percentDiffering(lower_pixels, higher_pixels) << "% pixels differ" << std::endl;
+}
+
 // Native build main (for testing)
 int main() {
     std::cout << "Fractal Explorer - Native Build" << std::endl;
@@ -28,6 +108,616 @@ int main() {
     auto result = engine.computeMandelbrot(0.0, 0.0, params);
     std::cout << "Point (0,0): iterations=" << result.iterations << std::endl;
 
+    // Check the SIMD batch kernel against the scalar one along a row
+    std::vector<double> row_real(viewport.width), row_imag(viewport.width);
+    std::vector<fractal::FractalPoint> row_points(viewport.width);
+    for (int x = 0; x < viewport.width; x++) {
+        engine.screenToComplex(x, viewport.height / 3, viewport, row_real[x], row_imag[x]);
+    }
+    fractal::familyKernels(fractal::MANDELBROT).batch_double[params.smooth_coloring ? 1 : 0](
+        row_real.data(), row_imag.data(), viewport.width, 0.0, 0.0, params.max_iterations,
+        params.bailout_radius, 0.0, row_points.data(), nullptr, nullptr);
+    int mismatches = 0;
+    for (int x = 0; x < viewport.width; x++) {
+        auto scalar = engine.computeMandelbrot(row_real[x], row_imag[x], params);
+        if (scalar.iterations != row_points[x].iterations ||
+            scalar.smooth_value != row_points[x].smooth_value) {
+            mismatches++;
+        }
+    }
+    std::cout << "Batch kernel vs scalar: " << mismatches << " mismatches" << std::endl;
+
+    // Each precision tier against the next one up, at a scale the lower tier
+    // is selected for
+    comparePrecision("float vs double (scale 4e-3)", viewport,
+                     fractal::PRECISION_FLOAT, fractal::PRECISION_DOUBLE, 1000);
+
+    // Seahorse valley center rounded to a multiple of 2^-44, so the decimal
+    // strings below are exact and every tier sees the same coordinates
+    const char* seahorse_x = "-0.7436438870371375742251984775066375732421875";
+    const char* seahorse_y = "0.13182590420530004848842509090900421142578125";
+    fractal::Viewport seahorse(std::stod(seahorse_x), std::stod(seahorse_y), 1e-12, 96, 72);
+    comparePrecision("double vs double-double (scale 1e-12)", seahorse,
+                     fractal::PRECISION_DOUBLE, fractal::PRECISION_DOUBLE_DOUBLE, 2000);
+
+    // Double-double against the perturbation renderer, whose reference orbit
+    // has far more precision than needed at this depth. The view sits on the
+    // Misiurewicz point c = i, which has structure at every scale.
+    fractal::Viewport misiurewicz(0.0, 1.0, 1e-20, 96, 72);
+    params.max_iterations = 100;
+    params.precision = fractal::PRECISION_DOUBLE_DOUBLE;
+    std::vector<uint8_t> dd_pixels, deep_pixels;
+    engine.renderTile(0, 0, misiurewicz.width, misiurewicz.height, misiurewicz, params,
+                      fractal::MANDELBROT, 0.0, 0.0, dd_pixels);
+    fractal::DeepViewport deep("0", "1", misiurewicz.scale,
+                               misiurewicz.width, misiurewicz.height);
+    engine.renderTileDeep(0, 0, deep.width, deep.height, deep, params, deep_pixels);
+    std::cout << "Precision double-double vs perturbation (scale 1e-20): "
+              << percentDiffering(dd_pixels, deep_pixels) << "% pixels differ" << std::endl;
+
+    // Whole frame on the native thread pool, checked against one big tile
+    fractal::RenderScheduler scheduler;
+    params = fractal::RenderParams();
+    auto tiles = fractal::TileManager::generateTiles(viewport.width, viewport.height);
+    fractal::TileManager::sortByDistanceFromCenter(tiles, viewport.width, viewport.height);
+
+    std::vector<uint8_t> frame, reference_frame;
+    engine.resetRenderStats();
+    auto start = std::chrono::steady_clock::now();
+    scheduler.renderFrame(engine, tiles, viewport, params, fractal::MANDELBROT, 0.0, 0.0, frame);
+    double frame_ms = std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - start).count();
+    fractal::RenderStats frame_stats = engine.renderStats();
+    engine.renderTile(0, 0, viewport.width, viewport.height, viewport, params,
+                      fractal::MANDELBROT, 0.0, 0.0, reference_frame);
+    std::cout << "Frame on " << scheduler.threadCount() << " threads: " << frame_ms << " ms, "
+              << (frame == reference_frame ? "matches" : "DIFFERS FROM")
+              << " single-tile render" << std::endl;
+    if (fractal::RenderStats::enabled()) {
+        printRenderStats("Frame", frame_stats);
+    }
+
+    // Timeline of the same frame, from tile generation through every tile,
+    // in Chrome trace-event format; FRACTAL_TRACE=path writes it out
+    fractal::TraceRecorder trace;
+    fractal::TraceRecorder::setThreadName("main");
+    trace.start();
+    auto traced_tiles = fractal::TileManager::generateTiles(viewport.width, viewport.height);
+    fractal::TileManager::sortByDistanceFromCenter(traced_tiles, viewport.width, viewport.height);
+    scheduler.renderFrame(engine, traced_tiles, viewport, params, fractal::MANDELBROT, 0.0, 0.0,
+                          frame);
+    trace.stop();
+    std::cout << "Trace: " << trace.eventCount() << " events for " << traced_tiles.size()
+              << " tiles";
+    if (const char* trace_path = std::getenv("FRACTAL_TRACE")) {
+        std::cout << (trace.writeFile(trace_path) ? ", written to " : ", FAILED to write ")
+                  << trace_path;
+    }
+    std::cout << std::endl;
+
+    // Palette change from the retained iteration field vs a full re-render
+    fractal::IterationField field;
+    scheduler.renderFrame(engine, tiles, viewport, params, fractal::MANDELBROT, 0.0, 0.0,
+                          frame, &field);
+    params.palette_id = 2;
+    params.color_offset = 0.25;
+    start = std::chrono::steady_clock::now();
+    fractal::FractalEngine::recolorFrame(field, params, frame);
+    double recolor_ms = std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - start).count();
+    engine.renderTile(0, 0, viewport.width, viewport.height, viewport, params,
+                      fractal::MANDELBROT, 0.0, 0.0, reference_frame);
+    std::cout << "Recolor: " << recolor_ms << " ms, "
+              << percentDiffering(frame, reference_frame) << "% pixels differ from re-render"
+              << std::endl;
+
+    // Histogram-equalized recolor of the same field on the thread pool
+    params = fractal::RenderParams();
+    fractal::FractalEngine::recolorFrame(field, params, reference_frame);
+    fractal::ColorHistogram histogram;
+    start = std::chrono::steady_clock::now();
+    scheduler.equalizeFrame(tiles, field, params, frame, &histogram);
+    double equalize_ms = std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - start).count();
+    std::cout << "Equalized recolor: " << equalize_ms << " ms (render " << frame_ms
+              << " ms), " << histogram.total() << " escaped pixels, distinct colors "
+              << distinctColors(reference_frame) << " linear -> " << distinctColors(frame)
+              << " equalized" << std::endl;
+
+    // World-aligned tile cache: a power-of-two view, a pan away and back,
+    // then a zoom out over the rendered region
+    fractal::TileCache cache;
+    fractal::Viewport aligned(-0.5, 0.0, 1.0 / 256, 512, 384);
+    params = fractal::RenderParams();
+    std::vector<uint8_t> cached_frame(static_cast<size_t>(aligned.width) * aligned.height * 4);
+    cache.renderTile(engine, 0, 0, aligned.width, aligned.height, aligned, params,
+                     fractal::MANDELBROT, 0.0, 0.0, cached_frame.data(), aligned.width * 4);
+    engine.renderTile(0, 0, aligned.width, aligned.height, aligned, params,
+                      fractal::MANDELBROT, 0.0, 0.0, reference_frame);
+    std::cout << "Tile cache: " << percentDiffering(cached_frame, reference_frame)
+              << "% pixels differ from direct render, " << cache.misses() << " tiles rendered"
+              << std::endl;
+
+    fractal::Viewport panned = aligned;
+    panned.center_x += 100 * aligned.scale;
+    cache.renderTile(engine, 0, 0, panned.width, panned.height, panned, params,
+                     fractal::MANDELBROT, 0.0, 0.0, cached_frame.data(), panned.width * 4);
+    uint64_t misses = cache.misses();
+    uint64_t hits = cache.hits();
+    cache.renderTile(engine, 0, 0, aligned.width, aligned.height, aligned, params,
+                     fractal::MANDELBROT, 0.0, 0.0, cached_frame.data(), aligned.width * 4);
+    fractal::Viewport zoomed_out = aligned;
+    zoomed_out.scale *= 2;
+    cache.renderTile(engine, 0, 0, zoomed_out.width, zoomed_out.height, zoomed_out, params,
+                     fractal::MANDELBROT, 0.0, 0.0, cached_frame.data(), zoomed_out.width * 4);
+    std::cout << "Tile cache after pan back and zoom out: " << cache.hits() - hits
+              << " hits, " << cache.merges() << " merged, " << cache.misses() - misses
+              << " rendered, " << cache.memoryUsed() / 1024 << " KiB" << std::endl;
+
+    // Incremental pan: shift the retained frame, render the exposed strips
+    fractal::PanRenderer pan_renderer;
+    pan_renderer.render(engine, viewport, params, fractal::MANDELBROT, 0.0, 0.0);
+    int rendered_pixels = 0;
+    for (const auto& rect : pan_renderer.pan(engine, 20, -7)) {
+        rendered_pixels += rect.width * rect.height;
+    }
+    for (const auto& rect : pan_renderer.pan(engine, -3, 12)) {
+        rendered_pixels += rect.width * rect.height;
+    }
+    engine.renderTile(0, 0, viewport.width, viewport.height, pan_renderer.viewport(), params,
+                      fractal::MANDELBROT, 0.0, 0.0, reference_frame);
+    std::cout << "Pan: rendered " << 100.0 * rendered_pixels / (viewport.width * viewport.height)
+              << "% of a frame, " << percentDiffering(pan_renderer.pixels(), reference_frame)
+              << "% pixels differ from full render" << std::endl;
+
+    // Mariani-Silver subdivision on an interior-heavy minibrot view
+    fractal::Viewport minibrot(-1.7548776662466927, 0.0, 4e-6, 320, 240);
+    params = fractal::RenderParams();
+    params.max_iterations = 5000;
+    start = std::chrono::steady_clock::now();
+    engine.renderTile(0, 0, minibrot.width, minibrot.height, minibrot, params,
+                      fractal::MANDELBROT, 0.0, 0.0, reference_frame);
+    double full_ms = std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - start).count();
+    params.subdivide = true;
+    start = std::chrono::steady_clock::now();
+    engine.renderTile(0, 0, minibrot.width, minibrot.height, minibrot, params,
+                      fractal::MANDELBROT, 0.0, 0.0, frame);
+    double subdivided_ms = std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - start).count();
+    std::cout << "Subdivision: " << full_ms << " ms -> " << subdivided_ms << " ms, "
+              << percentDiffering(frame, reference_frame) << "% pixels differ" << std::endl;
+
+    // Adaptive anti-aliasing on a filament-heavy view, against one sample
+    // per pixel and a uniform 16-sample supersample (negative threshold)
+    fractal::Viewport filaments(-0.7435, 0.1314, 2e-6, 320, 240);
+    params = fractal::RenderParams();
+    params.max_iterations = 2000;
+    std::vector<uint8_t> antialiased(static_cast<size_t>(filaments.width) * filaments.height * 4);
+    std::vector<uint8_t> uniform(antialiased.size());
+    engine.renderTile(0, 0, filaments.width, filaments.height, filaments, params,
+                      fractal::MANDELBROT, 0.0, 0.0, reference_frame);
+    params.antialias_samples = 16;
+    start = std::chrono::steady_clock::now();
+    int extra_samples = engine.renderTile(0, 0, filaments.width, filaments.height, filaments,
+                                          params, fractal::MANDELBROT, 0.0, 0.0,
+                                          antialiased.data(), filaments.width * 4);
+    double adaptive_ms = std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - start).count();
+    params.antialias_threshold = -1;
+    start = std::chrono::steady_clock::now();
+    engine.renderTile(0, 0, filaments.width, filaments.height, filaments, params,
+                      fractal::MANDELBROT, 0.0, 0.0, uniform.data(), filaments.width * 4);
+    double uniform_ms = std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - start).count();
+    std::cout << "Anti-aliasing: adaptive " << adaptive_ms << " ms ("
+              << static_cast<double>(extra_samples) / (filaments.width * filaments.height)
+              << " extra samples/pixel), uniform 16x " << uniform_ms << " ms; differs from "
+              << "uniform: " << percentDiffering(reference_frame, uniform) << "% at 1 sample, "
+              << percentDiffering(antialiased, uniform) << "% adaptive" << std::endl;
+
+    // Periodicity check on interior-heavy views, against running every
+    // inside orbit to max_iterations
+    struct CycleView {
+        const char* name;
+        fractal::Viewport viewport;
+        fractal::FractalType type;
+        double c_real, c_imag;
+    };
+    const CycleView cycle_views[] = {
+        {"period-3 bulb", fractal::Viewport(-0.122, 0.745, 1e-3, 320, 240),
+         fractal::MANDELBROT, 0.0, 0.0},
+        {"minibrot", fractal::Viewport(-1.7548776662466927, 0.0, 1e-4, 320, 240),
+         fractal::MANDELBROT, 0.0, 0.0},
+        {"Julia rabbit", fractal::Viewport(0.0, 0.0, 0.008, 320, 240),
+         fractal::JULIA, -0.123, 0.745},
+    };
+    params = fractal::RenderParams();
+    params.max_iterations = 10000;
+    for (const CycleView& view : cycle_views) {
+        params.periodicity_check = false;
+        start = std::chrono::steady_clock::now();
+        engine.renderTile(0, 0, view.viewport.width, view.viewport.height, view.viewport,
+                          params, view.type, view.c_real, view.c_imag, reference_frame);
+        double plain_ms = std::chrono::duration<double, std::milli>(
+            std::chrono::steady_clock::now() - start).count();
+
+        params.periodicity_check = true;
+        engine.resetPeriodicityStats();
+        start = std::chrono::steady_clock::now();
+        engine.renderTile(0, 0, view.viewport.width, view.viewport.height, view.viewport,
+                          params, view.type, view.c_real, view.c_imag, frame);
+        double checked_ms = std::chrono::duration<double, std::milli>(
+            std::chrono::steady_clock::now() - start).count();
+        fractal::PeriodicityStats stats = engine.periodicityStats();
+
+        std::cout << "Periodicity (" << view.name << "): " << plain_ms << " ms -> "
+                  << checked_ms << " ms, " << 100.0 * stats.hits / stats.points
+                  << "% of points periodic, " << percentDiffering(frame, reference_frame)
+                  << "% pixels differ" << std::endl;
+    }
+
+    // Raising the limit 1000 -> 10000: continue the stopped orbits against a
+    // fresh render at 10000, with and without the periodicity check
+    fractal::Viewport boundary(-0.7436, 0.1318, 2e-5, 320, 240);
+    for (bool periodicity : {false, true}) {
+        params = fractal::RenderParams();
+        params.periodicity_check = periodicity;
+        params.max_iterations = 10000;
+        start = std::chrono::steady_clock::now();
+        engine.renderTile(0, 0, boundary.width, boundary.height, boundary, params,
+                          fractal::MANDELBROT, 0.0, 0.0, reference_frame);
+        double fresh_ms = std::chrono::duration<double, std::milli>(
+            std::chrono::steady_clock::now() - start).count();
+
+        fractal::IterationField orbits;
+        orbits.keep_orbits = true;
+        orbits.reset(0, 0, boundary.width, boundary.height);
+        frame.resize(reference_frame.size());
+        params.max_iterations = 1000;
+        engine.renderTile(0, 0, boundary.width, boundary.height, boundary, params,
+                          fractal::MANDELBROT, 0.0, 0.0, frame.data(), boundary.width * 4,
+                          &orbits);
+        params.max_iterations = 10000;
+        start = std::chrono::steady_clock::now();
+        engine.continueTile(0, 0, boundary.width, boundary.height, boundary, params,
+                            fractal::MANDELBROT, 0.0, 0.0, orbits, frame.data(),
+                            boundary.width * 4);
+        double continued_ms = std::chrono::duration<double, std::milli>(
+            std::chrono::steady_clock::now() - start).count();
+
+        std::cout << "Continue 1000 -> 10000 iterations (periodicity "
+                  << (periodicity ? "on" : "off") << "): " << fresh_ms << " ms fresh, "
+                  << continued_ms << " ms continued, "
+                  << percentDiffering(frame, reference_frame) << "% pixels differ" << std::endl;
+    }
+
+    // Nested progressive passes: each pass only computes the samples new to
+    // its grid and continues the earlier ones, against one full render. The
+    // passes share the final color scale, so each one after the first only
+    // redraws the blocks that changed.
+    params = fractal::RenderParams();
+    params.max_iterations = 2000;
+    start = std::chrono::steady_clock::now();
+    engine.renderTile(0, 0, viewport.width, viewport.height, viewport, params,
+                      fractal::MANDELBROT, 0.0, 0.0, reference_frame);
+    double single_ms = std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - start).count();
+
+    fractal::IterationField passes_field;
+    passes_field.keep_orbits = true;
+    passes_field.reset(0, 0, viewport.width, viewport.height);
+    frame.assign(reference_frame.size(), 0);
+    start = std::chrono::steady_clock::now();
+    for (int pass = fractal::PASS_PREVIEW; pass <= fractal::PASS_HIGH; pass++) {
+        fractal::ProgressiveRenderParams pass_params = fractal::ProgressiveRenderer::getPassParams(
+            static_cast<fractal::RenderPass>(pass), params.max_iterations);
+        fractal::RenderParams pass_render = params;
+        pass_render.max_iterations = pass_params.max_iterations;
+        pass_render.color_iterations = params.max_iterations;
+        for (const auto& tile : tiles) {
+            engine.renderTileProgressive(tile.x, tile.y, tile.width, tile.height, viewport,
+                                         pass_render, fractal::MANDELBROT, 0.0, 0.0,
+                                         pass_params.sample_step,
+                                         pass_params.previous_sample_step, passes_field,
+                                         frame.data() + (tile.y * viewport.width + tile.x) * 4,
+                                         viewport.width * 4, pass > fractal::PASS_PREVIEW);
+        }
+    }
+    double passes_ms = std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - start).count();
+    std::cout << "Progressive passes 1/8..1/1: " << passes_ms << " ms vs " << single_ms
+              << " ms for one full render, " << percentDiffering(frame, reference_frame)
+              << "% pixels differ" << std::endl;
+
+    // Automatic iteration limit for a view with a long escape tail, then per
+    // tile: each tile iterates to its own limit, colored against the view's
+    fractal::Viewport valley(0.2850, 0.0110, 1e-5, viewport.width, viewport.height);
+    start = std::chrono::steady_clock::now();
+    fractal::IterationEstimate estimate = fractal::ProgressiveRenderer::estimateIterations(
+        engine, 0, 0, valley.width, valley.height, valley, fractal::MANDELBROT, 0.0, 0.0);
+    double estimate_ms = std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - start).count();
+
+    params = fractal::RenderParams();
+    params.max_iterations = estimate.max_iterations;
+    start = std::chrono::steady_clock::now();
+    engine.renderTile(0, 0, valley.width, valley.height, valley, params, fractal::MANDELBROT,
+                      0.0, 0.0, reference_frame);
+    double view_ms = std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - start).count();
+
+    fractal::RenderParams tile_params = params;
+    tile_params.color_iterations = estimate.max_iterations;
+    int lowest = estimate.max_iterations;
+    start = std::chrono::steady_clock::now();
+    for (const auto& tile : tiles) {
+        tile_params.max_iterations = fractal::ProgressiveRenderer::estimateIterations(
+            engine, tile.x, tile.y, tile.width, tile.height, valley, fractal::MANDELBROT,
+            0.0, 0.0).max_iterations;
+        lowest = std::min(lowest, tile_params.max_iterations);
+        engine.renderTile(tile.x, tile.y, tile.width, tile.height, valley, tile_params,
+                          fractal::MANDELBROT, 0.0, 0.0,
+                          frame.data() + (tile.y * valley.width + tile.x) * 4,
+                          valley.width * 4);
+    }
+    double per_tile_ms = std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - start).count();
+
+    std::cout << "Auto iterations (valley): " << estimate.max_iterations << " in "
+              << estimate_ms << " ms (probe " << estimate.probe_iterations << ", "
+              << estimate.escaped << " escaped, " << estimate.interior << " interior, "
+              << estimate.unresolved << " unresolved of " << estimate.samples
+              << " samples, " << 100.0 * estimate.resolved_fraction << "% resolved); render "
+              << view_ms << " ms, per tile (lowest " << lowest << ") " << per_tile_ms
+              << " ms with estimates, " << percentDiffering(frame, reference_frame)
+              << "% pixels differ" << std::endl;
+
+    // Zoom video from one exponential map against rendering each frame
+    params = fractal::RenderParams();
+    params.max_iterations = 1000;
+    fractal::Viewport zoom_start(-0.743643887, 0.131825904, 0.003 / viewport.width,
+                                 viewport.width, viewport.height);
+    fractal::ZoomPath path = fractal::ZoomPath::fromViewport(
+        zoom_start, 0.98, viewport.width / 2, viewport.height / 2, 120);
+    fractal::ZoomVideoRenderer video(scheduler, engine, path, params, fractal::MANDELBROT,
+                                     0.0, 0.0);
+    double mapped_ms = 0.0, direct_ms = 0.0, worst_difference = 0.0;
+    for (int index = 0; index < path.frame_count; index++) {
+        start = std::chrono::steady_clock::now();
+        video.renderFrame(index, frame);
+        mapped_ms += std::chrono::duration<double, std::milli>(
+            std::chrono::steady_clock::now() - start).count();
+        if (index % 40 == 0) {
+            start = std::chrono::steady_clock::now();
+            scheduler.renderFrame(engine, tiles, path.frame(index), params,
+                                  fractal::MANDELBROT, 0.0, 0.0, reference_frame);
+            direct_ms += std::chrono::duration<double, std::milli>(
+                std::chrono::steady_clock::now() - start).count();
+            worst_difference = std::max(worst_difference,
+                                        percentDiffering(frame, reference_frame));
+        }
+    }
+    double frame_pixels = static_cast<double>(viewport.width) * viewport.height;
+    std::cout << "Zoom video (" << path.frame_count << " frames): " << mapped_ms << " ms vs ~"
+              << direct_ms * path.frame_count / 3 << " ms direct, "
+              << video.pointsComputed() / frame_pixels << " frames of points, up to "
+              << worst_difference << "% pixels differ" << std::endl;
+
+    // Tile pyramid built up from its deepest level against rendering every
+    // tile of every level, checked on the level 0 tile read back from the
+    // archive
+    fractal::PyramidJob pyramid;
+    pyramid.levels = 5;
+    pyramid.tile_size = 128;
+    pyramid.params.max_iterations = 1000;
+    std::string archive = (std::filesystem::temp_directory_path() /
+                           "fractal_native_pyramid.fpyr").string();
+    fractal::PyramidRenderer pyramid_renderer(scheduler);
+    start = std::chrono::steady_clock::now();
+    bool built = pyramid_renderer.render(engine, pyramid, fractal::ImageWriter::FORMAT_PPM,
+                                         fractal::TileStore::LAYOUT_ARCHIVE, archive, false);
+    double pyramid_ms = std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - start).count();
+
+    int pyramid_tile = pyramid.tile_size;
+    std::vector<fractal::Tile> pyramid_tiles;  // Width holds the level
+    for (int level = 0; level < pyramid.levels; level++) {
+        for (int y = 0; y < (1 << level); y++) {
+            for (int x = 0; x < (1 << level); x++) {
+                pyramid_tiles.emplace_back(x, y, level, 0);
+            }
+        }
+    }
+    std::vector<uint8_t> direct_tile(static_cast<size_t>(pyramid_tile) * pyramid_tile * 4);
+    start = std::chrono::steady_clock::now();
+    scheduler.runTasks(pyramid_tiles, [&](const fractal::Tile& tile) {
+        std::vector<uint8_t> pixels(direct_tile.size());
+        engine.renderTile(0, 0, pyramid_tile, pyramid_tile,
+                          pyramid.tileViewport(tile.width, tile.x, tile.y), pyramid.params,
+                          fractal::MANDELBROT, 0.0, 0.0, pixels.data(), pyramid_tile * 4);
+        if (tile.width == 0) {
+            direct_tile = pixels;
+        }
+    });
+    double every_level_ms = std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - start).count();
+
+    // PPM: three header lines, then RGB
+    std::vector<uint8_t> encoded, level0(direct_tile.size(), 255);
+    if (built && fractal::ArchiveTileStore::readTile(archive, 0, 0, 0, encoded)) {
+        size_t rgb_start = encoded.size() - level0.size() / 4 * 3;
+        for (size_t i = 0; i < level0.size() / 4; i++) {
+            std::copy_n(&encoded[rgb_start + i * 3], 3, &level0[i * 4]);
+        }
+    }
+    std::remove(archive.c_str());
+    std::cout << "Tile pyramid (" << pyramid.levels << " levels, " << pyramid.tileCount()
+              << " tiles): " << (built ? "" : "FAILED ") << pyramid_ms << " ms vs "
+              << every_level_ms << " ms rendering every level, level 0 "
+              << percentDiffering(level0, direct_tile) << "% pixels differ (supersampled)"
+              << std::endl;
+
+    // Field files: bytes per pixel, the quantization error bound and the
+    // cost of decoding a region from a cold reader
+    fractal::FieldMetadata field_metadata;
+    field_metadata.viewport = fractal::Viewport(-0.5, 0.0, 3.2 / 1024, 1024, 768);
+    field_metadata.params.max_iterations = 1000;
+    fractal::IterationField saved_field;
+    std::vector<uint8_t> saved_frame;
+    scheduler.renderFrame(engine, fractal::TileManager::generateTiles(1024, 768, 64),
+                          field_metadata.viewport, field_metadata.params, fractal::MANDELBROT,
+                          0.0, 0.0, saved_frame, &saved_field);
+    for (double step : {0.0, 0.05}) {
+        std::string field_path = (std::filesystem::temp_directory_path() /
+                                  "fractal_native_field.ffield").string();
+        fractal::FieldWriter field_writer(step);
+        bool field_saved = field_writer.open(field_path, field_metadata) &&
+                           field_writer.writeRows(saved_field) && field_writer.finish();
+
+        fractal::FieldReader field_reader;
+        fractal::IterationField loaded, region;
+        start = std::chrono::steady_clock::now();
+        bool field_loaded = field_saved && field_reader.open(field_path) &&
+                            field_reader.readRegion(300, 200, 256, 256, region);
+        double region_ms = std::chrono::duration<double, std::milli>(
+            std::chrono::steady_clock::now() - start).count();
+        field_loaded = field_loaded && field_reader.readRegion(0, 0, 1024, 768, loaded);
+
+        double max_error = 0.0;
+        bool same_mask = field_loaded;
+        for (size_t i = 0; field_loaded && i < loaded.smooth_values.size(); i++) {
+            same_mask = same_mask && loaded.inside_set[i] == saved_field.inside_set[i];
+            if (!saved_field.inside_set[i]) {
+                max_error = std::max(max_error, std::abs(static_cast<double>(
+                    loaded.smooth_values[i] - saved_field.smooth_values[i])));
+            }
+        }
+        std::vector<uint8_t> recolored(saved_frame.size());
+        if (field_loaded) {
+            fractal::FractalEngine::recolorFrame(loaded, field_metadata.params, recolored);
+        }
+        std::cout << "Field file (step " << step << "): "
+                  << (field_loaded && same_mask ? "" : "FAILED ")
+                  << field_reader.fileSize() * 8.0 / (1024 * 768) << " bits/pixel, max error "
+                  << max_error << ", 256x256 region in " << region_ms << " ms, "
+                  << percentDiffering(recolored, saved_frame) << "% pixels differ" << std::endl;
+        field_reader.close();
+        std::remove(field_path.c_str());
+    }
+
+    // Formula families, each in its own specialized kernel: how far the
+    // float and double-double tiers drift from double (the Burning Ship's
+    // folded orbits are the most sensitive), and whether continuing orbits
+    // matches a render at the higher limit (exactly only without the
+    // periodicity check, whose detection restarts at the old limit)
+    for (int t = 0; t < fractal::FRACTAL_TYPE_COUNT; t++) {
+        fractal::FractalType type = static_cast<fractal::FractalType>(t);
+        fractal::Viewport family_view(type == fractal::BURNING_SHIP ? -0.4 : -0.3,
+                                      type == fractal::BURNING_SHIP ? -0.6 : 0.0,
+                                      3.2 / 512, 512, 384);
+        fractal::RenderParams family_params;
+        family_params.max_iterations = 500;
+        std::vector<uint8_t> by_precision[3];
+        double family_ms = 0.0;
+        for (int p = 0; p < 3; p++) {
+            family_params.precision = static_cast<fractal::Precision>(p);
+            by_precision[p].resize(512 * 384 * 4);
+            start = std::chrono::steady_clock::now();
+            engine.renderTile(0, 0, 512, 384, family_view, family_params, type, -0.8, 0.156,
+                              by_precision[p].data(), 512 * 4);
+            if (family_params.precision == fractal::PRECISION_DOUBLE) {
+                family_ms = std::chrono::duration<double, std::milli>(
+                    std::chrono::steady_clock::now() - start).count();
+            }
+        }
+
+        fractal::IterationField family_field;
+        family_field.keep_orbits = true;
+        family_field.reset(0, 0, 512, 384);
+        std::vector<uint8_t> continued(512 * 384 * 4), direct(512 * 384 * 4);
+        family_params.precision = fractal::PRECISION_DOUBLE;
+        engine.renderTile(0, 0, 512, 384, family_view, family_params, type, -0.8, 0.156,
+                          continued.data(), 512 * 4, &family_field);
+        family_params.max_iterations *= 4;
+        engine.continueTile(0, 0, 512, 384, family_view, family_params, type, -0.8, 0.156,
+                            family_field, continued.data(), 512 * 4);
+        engine.renderTile(0, 0, 512, 384, family_view, family_params, type, -0.8, 0.156,
+                          direct.data(), 512 * 4);
+
+        std::cout << "Family " << fractal::fractalTypeName(type) << ": " << family_ms
+                  << " ms, float " << percentDiffering(by_precision[fractal::PRECISION_FLOAT],
+                                                       by_precision[fractal::PRECISION_DOUBLE])
+                  << "% / double-double "
+                  << percentDiffering(by_precision[fractal::PRECISION_DOUBLE_DOUBLE],
+                                      by_precision[fractal::PRECISION_DOUBLE])
+                  << "% pixels differ from double, continued "
+                  << percentDiffering(continued, direct) << "% differ" << std::endl;
+    }
+
+    // Render session: units come back pass by pass, nearest the focus
+    // first, and the final passes assemble the full render. Then a tile
+    // that would run for minutes is cancelled by a view update from
+    // another thread.
+    fractal::RenderSession session(engine);
+    fractal::Viewport session_view(-0.7436, 0.1318, 0.01 / 512, 512, 384);
+    fractal::RenderParams session_params;
+    session_params.max_iterations = 2000;
+    std::vector<uint8_t> session_frame(512 * 384 * 4), session_reference;
+    engine.renderTile(0, 0, 512, 384, session_view, session_params, fractal::MANDELBROT, 0.0,
+                      0.0, session_reference);
+    session.update(session_view, session_params, fractal::MANDELBROT, 0.0, 0.0);
+    fractal::SessionTile unit;
+    int units = 0;
+    bool in_order = true;
+    fractal::RenderPass last_pass = fractal::PASS_PREVIEW;
+    while (session.next(unit)) {
+        // Four tiles meet at the frame center
+        in_order = in_order && unit.pass >= last_pass &&
+                   (units > 0 || (std::abs(unit.tile.x - 224) == 32 &&
+                                  std::abs(unit.tile.y - 160) == 32));
+        last_pass = unit.pass;
+        units++;
+        for (int y = 0; unit.pass == fractal::PASS_HIGH && y < unit.tile.height; y++) {
+            std::copy_n(&unit.pixels[static_cast<size_t>(y) * unit.tile.width * 4],
+                        unit.tile.width * 4,
+                        &session_frame[((unit.tile.y + y) * 512 + unit.tile.x) * 4]);
+        }
+    }
+
+    session_params.max_iterations = 2001;
+    session.setFocus(0.0, 0.0);
+    session.update(session_view, session_params, fractal::MANDELBROT, 0.0, 0.0);
+    bool refocused = session.next(unit) && unit.tile.x == 0 && unit.tile.y == 0;
+
+    // Multibrot interior has no closed-form test: with the periodicity
+    // check off every pixel runs to the limit
+    fractal::RenderParams endless;
+    endless.max_iterations = 1000000000;
+    endless.periodicity_check = false;
+    session.update(fractal::Viewport(0.0, 0.0, 0.1 / 512, 512, 384), endless,
+                   fractal::MULTIBROT_3, 0.0, 0.0, fractal::PASS_HIGH);
+    uint64_t endless_frame = session.frame();
+    std::chrono::steady_clock::time_point returned;
+    fractal::SessionTile after_cancel;
+    std::thread session_worker([&] {
+        session.next(after_cancel);
+        returned = std::chrono::steady_clock::now();
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    start = std::chrono::steady_clock::now();
+    session.update(session_view, session_params, fractal::MANDELBROT, 0.0, 0.0,
+                   fractal::PASS_PREVIEW);
+    session_worker.join();
+    double cancel_ms = std::chrono::duration<double, std::milli>(returned - start).count();
+    std::cout << "Render session: " << units << " units "
+              << (in_order && refocused ? "in priority order" : "OUT OF ORDER") << ", "
+              << percentDiffering(session_frame, session_reference)
+              << "% pixels differ from one full render; running tile cancelled, next unit "
+              << (after_cancel.frame > endless_frame ? "from the new view" : "STALE")
+              << " after " << cancel_ms << " ms" << std::endl;
+    session.cancel();
+
     return 0;
 }
 #else
@@ -0,0 +1,162 @@
+/**
+ * Fractal Explorer - Tile pyramid generator
+ *
+ * Renders a square region as an XYZ or Deep Zoom tile pyramid for map-style
+ * viewers, or into one indexed archive file. Only the deepest level is
+ * rendered; every coarser tile is downsampled from its four children:
+ *
+ *   fractal_pyramid --output PATH [--layout xyz|dzi|archive] [--levels N]
+ *                   [--tile-size N] [--center X Y] [--span S]
+ *                   [--iterations N] [--type NAME | --julia CR CI]
+ *                   [--palette ID] [--color-speed S] [--color-offset O]
+ *                   [--antialias N] [--subdivide] [--threads N]
+ *                   [--format png|ppm|tiff] [--resume]
+ *
+ * PATH is a directory for xyz (tiles at PATH/z/x/y.png), the .dzi
+ * descriptor for dzi (tiles beside it in NAME_files/) and a file for
+ * archive. The layout follows a .dzi or .fpyr extension unless given.
+ * --span is the width of the region; --type is as for fractal_render. With
+ * --resume, a run interrupted after some batches continues from the last
+ * one saved (the job must be the same; otherwise it starts over).
+ */
+
+#include "core/fractal_engine.h"
+#include "core/fractal_family.h"
+#include "io/image_writer.h"
+#include "io/tile_store.h"
+#include "rendering/pyramid_renderer.h"
+#include "rendering/render_scheduler.h"
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <string>
+
+namespace {
+
+void usage() {
+    std::cerr << "usage: fractal_pyramid --output PATH [--layout xyz|dzi|archive] [--levels N]\n"
+              << "                       [--tile-size N] [--center X Y] [--span S]\n"
+              << "                       [--iterations N] [--type NAME | --julia CR CI]\n"
+              << "                       [--palette ID] [--color-speed S] [--color-offset O]\n"
+              << "                       [--antialias N] [--subdivide] [--threads N]\n"
+              << "                       [--format png|ppm|tiff] [--resume]" << std::endl;
+}
+
+bool parseFormat(const char* name, fractal::ImageWriter::Format& format) {
+    if (!std::strcmp(name, "ppm")) {
+        format = fractal::ImageWriter::FORMAT_PPM;
+    } else if (!std::strcmp(name, "png")) {
+        format = fractal::ImageWriter::FORMAT_PNG;
+    } else if (!std::strcmp(name, "tiff") || !std::strcmp(name, "tif")) {
+        format = fractal::ImageWriter::FORMAT_TIFF;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    fractal::PyramidJob job;
+    int threads = 0;
+    bool resume = false;
+    bool has_layout = false;
+    fractal::TileStore::Layout layout = fractal::TileStore::LAYOUT_XYZ;
+    fractal::ImageWriter::Format format = fractal::ImageWriter::FORMAT_PNG;
+    std::string output;
+
+    for (int i = 1; i < argc; i++) {
+        int values = argc - i - 1;
+        if (!std::strcmp(argv[i], "--output") && values >= 1) {
+            output = argv[++i];
+        } else if (!std::strcmp(argv[i], "--layout") && values >= 1) {
+            if (!fractal::TileStore::layoutFromName(argv[++i], layout)) {
+                usage();
+                return 1;
+            }
+            has_layout = true;
+        } else if (!std::strcmp(argv[i], "--levels") && values >= 1) {
+            job.levels = std::atoi(argv[++i]);
+        } else if (!std::strcmp(argv[i], "--tile-size") && values >= 1) {
+            job.tile_size = std::atoi(argv[++i]);
+        } else if (!std::strcmp(argv[i], "--center") && values >= 2) {
+            job.center_real = std::atof(argv[++i]);
+            job.center_imag = std::atof(argv[++i]);
+        } else if (!std::strcmp(argv[i], "--span") && values >= 1) {
+            job.span = std::atof(argv[++i]);
+        } else if (!std::strcmp(argv[i], "--iterations") && values >= 1) {
+            job.params.max_iterations = std::atoi(argv[++i]);
+        } else if (!std::strcmp(argv[i], "--type") && values >= 1) {
+            if (!fractal::fractalTypeFromName(argv[++i], job.type)) {
+                usage();
+                return 1;
+            }
+        } else if (!std::strcmp(argv[i], "--julia") && values >= 2) {
+            job.type = fractal::JULIA;
+            job.julia_c_real = std::atof(argv[++i]);
+            job.julia_c_imag = std::atof(argv[++i]);
+        } else if (!std::strcmp(argv[i], "--palette") && values >= 1) {
+            job.params.palette_id = std::atoi(argv[++i]);
+        } else if (!std::strcmp(argv[i], "--color-speed") && values >= 1) {
+            job.params.color_speed = std::atof(argv[++i]);
+        } else if (!std::strcmp(argv[i], "--color-offset") && values >= 1) {
+            job.params.color_offset = std::atof(argv[++i]);
+        } else if (!std::strcmp(argv[i], "--antialias") && values >= 1) {
+            job.params.antialias_samples = std::atoi(argv[++i]);
+        } else if (!std::strcmp(argv[i], "--subdivide")) {
+            job.params.subdivide = true;
+        } else if (!std::strcmp(argv[i], "--threads") && values >= 1) {
+            threads = std::atoi(argv[++i]);
+        } else if (!std::strcmp(argv[i], "--format") && values >= 1) {
+            if (!parseFormat(argv[++i], format)) {
+                usage();
+                return 1;
+            }
+        } else if (!std::strcmp(argv[i], "--resume")) {
+            resume = true;
+        } else {
+            usage();
+            return 1;
+        }
+    }
+    if (output.empty() || !(job.span > 0.0) || job.params.max_iterations < 1) {
+        usage();
+        return 1;
+    }
+    if (!has_layout) {
+        std::string extension = std::filesystem::path(output).extension().string();
+        if (extension == ".dzi") {
+            layout = fractal::TileStore::LAYOUT_DEEP_ZOOM;
+        } else if (extension == ".fpyr") {
+            layout = fractal::TileStore::LAYOUT_ARCHIVE;
+        }
+    }
+
+    fractal::FractalEngine engine;
+    fractal::RenderScheduler scheduler(threads);
+    fractal::PyramidRenderer renderer(scheduler);
+    auto start = std::chrono::steady_clock::now();
+    renderer.setProgressCallback([&](uint64_t tiles, uint64_t total) {
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start)
+                             .count();
+        std::cerr << "\r" << tiles << " / " << total << " tiles, " << seconds << " s"
+                  << std::flush;
+    });
+
+    if (!renderer.render(engine, job, format, layout, output, resume)) {
+        std::cerr << "\n" << renderer.error() << std::endl;
+        return 1;
+    }
+    if (renderer.resumedTiles()) {
+        std::cerr << "\nresumed after " << renderer.resumedTiles() << " tiles";
+    }
+    int64_t size = static_cast<int64_t>(job.tile_size) << (job.levels - 1);
+    std::cerr << "\nwrote " << output << " (" << job.levels << " levels, " << size << "x"
+              << size << " at the deepest, " << fractal::TileStore::layoutName(layout) << ", "
+              << fractal::ImageWriter::formatName(format) << ", " << scheduler.threadCount()
+              << " threads)" << std::endl;
+    return 0;
+}
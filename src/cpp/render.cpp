@@ -0,0 +1,197 @@
+/**
+ * Fractal Explorer - Headless image renderer
+ *
+ * Renders any view to a PNG, PPM or TIFF file of any size, a band of rows at
+ * a time on every core, with memory bounded by two bands rather than the
+ * image:
+ *
+ *   fractal_render --output FILE [--width W] [--height H] [--center X Y]
+ *                  [--span S] [--iterations N] [--type NAME | --julia CR CI]
+ *                  [--palette ID] [--color-speed S] [--color-offset O]
+ *                  [--antialias N] [--subdivide] [--band-rows N]
+ *                  [--threads N] [--format ppm|png|tiff] [--resume]
+ *                  [--field FILE [--field-step Q]]
+ *   fractal_render --output FILE --from-field FILE [--palette ID]
+ *                  [--color-speed S] [--color-offset O] [--band-rows N]
+ *                  [--threads N] [--format ppm|png|tiff]
+ *
+ * --span is the width of the view in the complex plane. --type picks the
+ * formula: mandelbrot (the default), burning-ship, tricorn, multibrot3 or
+ * multibrot4. The format follows the file extension unless given. With
+ * --resume, a run interrupted after some bands continues from the last one
+ * written (the job must be the same; otherwise it starts over).
+ *
+ * --field also saves the iteration field, losslessly or quantized to steps
+ * of Q iterations, and --from-field colors a saved field again without
+ * iterating: its view and coloring are used unless given.
+ */
+
+#include "core/fractal_engine.h"
+#include "core/fractal_family.h"
+#include "io/field_file.h"
+#include "io/image_writer.h"
+#include "rendering/band_renderer.h"
+#include "rendering/render_scheduler.h"
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+namespace {
+
+void usage() {
+    std::cerr << "usage: fractal_render --output FILE [--width W] [--height H] [--center X Y]\n"
+              << "                      [--span S] [--iterations N] [--type NAME | --julia CR CI]\n"
+              << "                      [--palette ID] [--color-speed S] [--color-offset O]\n"
+              << "                      [--antialias N] [--subdivide] [--band-rows N]\n"
+              << "                      [--threads N] [--format ppm|png|tiff] [--resume]\n"
+              << "                      [--field FILE [--field-step Q]]\n"
+              << "       fractal_render --output FILE --from-field FILE [--palette ID]\n"
+              << "                      [--color-speed S] [--color-offset O] [--band-rows N]\n"
+              << "                      [--threads N] [--format ppm|png|tiff]" << std::endl;
+}
+
+bool parseFormat(const char* name, fractal::ImageWriter::Format& format) {
+    if (!std::strcmp(name, "ppm")) {
+        format = fractal::ImageWriter::FORMAT_PPM;
+    } else if (!std::strcmp(name, "png")) {
+        format = fractal::ImageWriter::FORMAT_PNG;
+    } else if (!std::strcmp(name, "tiff") || !std::strcmp(name, "tif")) {
+        format = fractal::ImageWriter::FORMAT_TIFF;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    fractal::BandJob job;
+    job.viewport = fractal::Viewport(-0.5, 0.0, 0.0, 1920, 1080);
+    double span = 3.2;
+    int threads = 0;
+    bool resume = false;
+    bool has_format = false;
+    bool has_palette = false, has_color_speed = false, has_color_offset = false;
+    double field_step = 0.0;
+    fractal::ImageWriter::Format format = fractal::ImageWriter::FORMAT_PNG;
+    std::string output, field_path, from_field;
+
+    for (int i = 1; i < argc; i++) {
+        int values = argc - i - 1;
+        if (!std::strcmp(argv[i], "--output") && values >= 1) {
+            output = argv[++i];
+        } else if (!std::strcmp(argv[i], "--width") && values >= 1) {
+            job.viewport.width = std::atoi(argv[++i]);
+        } else if (!std::strcmp(argv[i], "--height") && values >= 1) {
+            job.viewport.height = std::atoi(argv[++i]);
+        } else if (!std::strcmp(argv[i], "--center") && values >= 2) {
+            job.viewport.center_x = std::atof(argv[++i]);
+            job.viewport.center_y = std::atof(argv[++i]);
+        } else if (!std::strcmp(argv[i], "--span") && values >= 1) {
+            span = std::atof(argv[++i]);
+        } else if (!std::strcmp(argv[i], "--iterations") && values >= 1) {
+            job.params.max_iterations = std::atoi(argv[++i]);
+        } else if (!std::strcmp(argv[i], "--type") && values >= 1) {
+            if (!fractal::fractalTypeFromName(argv[++i], job.type)) {
+                usage();
+                return 1;
+            }
+        } else if (!std::strcmp(argv[i], "--julia") && values >= 2) {
+            job.type = fractal::JULIA;
+            job.julia_c_real = std::atof(argv[++i]);
+            job.julia_c_imag = std::atof(argv[++i]);
+        } else if (!std::strcmp(argv[i], "--palette") && values >= 1) {
+            job.params.palette_id = std::atoi(argv[++i]);
+            has_palette = true;
+        } else if (!std::strcmp(argv[i], "--color-speed") && values >= 1) {
+            job.params.color_speed = std::atof(argv[++i]);
+            has_color_speed = true;
+        } else if (!std::strcmp(argv[i], "--color-offset") && values >= 1) {
+            job.params.color_offset = std::atof(argv[++i]);
+            has_color_offset = true;
+        } else if (!std::strcmp(argv[i], "--antialias") && values >= 1) {
+            job.params.antialias_samples = std::atoi(argv[++i]);
+        } else if (!std::strcmp(argv[i], "--subdivide")) {
+            job.params.subdivide = true;
+        } else if (!std::strcmp(argv[i], "--band-rows") && values >= 1) {
+            job.band_rows = std::atoi(argv[++i]);
+        } else if (!std::strcmp(argv[i], "--threads") && values >= 1) {
+            threads = std::atoi(argv[++i]);
+        } else if (!std::strcmp(argv[i], "--format") && values >= 1) {
+            if (!parseFormat(argv[++i], format)) {
+                usage();
+                return 1;
+            }
+            has_format = true;
+        } else if (!std::strcmp(argv[i], "--resume")) {
+            resume = true;
+        } else if (!std::strcmp(argv[i], "--field") && values >= 1) {
+            field_path = argv[++i];
+        } else if (!std::strcmp(argv[i], "--field-step") && values >= 1) {
+            field_step = std::atof(argv[++i]);
+        } else if (!std::strcmp(argv[i], "--from-field") && values >= 1) {
+            from_field = argv[++i];
+        } else {
+            usage();
+            return 1;
+        }
+    }
+    if (output.empty() || job.viewport.width < 1 || job.viewport.height < 1 || !(span > 0.0) ||
+        job.params.max_iterations < 1 || job.band_rows < 1 || field_step < 0.0 ||
+        (!field_path.empty() && !from_field.empty())) {
+        usage();
+        return 1;
+    }
+    if (!has_format && !fractal::ImageWriter::formatFromPath(output, format)) {
+        std::cerr << "unknown image format for " << output << "; use --format" << std::endl;
+        return 1;
+    }
+    job.viewport.scale = span / job.viewport.width;
+
+    fractal::FractalEngine engine;
+    fractal::RenderScheduler scheduler(threads);
+    fractal::BandRenderer renderer(scheduler);
+    auto start = std::chrono::steady_clock::now();
+    renderer.setProgressCallback([&](int rows, int height) {
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start)
+                             .count();
+        std::cerr << "\r" << rows << " / " << height << " rows, " << seconds << " s"
+                  << std::flush;
+    });
+
+    if (!from_field.empty()) {
+        fractal::FieldReader field;
+        if (!field.open(from_field)) {
+            std::cerr << "cannot read field " << from_field << std::endl;
+            return 1;
+        }
+        fractal::RenderParams params = field.metadata().params;
+        params.palette_id = has_palette ? job.params.palette_id : params.palette_id;
+        params.color_speed = has_color_speed ? job.params.color_speed : params.color_speed;
+        params.color_offset = has_color_offset ? job.params.color_offset : params.color_offset;
+        if (!renderer.recolor(field, params, job.band_rows, format, output)) {
+            std::cerr << "\n" << renderer.error() << std::endl;
+            return 1;
+        }
+        std::cerr << "\nwrote " << output << " (" << field.width() << "x" << field.height()
+                  << " recolored, " << fractal::ImageWriter::formatName(format) << ", "
+                  << scheduler.threadCount() << " threads)" << std::endl;
+        return 0;
+    }
+
+    renderer.setFieldOutput(field_path, field_step);
+    if (!renderer.render(engine, job, format, output, resume)) {
+        std::cerr << "\n" << renderer.error() << std::endl;
+        return 1;
+    }
+    if (renderer.resumedRows()) {
+        std::cerr << "\nresumed after row " << renderer.resumedRows();
+    }
+    std::cerr << "\nwrote " << output << " (" << job.viewport.width << "x"
+              << job.viewport.height << ", " << fractal::ImageWriter::formatName(format) << ", "
+              << scheduler.threadCount() << " threads)" << std::endl;
+    return 0;
+}
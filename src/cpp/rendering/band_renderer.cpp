@@ -0,0 +1,231 @@
+#include "band_renderer.h"
+#include "tile_manager.h"
+#include "../io/progress_file.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <thread>
+
+namespace fractal {
+
+namespace {
+
+const char* const kProgressMagic = "fractal-band-progress 1";
+
+} // namespace
+
+std::string BandJob::signature() const {
+    std::ostringstream out;
+    out.precision(17);
+    out << "view " << viewport.center_x << " " << viewport.center_y << " " << viewport.scale
+        << " " << viewport.width << " " << viewport.height
+        << " type " << type << " " << julia_c_real << " " << julia_c_imag;
+    writeParamsSignature(out, params);
+    out << " bands " << band_rows << " " << tile_size;
+    return out.str();
+}
+
+BandRenderer::BandRenderer(RenderScheduler& scheduler)
+    : scheduler_(scheduler), resumed_rows_(0), field_step_(0.0) {
+}
+
+bool BandRenderer::render(const FractalEngine& engine, const BandJob& job,
+                          ImageWriter::Format format, const std::string& path, bool resume) {
+    error_.clear();
+    resumed_rows_ = 0;
+    const Viewport& viewport = job.viewport;
+    int band_rows = std::max(1, job.band_rows);
+
+    std::unique_ptr<ImageWriter> image = ImageWriter::create(format);
+    if (!image) {
+        return fail(std::string("this build cannot write ") + ImageWriter::formatName(format));
+    }
+
+    std::string format_signature = std::string(ImageWriter::formatName(format)) + " " +
+                                   job.signature();
+    std::unique_ptr<FieldWriter> field;
+    FieldMetadata metadata;
+    if (!field_path_.empty()) {
+        // Checkpoints must fall on rows of chunks for the field to resume
+        field.reset(new FieldWriter(field_step_));
+        int chunk = field->chunkSize();
+        band_rows = (band_rows + chunk - 1) / chunk * chunk;
+        std::ostringstream out;
+        out.precision(17);
+        out << " field " << field_step_ << " " << chunk;
+        format_signature += out.str();
+        metadata.viewport = viewport;
+        metadata.params = job.params;
+        metadata.type = job.type;
+        metadata.julia_c_real = job.julia_c_real;
+        metadata.julia_c_imag = job.julia_c_imag;
+    }
+
+    ImageCheckpoint checkpoint, field_checkpoint;
+    bool resuming = resume && loadProgress(path, format_signature, checkpoint,
+                                           field ? &field_checkpoint : nullptr) &&
+                    (!field || field_checkpoint.rows == checkpoint.rows);
+    if (!image->open(path, viewport.width, viewport.height, resuming ? &checkpoint : nullptr)) {
+        return fail("cannot " + std::string(resuming ? "resume " : "create ") + path);
+    }
+    if (field && !field->open(field_path_, metadata, resuming ? &field_checkpoint : nullptr)) {
+        return fail("cannot " + std::string(resuming ? "resume " : "create ") + field_path_);
+    }
+    auto save = [&]() {
+        ImageCheckpoint field_done = field ? field->checkpoint() : ImageCheckpoint();
+        return saveProgress(path, format_signature, image->checkpoint(),
+                            field ? &field_done : nullptr);
+    };
+    if (resuming) {
+        resumed_rows_ = checkpoint.rows;
+    } else if (!save()) {
+        return fail("cannot write " + progressPath(path));
+    }
+
+    // Band k + 1 renders into one buffer while band k is written from the
+    // other; a band's progress is saved once its write has finished
+    std::vector<uint8_t> buffers[2];
+    IterationField fields[2];
+    int current = 0;
+    std::thread writer;
+    bool written = true;
+    auto finishWrite = [&]() {
+        if (!writer.joinable()) {
+            return true;
+        }
+        writer.join();
+        if (!written) {
+            return fail("cannot write " + path);
+        }
+        if (!save()) {
+            return fail("cannot write " + progressPath(path));
+        }
+        if (progress_) {
+            progress_(image->checkpoint().rows, viewport.height);
+        }
+        return true;
+    };
+
+    for (int y = image->checkpoint().rows; y < viewport.height; y += band_rows) {
+        int rows = std::min(band_rows, viewport.height - y);
+        std::vector<Tile> tiles = TileManager::generateTiles(viewport.width, rows,
+                                                             job.tile_size);
+        for (Tile& tile : tiles) {
+            tile.y += y;
+        }
+        scheduler_.renderBand(engine, tiles, viewport, job.params, job.type, job.julia_c_real,
+                              job.julia_c_imag, y, rows, buffers[current],
+                              field ? &fields[current] : nullptr);
+
+        if (!finishWrite()) {
+            return false;
+        }
+        const uint8_t* band = buffers[current].data();
+        const IterationField* band_field = field ? &fields[current] : nullptr;
+        writer = std::thread([&image, &field, &written, band, band_field, rows]() {
+            written = image->writeRows(band, rows) &&
+                      (!band_field || field->writeRows(*band_field));
+        });
+        current ^= 1;
+    }
+    if (!finishWrite()) {
+        return false;
+    }
+
+    if (!image->finish()) {
+        return fail("cannot finish " + path);
+    }
+    if (field && !field->finish()) {
+        return fail("cannot finish " + field_path_);
+    }
+    std::remove(progressPath(path).c_str());
+    return true;
+}
+
+bool BandRenderer::recolor(FieldReader& field, const RenderParams& params, int band_rows,
+                           ImageWriter::Format format, const std::string& path) {
+    error_.clear();
+    resumed_rows_ = 0;
+    std::unique_ptr<ImageWriter> image = ImageWriter::create(format);
+    if (!image) {
+        return fail(std::string("this build cannot write ") + ImageWriter::formatName(format));
+    }
+    int width = field.width();
+    int height = field.height();
+    if (!image->open(path, width, height)) {
+        return fail("cannot create " + path);
+    }
+
+    // Tiles follow the field's chunks, so each is decoded by one thread
+    band_rows = std::max(1, band_rows);
+    std::vector<uint8_t> band;
+    std::atomic<bool> decoded(true);
+    for (int y = 0; y < height; y += band_rows) {
+        int rows = std::min(band_rows, height - y);
+        band.resize(static_cast<size_t>(width) * rows * 4);
+        std::vector<Tile> tiles = TileManager::generateTiles(width, rows, field.chunkSize());
+        for (Tile& tile : tiles) {
+            tile.y += y;
+        }
+        scheduler_.runTasks(tiles, [&](const Tile& tile) {
+            thread_local IterationField region;
+            if (!field.readRegion(tile.x, tile.y, tile.width, tile.height, region)) {
+                decoded = false;
+                return;
+            }
+            FractalEngine::recolorTile(region, tile.x, tile.y, tile.width, tile.height, params,
+                                       &band[(static_cast<size_t>(tile.y - y) * width +
+                                              tile.x) * 4],
+                                       width * 4);
+        });
+        if (!decoded) {
+            return fail("corrupt field data in rows " + std::to_string(y) + " to " +
+                        std::to_string(y + rows));
+        }
+        if (!image->writeRows(band.data(), rows)) {
+            return fail("cannot write " + path);
+        }
+        if (progress_) {
+            progress_(y + rows, height);
+        }
+    }
+    if (!image->finish()) {
+        return fail("cannot finish " + path);
+    }
+    return true;
+}
+
+bool BandRenderer::loadProgress(const std::string& path, const std::string& signature,
+                                ImageCheckpoint& checkpoint,
+                                ImageCheckpoint* field_checkpoint) const {
+    std::ifstream file;
+    if (!readProgress(progressPath(path), kProgressMagic, signature, file)) {
+        return false;
+    }
+    file >> checkpoint.rows >> checkpoint.file_size >> checkpoint.checksum;
+    if (field_checkpoint) {
+        file >> field_checkpoint->rows >> field_checkpoint->file_size;
+    }
+    return static_cast<bool>(file);
+}
+
+bool BandRenderer::saveProgress(const std::string& path, const std::string& signature,
+                                const ImageCheckpoint& checkpoint,
+                                const ImageCheckpoint* field_checkpoint) const {
+    return writeProgress(progressPath(path), kProgressMagic, signature, [&](std::ostream& file) {
+        file << checkpoint.rows << " " << checkpoint.file_size << " " << checkpoint.checksum
+             << "\n";
+        if (field_checkpoint) {
+            file << field_checkpoint->rows << " " << field_checkpoint->file_size << "\n";
+        }
+    });
+}
+
+bool BandRenderer::fail(const std::string& message) {
+    error_ = message;
+    return false;
+}
+
+} // namespace fractal
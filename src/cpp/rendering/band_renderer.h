@@ -0,0 +1,97 @@
+#ifndef BAND_RENDERER_H
+#define BAND_RENDERER_H
+
+#include "../core/fractal_engine.h"
+#include "../io/field_file.h"
+#include "../io/image_writer.h"
+#include "render_scheduler.h"
+#include <functional>
+#include <string>
+
+namespace fractal {
+
+// What to render: the whole image's viewport and parameters, and how it is
+// cut up. Bands are full-width runs of band_rows rows, split into tiles of
+// tile_size for the scheduler.
+struct BandJob {
+    Viewport viewport;
+    RenderParams params;
+    FractalType type;
+    double julia_c_real;
+    double julia_c_imag;
+    int band_rows;
+    int tile_size;
+
+    BandJob() : type(MANDELBROT), julia_c_real(0.0), julia_c_imag(0.0), band_rows(256),
+                tile_size(64) {}
+
+    // Every setting that affects the output, as one line of text
+    std::string signature() const;
+};
+
+// Renders images far larger than memory (print-size, 32k x 32k and up) by
+// rendering one band at a time across the scheduler's threads and streaming
+// it to an ImageWriter while the next band renders: two band buffers are
+// the only per-image memory. After each band is on disk, a progress file
+// next to the output (path + ".progress") records the writer's checkpoint,
+// so an interrupted run resumes from the last completed band. The progress
+// file is removed once the image is finished.
+//
+// The iteration field can be saved alongside (a FieldWriter fed from the
+// same bands), and an image recolored from a saved field band by band
+// without iterating again.
+class BandRenderer {
+public:
+    explicit BandRenderer(RenderScheduler& scheduler);
+
+    // Called after each band is written with the rows done so far
+    void setProgressCallback(std::function<void(int rows, int height)> callback) {
+        progress_ = std::move(callback);
+    }
+
+    // Render job into path. With resume and a progress file for the same
+    // job, rendering continues after its last band; otherwise it starts
+    // over. Returns false (see error()) on I/O failure or a format this
+    // build cannot write.
+    bool render(const FractalEngine& engine, const BandJob& job, ImageWriter::Format format,
+                const std::string& path, bool resume);
+
+    // Also write the field of later renders to field_path (empty for none),
+    // quantized to step (0 for lossless). Bands are rounded up to whole
+    // rows of field chunks.
+    void setFieldOutput(const std::string& field_path, double step) {
+        field_path_ = field_path;
+        field_step_ = step;
+    }
+
+    // Color field with params into path, band_rows rows at a time
+    bool recolor(FieldReader& field, const RenderParams& params, int band_rows,
+                 ImageWriter::Format format, const std::string& path);
+
+    const std::string& error() const { return error_; }
+
+    // Rows found complete in the progress file by the last render()
+    int resumedRows() const { return resumed_rows_; }
+
+    static std::string progressPath(const std::string& path) { return path + ".progress"; }
+
+private:
+    // field_checkpoint is read and written only when a field is saved
+    bool loadProgress(const std::string& path, const std::string& signature,
+                      ImageCheckpoint& checkpoint, ImageCheckpoint* field_checkpoint) const;
+    bool saveProgress(const std::string& path, const std::string& signature,
+                      const ImageCheckpoint& checkpoint,
+                      const ImageCheckpoint* field_checkpoint) const;
+    bool fail(const std::string& message);
+
+    RenderScheduler& scheduler_;
+    std::function<void(int, int)> progress_;
+    std::string error_;
+    int resumed_rows_;
+    std::string field_path_;
+    double field_step_;
+};
+
+} // namespace fractal
+
+#endif // BAND_RENDERER_H
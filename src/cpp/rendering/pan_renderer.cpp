@@ -0,0 +1,113 @@
+#include "pan_renderer.h"
+#include "viewport.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+namespace fractal {
+
+namespace {
+
+// Move the contents of a row-major plane by (dx, dy) pixels in place.
+// Pixels shifted in from outside are left as they were.
+void shiftPlane(uint8_t* data, int width, int height, size_t pixel_bytes, int dx, int dy) {
+    size_t row_bytes = static_cast<size_t>(width) * pixel_bytes;
+    size_t copy_bytes = static_cast<size_t>(width - std::abs(dx)) * pixel_bytes;
+    size_t to_offset = static_cast<size_t>(std::max(dx, 0)) * pixel_bytes;
+    size_t from_offset = static_cast<size_t>(std::max(-dx, 0)) * pixel_bytes;
+
+    // Walk rows against the direction of travel so no source row is
+    // overwritten before it has been copied
+    if (dy > 0) {
+        for (int y = height - 1; y >= dy; y--) {
+            std::memmove(data + y * row_bytes + to_offset,
+                         data + (y - dy) * row_bytes + from_offset, copy_bytes);
+        }
+    } else {
+        for (int y = 0; y < height + dy; y++) {
+            std::memmove(data + y * row_bytes + to_offset,
+                         data + (y - dy) * row_bytes + from_offset, copy_bytes);
+        }
+    }
+}
+
+} // namespace
+
+PanRenderer::PanRenderer()
+    : type_(MANDELBROT), julia_c_real_(0.0), julia_c_imag_(0.0), has_frame_(false) {
+}
+
+void PanRenderer::render(const FractalEngine& engine, const Viewport& viewport,
+                         const RenderParams& params, FractalType type,
+                         double julia_c_real, double julia_c_imag) {
+    viewport_ = viewport;
+    params_ = params;
+    type_ = type;
+    julia_c_real_ = julia_c_real;
+    julia_c_imag_ = julia_c_imag;
+
+    pixels_.resize(static_cast<size_t>(viewport.width) * viewport.height * 4);  // RGBA
+    field_.reset(0, 0, viewport.width, viewport.height);
+    renderRect(engine, Tile(0, 0, viewport.width, viewport.height));
+    has_frame_ = true;
+}
+
+std::vector<Tile> PanRenderer::pan(const FractalEngine& engine, int dx, int dy) {
+    if (!has_frame_) {
+        return {};
+    }
+
+    viewport_ = ViewportManager::pan(viewport_, dx, dy);
+
+    std::vector<Tile> rects = exposedRects(viewport_.width, viewport_.height, dx, dy);
+    bool full_frame = rects.size() == 1 && rects[0].width == viewport_.width &&
+                      rects[0].height == viewport_.height;
+    if (!full_frame) {
+        // New pixel (x, y) is old pixel (x - dx, y - dy)
+        shiftPlane(pixels_.data(), viewport_.width, viewport_.height, 4, dx, dy);
+        shiftPlane(reinterpret_cast<uint8_t*>(field_.smooth_values.data()),
+                   viewport_.width, viewport_.height, sizeof(float), dx, dy);
+        shiftPlane(field_.inside_set.data(), viewport_.width, viewport_.height,
+                   sizeof(uint8_t), dx, dy);
+    }
+
+    for (const Tile& rect : rects) {
+        renderRect(engine, rect);
+    }
+    return rects;
+}
+
+std::vector<Tile> PanRenderer::exposedRects(int width, int height, int dx, int dy) {
+    std::vector<Tile> rects;
+    if (std::abs(dx) >= width || std::abs(dy) >= height) {
+        rects.emplace_back(0, 0, width, height);
+        return rects;
+    }
+
+    // Full-height strip for the horizontal shift
+    if (dx > 0) {
+        rects.emplace_back(0, 0, dx, height);
+    } else if (dx < 0) {
+        rects.emplace_back(width + dx, 0, -dx, height);
+    }
+
+    // Full-width strip for the vertical shift, minus the columns above
+    int x0 = std::max(dx, 0);
+    int x1 = width + std::min(dx, 0);
+    if (dy > 0) {
+        rects.emplace_back(x0, 0, x1 - x0, dy);
+    } else if (dy < 0) {
+        rects.emplace_back(x0, height + dy, x1 - x0, -dy);
+    }
+
+    return rects;
+}
+
+void PanRenderer::renderRect(const FractalEngine& engine, const Tile& rect) {
+    int row_stride = viewport_.width * 4;
+    uint8_t* origin = pixels_.data() + static_cast<size_t>(rect.y) * row_stride + rect.x * 4;
+    engine.renderTile(rect.x, rect.y, rect.width, rect.height, viewport_, params_, type_,
+                      julia_c_real_, julia_c_imag_, origin, row_stride, &field_);
+}
+
+} // namespace fractal
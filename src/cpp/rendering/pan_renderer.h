@@ -0,0 +1,54 @@
+#ifndef PAN_RENDERER_H
+#define PAN_RENDERER_H
+
+#include "../core/fractal_engine.h"
+#include "tile_manager.h"
+#include <cstdint>
+#include <vector>
+
+namespace fractal {
+
+// Keeps the last frame's pixels and iteration data so that a whole-pixel pan
+// only renders the strips it exposes. The retained buffers are shifted by
+// the pan delta; a 20 pixel drag on a 1920x1080 frame recomputes ~2% of it.
+class PanRenderer {
+public:
+    PanRenderer();
+
+    // Render the full view and retain it
+    void render(const FractalEngine& engine, const Viewport& viewport,
+                const RenderParams& params, FractalType type,
+                double julia_c_real, double julia_c_imag);
+
+    // Move the view as ViewportManager::pan(viewport(), dx, dy) does, shift
+    // the retained frame and render the exposed region. Returns the
+    // rectangles that were rendered (the whole frame when nothing could be
+    // reused, nothing before the first render()).
+    std::vector<Tile> pan(const FractalEngine& engine, int dx, int dy);
+
+    // Region of a width x height frame exposed by a (dx, dy) pan: up to two
+    // non-overlapping rectangles forming an L
+    static std::vector<Tile> exposedRects(int width, int height, int dx, int dy);
+
+    bool hasFrame() const { return has_frame_; }
+    const Viewport& viewport() const { return viewport_; }
+    const std::vector<uint8_t>& pixels() const { return pixels_; }  // RGBA
+    const IterationField& field() const { return field_; }
+
+private:
+    void renderRect(const FractalEngine& engine, const Tile& rect);
+
+    Viewport viewport_;
+    RenderParams params_;
+    FractalType type_;
+    double julia_c_real_;
+    double julia_c_imag_;
+    bool has_frame_;
+
+    std::vector<uint8_t> pixels_;
+    IterationField field_;
+};
+
+} // namespace fractal
+
+#endif // PAN_RENDERER_H
@@ -0,0 +1,45 @@
+#include "pixel_buffer_pool.h"
+
+namespace fractal {
+
+uint8_t* PixelBufferPool::acquire(size_t size) {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    // Smallest free buffer that fits
+    Entry* best = nullptr;
+    for (Entry& entry : entries_) {
+        if (!entry.leased && entry.size >= size && (!best || entry.size < best->size)) {
+            best = &entry;
+        }
+    }
+
+    if (!best) {
+        entries_.push_back({std::unique_ptr<uint8_t[]>(new uint8_t[size]), size, false});
+        best = &entries_.back();
+    }
+
+    best->leased = true;
+    return best->data.get();
+}
+
+void PixelBufferPool::release(uint8_t* buffer) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (Entry& entry : entries_) {
+        if (entry.data.get() == buffer) {
+            entry.leased = false;
+            return;
+        }
+    }
+}
+
+size_t PixelBufferPool::capacity(const uint8_t* buffer) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const Entry& entry : entries_) {
+        if (entry.data.get() == buffer) {
+            return entry.size;
+        }
+    }
+    return 0;
+}
+
+} // namespace fractal
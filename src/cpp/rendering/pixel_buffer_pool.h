@@ -0,0 +1,46 @@
+#ifndef PIXEL_BUFFER_POOL_H
+#define PIXEL_BUFFER_POOL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace fractal {
+
+// Pool of long-lived pixel buffers. Callers lease a buffer, render into it as
+// many times as they like and hand it back; released buffers are reused for
+// later leases of the same or smaller size, so steady-state tile rendering
+// allocates nothing. In the wasm build the buffers live in the module heap
+// and JS reads them through a view, without copying.
+class PixelBufferPool {
+public:
+    PixelBufferPool() = default;
+
+    PixelBufferPool(const PixelBufferPool&) = delete;
+    PixelBufferPool& operator=(const PixelBufferPool&) = delete;
+
+    // Lease a buffer of at least `size` bytes. Valid until released.
+    uint8_t* acquire(size_t size);
+
+    // Return a leased buffer to the pool. Unknown pointers are ignored.
+    void release(uint8_t* buffer);
+
+    // Size in bytes of a leased buffer, or 0 if it is not from this pool
+    size_t capacity(const uint8_t* buffer) const;
+
+private:
+    struct Entry {
+        std::unique_ptr<uint8_t[]> data;
+        size_t size;
+        bool leased;
+    };
+
+    mutable std::mutex mutex_;
+    std::vector<Entry> entries_;
+};
+
+} // namespace fractal
+
+#endif // PIXEL_BUFFER_POOL_H
@@ -1,5 +1,8 @@
 #include "progressive_renderer.h"
+#include "../core/trace_recorder.h"
 #include <algorithm>
+#include <cmath>
+#include <vector>
 
 namespace fractal {
 
@@ -10,28 +13,118 @@ ProgressiveRenderParams ProgressiveRenderer::getPassParams(RenderPass pass,
 
     switch (pass) {
         case PASS_PREVIEW:
-            params.resolution_scale = 0.25;
+            params.sample_step = 8;
             params.max_iterations = std::max(100, base_max_iterations / 10);
             break;
         case PASS_LOW:
-            params.resolution_scale = 0.5;
+            params.sample_step = 4;
             params.max_iterations = std::max(200, base_max_iterations / 5);
             break;
         case PASS_MEDIUM:
-            params.resolution_scale = 0.75;
+            params.sample_step = 2;
             params.max_iterations = std::max(500, base_max_iterations / 2);
             break;
         case PASS_HIGH:
-            params.resolution_scale = 1.0;
+            params.sample_step = 1;
             params.max_iterations = base_max_iterations;
             break;
     }
 
+    // Later passes never lower the limit, so earlier samples only continue
+    params.max_iterations = std::min(params.max_iterations, base_max_iterations);
+    params.resolution_scale = 1.0 / params.sample_step;
+    params.previous_sample_step = pass == PASS_PREVIEW ? 0 : params.sample_step * 2;
+
     return params;
 }
 
-int ProgressiveRenderer::getAdaptiveIterations(RenderPass pass, int base_max_iterations) {
-    return getPassParams(pass, base_max_iterations).max_iterations;
+IterationEstimate ProgressiveRenderer::estimateIterations(const FractalEngine& engine, int x,
+                                                         int y, int w, int h,
+                                                         const Viewport& viewport,
+                                                         FractalType type, double julia_c_real,
+                                                         double julia_c_imag,
+                                                         const AutoIterationParams& params) {
+    TraceSpan span("estimateIterations", "frame", x, y, w, h);
+    IterationEstimate estimate;
+    int step = std::max(1, params.sample_step);
+    int ceiling = std::max(params.min_iterations, params.max_iterations);
+
+    // Plain escape counts; the field keeps orbits so each doubling of the
+    // limit only continues the undecided samples
+    RenderParams render;
+    render.max_iterations = params.min_iterations;
+    render.smooth_coloring = false;
+    render.periodicity_check = true;
+
+    IterationField field;
+    field.keep_orbits = true;
+    field.reset(x, y, w, h);
+    engine.renderTileProgressive(x, y, w, h, viewport, render, type, julia_c_real,
+                                 julia_c_imag, step, 0, field, nullptr, 0);
+
+    int x_first = (x + step - 1) / step * step;
+    int y_first = (y + step - 1) / step * step;
+    std::vector<int> escapes;
+    while (true) {
+        escapes.clear();
+        estimate.interior = 0;
+        estimate.unresolved = 0;
+        for (int sy = y_first; sy < y + h; sy += step) {
+            for (int sx = x_first; sx < x + w; sx += step) {
+                size_t index = field.indexOf(sx, sy);
+                if (!field.inside_set[index]) {
+                    escapes.push_back(static_cast<int>(field.smooth_values[index]));
+                } else if (std::isnan(field.orbit_real[index])) {
+                    estimate.interior++;
+                } else {
+                    estimate.unresolved++;
+                }
+            }
+        }
+
+        int open = static_cast<int>(escapes.size()) + estimate.unresolved;
+        if (render.max_iterations >= ceiling ||
+            estimate.unresolved <= (1.0 - params.target_resolved) * open) {
+            break;
+        }
+        render.max_iterations = std::min(ceiling, render.max_iterations * 2);
+        engine.continueTile(x, y, w, h, viewport, render, type, julia_c_real, julia_c_imag,
+                            field, nullptr, 0);
+    }
+
+    std::sort(escapes.begin(), escapes.end());
+    estimate.probe_iterations = render.max_iterations;
+    estimate.escaped = static_cast<int>(escapes.size());
+    estimate.samples = estimate.escaped + estimate.interior + estimate.unresolved;
+
+    auto percentile = [&](double fraction) {
+        if (escapes.empty()) {
+            return 0;
+        }
+        size_t rank = static_cast<size_t>(std::ceil(fraction * escapes.size()));
+        return escapes[std::min(escapes.size(), std::max<size_t>(rank, 1)) - 1];
+    };
+    estimate.median_escape = percentile(0.5);
+    estimate.p90_escape = percentile(0.9);
+    estimate.p99_escape = percentile(0.99);
+
+    // Smallest limit reaching the target, counting undecided samples as
+    // escaping beyond the probe. A sample escaping at iteration n needs a
+    // limit above n.
+    int open = estimate.escaped + estimate.unresolved;
+    size_t needed = static_cast<size_t>(std::ceil(params.target_resolved * open));
+    int chosen = estimate.probe_iterations;
+    if (needed == 0) {
+        chosen = params.min_iterations;
+    } else if (needed <= escapes.size()) {
+        chosen = escapes[needed - 1] + 1;
+    }
+    estimate.max_iterations = std::min(ceiling, std::max(params.min_iterations, chosen));
+
+    size_t resolved = std::lower_bound(escapes.begin(), escapes.end(),
+                                       estimate.max_iterations) - escapes.begin();
+    estimate.resolved_fraction = open > 0 ? static_cast<double>(resolved) / open : 1.0;
+    return estimate;
 }
 
 } // namespace fractal
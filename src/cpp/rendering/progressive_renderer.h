@@ -5,19 +5,58 @@
 
 namespace fractal {
 
+// Each pass samples every sample_step-th pixel of the frame in both
+// directions, so its grid contains all earlier ones and a pass only
+// computes the samples that are new (FractalEngine::renderTileProgressive).
+// All four passes together compute each pixel once.
 enum RenderPass {
-    PASS_PREVIEW = 0,  // 25% resolution
-    PASS_LOW = 1,      // 50% resolution
-    PASS_MEDIUM = 2,   // 75% resolution
-    PASS_HIGH = 3      // 100% resolution
+    PASS_PREVIEW = 0,  // 1/8 resolution
+    PASS_LOW = 1,      // 1/4 resolution
+    PASS_MEDIUM = 2,   // 1/2 resolution
+    PASS_HIGH = 3      // Full resolution
 };
 
 struct ProgressiveRenderParams {
     RenderPass pass;
     double resolution_scale;
+    int sample_step;           // 1 / resolution_scale
+    int previous_sample_step;  // Grid already computed, 0 for the first pass
     int max_iterations;
 
-    ProgressiveRenderParams() : pass(PASS_HIGH), resolution_scale(1.0), max_iterations(1000) {}
+    ProgressiveRenderParams() : pass(PASS_HIGH), resolution_scale(1.0), sample_step(1),
+                                previous_sample_step(2), max_iterations(1000) {}
+};
+
+// Automatic iteration limit: a preview grid is iterated with a doubling
+// limit until few enough samples are still undecided, then the limit is set
+// where target_resolved of the samples that are not proven interior escape.
+// Interior samples (cardioid, bulb, periodic orbit) never raise the limit.
+struct AutoIterationParams {
+    double target_resolved;  // Fraction of non-interior samples that must escape
+    int min_iterations;
+    int max_iterations;      // Ceiling for the probe and the result
+    int sample_step;         // Preview grid spacing in pixels
+
+    AutoIterationParams() : target_resolved(0.995), min_iterations(100),
+                            max_iterations(100000), sample_step(8) {}
+};
+
+// Escape statistics of the preview grid and the limit chosen from them
+struct IterationEstimate {
+    int max_iterations;        // Chosen limit
+    int probe_iterations;      // Limit the preview grid reached
+    int samples;
+    int escaped;               // Escaped within probe_iterations
+    int interior;              // Proven inside the set
+    int unresolved;            // Neither, at probe_iterations
+    int median_escape;         // Escape count percentiles of escaped samples
+    int p90_escape;
+    int p99_escape;
+    double resolved_fraction;  // Non-interior samples escaping within max_iterations
+
+    IterationEstimate() : max_iterations(0), probe_iterations(0), samples(0), escaped(0),
+                          interior(0), unresolved(0), median_escape(0), p90_escape(0),
+                          p99_escape(0), resolved_fraction(1.0) {}
 };
 
 class ProgressiveRenderer {
@@ -25,8 +64,15 @@ public:
     // Get parameters for a given render pass
     static ProgressiveRenderParams getPassParams(RenderPass pass, int base_max_iterations);
 
-    // Get adaptive iteration count for a pass
-    static int getAdaptiveIterations(RenderPass pass, int base_max_iterations);
+    // Estimate the limit for the frame rectangle (x, y, w, h) of viewport;
+    // the whole view or a single tile. Sample positions are aligned to the
+    // frame, so per-tile estimates sample the same points as the view.
+    static IterationEstimate estimateIterations(const FractalEngine& engine, int x, int y,
+                                                int w, int h, const Viewport& viewport,
+                                                FractalType type, double julia_c_real,
+                                                double julia_c_imag,
+                                                const AutoIterationParams& params =
+                                                    AutoIterationParams());
 };
 
 } // namespace fractal
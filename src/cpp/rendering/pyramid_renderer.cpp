@@ -0,0 +1,292 @@
+#include "pyramid_renderer.h"
+#include "../core/trace_recorder.h"
+#include "../io/progress_file.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+namespace fractal {
+
+namespace {
+
+const char* const kProgressMagic = "fractal-pyramid-progress 1";
+
+// Levels below each subtree root; a subtree is 4^kSubtreeLevels deepest
+// tiles plus their ancestors up to the root
+const int kSubtreeLevels = 3;
+const int kMaxLevels = 24;
+
+// Tile of a level from its index in Z order: x takes the even bits
+void fromZOrder(uint64_t index, int& x, int& y) {
+    x = 0;
+    y = 0;
+    for (int bit = 0; bit < 32; bit++) {
+        x |= static_cast<int>((index >> (2 * bit)) & 1) << bit;
+        y |= static_cast<int>((index >> (2 * bit + 1)) & 1) << bit;
+    }
+}
+
+// Box-filter a size x size RGBA tile to half size into out, whose rows are
+// out_stride bytes apart
+void downsample(const uint8_t* tile, int size, uint8_t* out, int out_stride) {
+    int half = size / 2;
+    size_t stride = static_cast<size_t>(size) * 4;
+    for (int y = 0; y < half; y++) {
+        const uint8_t* top = tile + 2 * y * stride;
+        const uint8_t* bottom = top + stride;
+        uint8_t* row = out + static_cast<size_t>(y) * out_stride;
+        for (int i = 0; i < half * 4; i++) {
+            int column = (i / 4) * 8 + i % 4;
+            row[i] = static_cast<uint8_t>((top[column] + top[column + 4] + bottom[column] +
+                                           bottom[column + 4] + 2) >> 2);
+        }
+    }
+}
+
+} // namespace
+
+Viewport PyramidJob::tileViewport(int level, int x, int y) const {
+    double tile_span = std::ldexp(span, -level);
+    return Viewport(center_real - span / 2.0 + (x + 0.5) * tile_span,
+                    center_imag - span / 2.0 + (y + 0.5) * tile_span, tile_span / tile_size,
+                    tile_size, tile_size);
+}
+
+uint64_t PyramidJob::tileCount() const {
+    return ArchiveTileStore::tileIndex(levels, 0, 0);
+}
+
+std::string PyramidJob::signature() const {
+    std::ostringstream out;
+    out.precision(17);
+    out << "region " << center_real << " " << center_imag << " " << span
+        << " levels " << levels << " " << tile_size
+        << " type " << type << " " << julia_c_real << " " << julia_c_imag;
+    writeParamsSignature(out, params);
+    return out.str();
+}
+
+PyramidRenderer::PyramidRenderer(RenderScheduler& scheduler)
+    : scheduler_(scheduler), resumed_tiles_(0), engine_(nullptr),
+      format_(ImageWriter::FORMAT_PNG), store_(nullptr), task_level_(0), failed_(false) {
+}
+
+bool PyramidRenderer::render(const FractalEngine& engine, const PyramidJob& job,
+                             ImageWriter::Format format, TileStore::Layout layout,
+                             const std::string& path, bool resume) {
+    error_.clear();
+    resumed_tiles_ = 0;
+    int tile_size = job.tile_size;
+    if (job.levels < 1 || job.levels > kMaxLevels || tile_size < 2 || tile_size > 4096 ||
+        (tile_size & (tile_size - 1))) {
+        return fail("a pyramid needs 1 to " + std::to_string(kMaxLevels) +
+                    " levels and a power-of-two tile size up to 4096");
+    }
+    if (!ImageWriter::create(format)) {
+        return fail(std::string("this build cannot write ") + ImageWriter::formatName(format));
+    }
+    std::unique_ptr<TileStore> store = TileStore::create(layout);
+
+    engine_ = &engine;
+    job_ = job;
+    format_ = format;
+    store_ = store.get();
+    failed_ = false;
+
+    // Subtrees kSubtreeLevels deep, unless that leaves too few to keep
+    // every thread busy
+    int deepest = job.levels - 1;
+    int spread = 0;
+    while ((uint64_t(1) << (2 * spread)) < 4u * static_cast<uint64_t>(scheduler_.threadCount())) {
+        spread++;
+    }
+    task_level_ = std::min(deepest, std::max(deepest - kSubtreeLevels, spread));
+    uint64_t tasks = uint64_t(1) << (2 * task_level_);
+    size_t tile_bytes = static_cast<size_t>(tile_size) * tile_size * 4;
+
+    std::string signature = std::string(TileStore::layoutName(layout)) + " " +
+                            ImageWriter::formatName(format) + " " + job.signature();
+    uint64_t next_task = 0, checkpoint = 0;
+    pending_.assign(task_level_, std::vector<uint8_t>(tile_bytes));
+    bool resuming = resume && loadProgress(path, signature, next_task, checkpoint);
+    if (!store->open(path, tile_size, job.levels, format, resuming ? &checkpoint : nullptr)) {
+        return fail("cannot " + std::string(resuming ? "resume " : "create ") + path);
+    }
+    if (resuming) {
+        resumed_tiles_ = tilesAfter(next_task);
+    } else if (!store->sync(checkpoint) || !saveProgress(path, signature, 0, checkpoint)) {
+        return fail("cannot write " + progressPath(path));
+    }
+
+    // Each batch renders its subtrees in parallel, then merges their roots
+    // in Z order
+    uint64_t batch = 4u * static_cast<uint64_t>(scheduler_.threadCount());
+    std::vector<uint8_t> roots(static_cast<size_t>(std::min(batch, tasks)) * tile_bytes);
+    while (next_task < tasks) {
+        int count = static_cast<int>(std::min(batch, tasks - next_task));
+        std::vector<Tile> slots;
+        for (int i = 0; i < count; i++) {
+            slots.emplace_back(i, 0, 1, 1);
+        }
+        scheduler_.runTasks(slots, [&](const Tile& slot) {
+            int x, y;
+            fromZOrder(next_task + slot.x, x, y);
+            if (!renderSubtree(task_level_, x, y, &roots[slot.x * tile_bytes])) {
+                failed_ = true;
+            }
+        });
+
+        for (int i = 0; i < count && !failed_; i++) {
+            int x, y;
+            fromZOrder(next_task + i, x, y);
+            if (!mergeUp(task_level_, x, y, &roots[i * tile_bytes])) {
+                failed_ = true;
+            }
+        }
+        if (failed_) {
+            return fail("cannot write tiles to " + path);
+        }
+
+        next_task += count;
+        if (!store->sync(checkpoint) || !saveProgress(path, signature, next_task, checkpoint)) {
+            return fail("cannot write " + progressPath(path));
+        }
+        if (progress_) {
+            progress_(tilesAfter(next_task), job.tileCount());
+        }
+    }
+
+    if (!store->finish()) {
+        return fail("cannot finish " + path);
+    }
+    std::remove(progressPath(path).c_str());
+    return true;
+}
+
+bool PyramidRenderer::renderSubtree(int level, int x, int y, uint8_t* pixels) {
+    if (failed_) {
+        return false;
+    }
+    int tile_size = job_.tile_size;
+    if (level == job_.levels - 1) {
+        engine_->renderTile(0, 0, tile_size, tile_size, job_.tileViewport(level, x, y),
+                            job_.params, job_.type, job_.julia_c_real, job_.julia_c_imag,
+                            pixels, tile_size * 4);
+        return writeTile(level, x, y, pixels, tile_size);
+    }
+
+    std::vector<uint8_t> child(static_cast<size_t>(tile_size) * tile_size * 4);
+    int half = tile_size / 2;
+    for (int quadrant = 0; quadrant < 4; quadrant++) {
+        int child_x = quadrant & 1;
+        int child_y = quadrant >> 1;
+        if (!renderSubtree(level + 1, 2 * x + child_x, 2 * y + child_y, child.data())) {
+            return false;
+        }
+        downsample(child.data(), tile_size,
+                   pixels + (static_cast<size_t>(child_y * half) * tile_size + child_x * half) * 4,
+                   tile_size * 4);
+    }
+    return writeTile(level, x, y, pixels, tile_size);
+}
+
+bool PyramidRenderer::mergeUp(int level, int x, int y, const uint8_t* pixels) {
+    int tile_size = job_.tile_size;
+    int half = tile_size / 2;
+    while (level > 0) {
+        int child_x = x & 1;
+        int child_y = y & 1;
+        level--;
+        x >>= 1;
+        y >>= 1;
+        uint8_t* parent = pending_[level].data();
+        downsample(pixels, tile_size,
+                   parent + (static_cast<size_t>(child_y * half) * tile_size + child_x * half) * 4,
+                   tile_size * 4);
+        // The last child in Z order completes its parent
+        if (!child_x || !child_y) {
+            return true;
+        }
+        if (!writeTile(level, x, y, parent, tile_size)) {
+            return false;
+        }
+        pixels = parent;
+    }
+
+    // Level 0 is done; shrink it for layouts that want smaller overviews
+    std::vector<uint8_t> overview(pixels, pixels + static_cast<size_t>(tile_size) * tile_size * 4);
+    int size = tile_size;
+    for (int level = 1; level <= store_->overviewLevels() && size > 1; level++) {
+        std::vector<uint8_t> smaller(static_cast<size_t>(size / 2) * (size / 2) * 4);
+        downsample(overview.data(), size, smaller.data(), size / 2 * 4);
+        overview.swap(smaller);
+        size /= 2;
+        if (!writeTile(-level, 0, 0, overview.data(), size)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool PyramidRenderer::writeTile(int level, int x, int y, const uint8_t* pixels, int size) {
+    TraceSpan span("writeTile", "io", x, y, size, size);
+    span.setValue("level", level);
+    std::unique_ptr<ImageWriter> writer = ImageWriter::create(format_);
+    thread_local std::vector<uint8_t> bytes;
+    return writer->encode(pixels, size, size, bytes) && store_->writeTile(level, x, y, bytes);
+}
+
+uint64_t PyramidRenderer::tilesAfter(uint64_t tasks) const {
+    int subtree_levels = job_.levels - 1 - task_level_;
+    uint64_t tiles = tasks * ArchiveTileStore::tileIndex(subtree_levels + 1, 0, 0);
+    for (int level = 0; level < task_level_; level++) {
+        tiles += tasks >> (2 * (task_level_ - level));
+    }
+    return tiles;
+}
+
+bool PyramidRenderer::loadProgress(const std::string& path, const std::string& signature,
+                                   uint64_t& next_task, uint64_t& checkpoint) {
+    std::ifstream file;
+    std::string state;
+    if (!readProgress(progressPath(path), kProgressMagic, signature, file) ||
+        !std::getline(file, state)) {
+        return false;
+    }
+    std::istringstream fields(state);
+    size_t levels = 0, tile_bytes = 0;
+    fields >> next_task >> checkpoint >> levels >> tile_bytes;
+    if (!fields || levels != pending_.size() ||
+        (!pending_.empty() && tile_bytes != pending_[0].size())) {
+        return false;
+    }
+    for (std::vector<uint8_t>& tile : pending_) {
+        if (!file.read(reinterpret_cast<char*>(tile.data()),
+                       static_cast<std::streamsize>(tile.size()))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool PyramidRenderer::saveProgress(const std::string& path, const std::string& signature,
+                                   uint64_t next_task, uint64_t checkpoint) const {
+    // The part-built tiles above the subtrees follow the text line
+    return writeProgress(progressPath(path), kProgressMagic, signature, [&](std::ostream& file) {
+        file << next_task << " " << checkpoint << " " << pending_.size() << " "
+             << (pending_.empty() ? 0 : pending_[0].size()) << "\n";
+        for (const std::vector<uint8_t>& tile : pending_) {
+            file.write(reinterpret_cast<const char*>(tile.data()),
+                       static_cast<std::streamsize>(tile.size()));
+        }
+    });
+}
+
+bool PyramidRenderer::fail(const std::string& message) {
+    error_ = message;
+    return false;
+}
+
+} // namespace fractal
@@ -0,0 +1,112 @@
+#ifndef PYRAMID_RENDERER_H
+#define PYRAMID_RENDERER_H
+
+#include "../core/fractal_engine.h"
+#include "../io/image_writer.h"
+#include "../io/tile_store.h"
+#include "render_scheduler.h"
+#include <atomic>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace fractal {
+
+// What to render: a square region of the plane as levels levels of
+// tile_size tiles. Level z is 2^z x 2^z tiles, so the deepest level is
+// tile_size * 2^(levels - 1) pixels across; tile (x, y) has y growing with
+// the imaginary part, as on screen.
+struct PyramidJob {
+    double center_real;
+    double center_imag;
+    double span;    // Width and height of the region
+    int levels;
+    int tile_size;  // A power of two
+    RenderParams params;
+    FractalType type;
+    double julia_c_real;
+    double julia_c_imag;
+
+    PyramidJob() : center_real(-0.5), center_imag(0.0), span(3.2), levels(6), tile_size(256),
+                   type(MANDELBROT), julia_c_real(0.0), julia_c_imag(0.0) {}
+
+    Viewport tileViewport(int level, int x, int y) const;
+
+    // Tiles in every level
+    uint64_t tileCount() const;
+
+    // Every setting that affects the output, as one line of text
+    std::string signature() const;
+};
+
+// Builds a tile pyramid rendering only the deepest level: every coarser
+// tile is the box-filtered 2x downsample of its four children. The work is
+// split into subtrees a few levels deep, each rendered depth-first on one
+// thread so that a parent is built from its children while they are still
+// in cache; the levels above the subtrees are merged on the calling thread
+// as subtrees finish, in Z order, holding one part-built tile per level.
+// Subtrees are run in batches across the scheduler's threads, and after
+// each batch a progress file (path + ".progress") records the next subtree,
+// the part-built tiles and the store's checkpoint, so an interrupted run
+// resumes from the last batch.
+class PyramidRenderer {
+public:
+    explicit PyramidRenderer(RenderScheduler& scheduler);
+
+    // Called after each batch with the tiles written so far
+    void setProgressCallback(std::function<void(uint64_t tiles, uint64_t total)> callback) {
+        progress_ = std::move(callback);
+    }
+
+    // Render job into path in layout. With resume and a progress file for
+    // the same job, rendering continues after its last batch; otherwise it
+    // starts over. Returns false (see error()) on bad jobs, I/O failure or
+    // a format this build cannot write.
+    bool render(const FractalEngine& engine, const PyramidJob& job, ImageWriter::Format format,
+                TileStore::Layout layout, const std::string& path, bool resume);
+
+    const std::string& error() const { return error_; }
+
+    // Tiles found complete in the progress file by the last render()
+    uint64_t resumedTiles() const { return resumed_tiles_; }
+
+    static std::string progressPath(const std::string& path) { return path + ".progress"; }
+
+private:
+    // Render the subtree under tile (level, x, y) into pixels, writing
+    // every tile of it
+    bool renderSubtree(int level, int x, int y, uint8_t* pixels);
+
+    // Add a finished tile to its parent's part-built tile, writing parents
+    // as they complete
+    bool mergeUp(int level, int x, int y, const uint8_t* pixels);
+
+    bool writeTile(int level, int x, int y, const uint8_t* pixels, int size);
+
+    // Tiles written once the first `tasks` subtrees are merged
+    uint64_t tilesAfter(uint64_t tasks) const;
+
+    bool loadProgress(const std::string& path, const std::string& signature,
+                      uint64_t& next_task, uint64_t& checkpoint);
+    bool saveProgress(const std::string& path, const std::string& signature,
+                      uint64_t next_task, uint64_t checkpoint) const;
+    bool fail(const std::string& message);
+
+    RenderScheduler& scheduler_;
+    std::function<void(uint64_t, uint64_t)> progress_;
+    std::string error_;
+    uint64_t resumed_tiles_;
+
+    // State of the current render()
+    const FractalEngine* engine_;
+    PyramidJob job_;
+    ImageWriter::Format format_;
+    TileStore* store_;
+    int task_level_;                            // Level of the subtree roots
+    std::vector<std::vector<uint8_t>> pending_;  // Part-built tile per level above it
+    std::atomic<bool> failed_;
+};
+
+} // namespace fractal
+
+#endif // PYRAMID_RENDERER_H
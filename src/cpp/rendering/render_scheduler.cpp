@@ -0,0 +1,247 @@
+#include "render_scheduler.h"
+#include "../core/trace_recorder.h"
+#include <algorithm>
+#include <string>
+
+namespace fractal {
+
+RenderScheduler::RenderScheduler(int thread_count)
+    : generation_(0), workers_active_(0), stopping_(false), job_() {
+    if (thread_count <= 0) {
+        thread_count = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    for (int i = 0; i < thread_count; i++) {
+        queues_.push_back(std::make_unique<WorkQueue>());
+    }
+    histograms_.resize(thread_count);
+    for (int i = 0; i < thread_count; i++) {
+        threads_.emplace_back(&RenderScheduler::workerLoop, this, i);
+    }
+}
+
+RenderScheduler::~RenderScheduler() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    start_cv_.notify_all();
+    for (auto& thread : threads_) {
+        thread.join();
+    }
+}
+
+void RenderScheduler::renderFrame(const FractalEngine& engine, const std::vector<Tile>& tiles,
+                                  const Viewport& viewport, const RenderParams& params,
+                                  FractalType type, double julia_c_real, double julia_c_imag,
+                                  std::vector<uint8_t>& frame_buffer, IterationField* field) {
+    TraceSpan span("renderFrame", "frame", 0, 0, viewport.width, viewport.height);
+    span.setValue("tiles", static_cast<int64_t>(tiles.size()));
+    frame_buffer.resize(static_cast<size_t>(viewport.width) * viewport.height * 4);
+    if (field) {
+        field->reset(0, 0, viewport.width, viewport.height);
+    }
+
+    job_.kind = JOB_RENDER;
+    job_.engine = &engine;
+    job_.viewport = &viewport;
+    job_.params = &params;
+    job_.type = type;
+    job_.julia_c_real = julia_c_real;
+    job_.julia_c_imag = julia_c_imag;
+    job_.frame = frame_buffer.data();
+    job_.frame_y = 0;
+    job_.field = field;
+    runTiles(tiles);
+}
+
+void RenderScheduler::renderBand(const FractalEngine& engine, const std::vector<Tile>& tiles,
+                                 const Viewport& viewport, const RenderParams& params,
+                                 FractalType type, double julia_c_real, double julia_c_imag,
+                                 int y_start, int rows, std::vector<uint8_t>& band_buffer,
+                                 IterationField* field) {
+    TraceSpan span("renderBand", "frame", 0, y_start, viewport.width, rows);
+    span.setValue("tiles", static_cast<int64_t>(tiles.size()));
+    band_buffer.resize(static_cast<size_t>(viewport.width) * rows * 4);
+    if (field) {
+        field->reset(0, y_start, viewport.width, rows);
+    }
+
+    job_.kind = JOB_RENDER;
+    job_.engine = &engine;
+    job_.viewport = &viewport;
+    job_.params = &params;
+    job_.type = type;
+    job_.julia_c_real = julia_c_real;
+    job_.julia_c_imag = julia_c_imag;
+    job_.frame = band_buffer.data();
+    job_.frame_y = y_start;
+    job_.field = field;
+    runTiles(tiles);
+}
+
+void RenderScheduler::equalizeFrame(const std::vector<Tile>& tiles, const IterationField& field,
+                                    const RenderParams& params,
+                                    std::vector<uint8_t>& frame_buffer,
+                                    ColorHistogram* histogram) {
+    TraceSpan span("equalizeFrame", "frame", field.origin_x, field.origin_y, field.width,
+                   field.height);
+    span.setValue("tiles", static_cast<int64_t>(tiles.size()));
+    frame_buffer.resize(static_cast<size_t>(field.width) * field.height * 4);
+
+    // Pass one: per-thread histograms, merged once every tile is counted
+    int iterations = params.color_iterations > 0 ? params.color_iterations
+                                                 : params.max_iterations;
+    for (ColorHistogram& thread_histogram : histograms_) {
+        thread_histogram.reset(iterations);
+    }
+    job_.kind = JOB_HISTOGRAM;
+    job_.retained = &field;
+    job_.frame = frame_buffer.data();
+    runTiles(tiles);
+
+    ColorHistogram merged(iterations);
+    for (const ColorHistogram& thread_histogram : histograms_) {
+        merged.merge(thread_histogram);
+    }
+    merged.finalize();
+
+    // Pass two: color through the CDF
+    RenderParams equalized = params;
+    equalized.color_histogram = &merged;
+    job_.kind = JOB_RECOLOR;
+    job_.params = &equalized;
+    runTiles(tiles);
+
+    if (histogram) {
+        *histogram = merged;
+    }
+}
+
+void RenderScheduler::runTasks(const std::vector<Tile>& tiles,
+                               const std::function<void(const Tile&)>& task) {
+    job_.kind = JOB_TASK;
+    job_.task = &task;
+    runTiles(tiles);
+}
+
+void RenderScheduler::runTiles(const std::vector<Tile>& tiles) {
+    // Deal tiles round-robin so neighbouring (similarly expensive) tiles
+    // start out on different threads
+    int queue_count = static_cast<int>(queues_.size());
+    for (size_t i = 0; i < tiles.size(); i++) {
+        WorkQueue& queue = *queues_[i % queue_count];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        queue.tiles.push_back(tiles[i]);
+    }
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    workers_active_ = queue_count;
+    generation_++;
+    start_cv_.notify_all();
+
+    done_cv_.wait(lock, [this] { return workers_active_ == 0; });
+}
+
+void RenderScheduler::workerLoop(int index) {
+    uint64_t seen_generation = 0;
+    TraceRecorder::setThreadName("scheduler " + std::to_string(index));
+
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            start_cv_.wait(lock, [&] { return stopping_ || generation_ != seen_generation; });
+            if (stopping_) {
+                return;
+            }
+            seen_generation = generation_;
+        }
+
+        // All tiles are queued before the frame starts, so once neither our
+        // deque nor any other has work left this thread is done
+        Tile tile;
+        while (popLocal(index, tile) || steal(index, tile)) {
+            runOne(index, tile);
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (--workers_active_ == 0) {
+                done_cv_.notify_one();
+            }
+        }
+    }
+}
+
+bool RenderScheduler::popLocal(int index, Tile& tile) {
+    WorkQueue& queue = *queues_[index];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if (queue.tiles.empty()) {
+        return false;
+    }
+    tile = queue.tiles.front();
+    queue.tiles.pop_front();
+    return true;
+}
+
+bool RenderScheduler::steal(int thief, Tile& tile) {
+    int queue_count = static_cast<int>(queues_.size());
+    for (int offset = 1; offset < queue_count; offset++) {
+        WorkQueue& victim = *queues_[(thief + offset) % queue_count];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.tiles.empty()) {
+            tile = victim.tiles.back();
+            victim.tiles.pop_back();
+            if (TraceRecorder* recorder = TraceRecorder::active()) {
+                TraceRecorder::Args args;
+                args.x = tile.x;
+                args.y = tile.y;
+                args.width = tile.width;
+                args.height = tile.height;
+                args.key = "victim";
+                args.value = (thief + offset) % queue_count;
+                recorder->instant("steal", "scheduler", args);
+            }
+            return true;
+        }
+    }
+    return false;
+}
+
+void RenderScheduler::runOne(int index, const Tile& tile) {
+    // Tiles never overlap, so they are written in place without locking
+    const FrameJob& job = job_;
+    switch (job.kind) {
+        case JOB_RENDER: {
+            int frame_stride = job.viewport->width * 4;
+            uint8_t* origin = job.frame +
+                              static_cast<size_t>(tile.y - job.frame_y) * frame_stride +
+                              tile.x * 4;
+            job.engine->renderTile(tile.x, tile.y, tile.width, tile.height,
+                                   *job.viewport, *job.params, job.type,
+                                   job.julia_c_real, job.julia_c_imag, origin, frame_stride,
+                                   job.field);
+            break;
+        }
+        case JOB_HISTOGRAM: {
+            TraceSpan span("histogramTile", "tile", tile.x, tile.y, tile.width, tile.height);
+            histograms_[index].addField(*job.retained, tile.x, tile.y, tile.width, tile.height);
+            break;
+        }
+        case JOB_RECOLOR: {
+            const IterationField& field = *job.retained;
+            int frame_stride = field.width * 4;
+            uint8_t* origin = job.frame +
+                              static_cast<size_t>(tile.y - field.origin_y) * frame_stride +
+                              (tile.x - field.origin_x) * 4;
+            FractalEngine::recolorTile(field, tile.x, tile.y, tile.width, tile.height,
+                                       *job.params, origin, frame_stride);
+            break;
+        }
+        case JOB_TASK:
+            (*job.task)(tile);
+            break;
+    }
+}
+
+} // namespace fractal
@@ -0,0 +1,121 @@
+#ifndef RENDER_SCHEDULER_H
+#define RENDER_SCHEDULER_H
+
+#include "../core/fractal_engine.h"
+#include "../core/color_histogram.h"
+#include "tile_manager.h"
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace fractal {
+
+// Native whole-frame renderer: a persistent pool of threads, one tile deque
+// per thread, with idle threads stealing from the others. Tiles are dealt
+// round-robin so that expensive regions are spread out; each owner takes
+// tiles from the front of its deque (keeping the caller's priority order)
+// and thieves take from the back. Not used by the WebAssembly build, where
+// parallelism comes from the JS worker pool.
+class RenderScheduler {
+public:
+    // thread_count <= 0 uses std::thread::hardware_concurrency()
+    explicit RenderScheduler(int thread_count = 0);
+    ~RenderScheduler();
+
+    RenderScheduler(const RenderScheduler&) = delete;
+    RenderScheduler& operator=(const RenderScheduler&) = delete;
+
+    // Render every tile into frame_buffer (viewport.width x viewport.height
+    // RGBA, resized as needed). Blocks until the whole frame is done. If
+    // field is given it is reset to the frame and keeps the iteration data
+    // for FractalEngine::recolorFrame.
+    void renderFrame(const FractalEngine& engine, const std::vector<Tile>& tiles,
+                     const Viewport& viewport, const RenderParams& params,
+                     FractalType type, double julia_c_real, double julia_c_imag,
+                     std::vector<uint8_t>& frame_buffer, IterationField* field = nullptr);
+
+    // Render the frame rows [y_start, y_start + rows) of viewport into
+    // band_buffer (viewport.width x rows RGBA, resized as needed), for
+    // images too large to hold whole. Tiles are in frame coordinates and
+    // must lie within the band. With field, the band's iteration field is
+    // kept as well (reset to cover the band).
+    void renderBand(const FractalEngine& engine, const std::vector<Tile>& tiles,
+                    const Viewport& viewport, const RenderParams& params,
+                    FractalType type, double julia_c_real, double julia_c_imag,
+                    int y_start, int rows, std::vector<uint8_t>& band_buffer,
+                    IterationField* field = nullptr);
+
+    // Histogram-equalized recolor of a frame rendered with a field, in two
+    // passes over its retained data: each thread counts the tiles it takes
+    // into its own histogram, the histograms are merged into one CDF, then
+    // the threads recolor their tiles through it. params.color_histogram is
+    // ignored; histogram (if given) receives the merged result.
+    void equalizeFrame(const std::vector<Tile>& tiles, const IterationField& field,
+                       const RenderParams& params, std::vector<uint8_t>& frame_buffer,
+                       ColorHistogram* histogram = nullptr);
+
+    // Run task on every tile across the pool, for work that is not a plain
+    // viewport render (tiles are then any rectangles the task understands).
+    // Blocks until all are done; task must be safe to call concurrently.
+    void runTasks(const std::vector<Tile>& tiles, const std::function<void(const Tile&)>& task);
+
+    int threadCount() const { return static_cast<int>(threads_.size()); }
+
+private:
+    enum JobKind {
+        JOB_RENDER,
+        JOB_HISTOGRAM,
+        JOB_RECOLOR,
+        JOB_TASK
+    };
+
+    struct alignas(64) WorkQueue {
+        std::mutex mutex;
+        std::deque<Tile> tiles;
+    };
+
+    struct FrameJob {
+        JobKind kind;
+        const FractalEngine* engine;
+        const Viewport* viewport;
+        const RenderParams* params;
+        FractalType type;
+        double julia_c_real;
+        double julia_c_imag;
+        uint8_t* frame;
+        int frame_y;                       // Frame row at the top of frame
+        IterationField* field;             // Filled by JOB_RENDER
+        const IterationField* retained;    // Read by JOB_HISTOGRAM and JOB_RECOLOR
+        const std::function<void(const Tile&)>* task;  // JOB_TASK
+    };
+
+    // Deal tiles to the queues and run job_ over them; blocks until done
+    void runTiles(const std::vector<Tile>& tiles);
+
+    void workerLoop(int index);
+    bool popLocal(int index, Tile& tile);
+    bool steal(int thief, Tile& tile);
+    void runOne(int index, const Tile& tile);
+
+    std::vector<std::thread> threads_;
+    std::vector<std::unique_ptr<WorkQueue>> queues_;
+    std::vector<ColorHistogram> histograms_;  // Per thread, for JOB_HISTOGRAM
+
+    // Frame hand-off between renderFrame() and the workers
+    std::mutex mutex_;
+    std::condition_variable start_cv_;
+    std::condition_variable done_cv_;
+    uint64_t generation_;
+    int workers_active_;
+    bool stopping_;
+    FrameJob job_;
+};
+
+} // namespace fractal
+
+#endif // RENDER_SCHEDULER_H
@@ -0,0 +1,207 @@
+#include "render_session.h"
+#include "../core/trace_recorder.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace fractal {
+
+namespace {
+
+constexpr int kPassCount = PASS_HIGH + 1;
+
+// Whether two renders produce the same pixels (stats and cancel aside)
+bool sameRender(const RenderParams& a, const RenderParams& b) {
+    return a.max_iterations == b.max_iterations && a.bailout_radius == b.bailout_radius &&
+           a.smooth_coloring == b.smooth_coloring && a.palette_id == b.palette_id &&
+           a.palette == b.palette &&
+           a.color_offset == b.color_offset && a.color_speed == b.color_speed &&
+           a.color_iterations == b.color_iterations && a.color_histogram == b.color_histogram &&
+           a.precision == b.precision && a.subdivide == b.subdivide &&
+           a.periodicity_check == b.periodicity_check &&
+           a.antialias_samples == b.antialias_samples &&
+           a.antialias_threshold == b.antialias_threshold;
+}
+
+bool sameViewport(const Viewport& a, const Viewport& b) {
+    return a.center_x == b.center_x && a.center_y == b.center_y && a.scale == b.scale &&
+           a.width == b.width && a.height == b.height;
+}
+
+} // namespace
+
+RenderSession::RenderSession(const FractalEngine& engine, int tile_size)
+    : engine_(engine), frame_count_(0), has_focus_(false), focus_x_(0.0), focus_y_(0.0) {
+    int step = ProgressiveRenderer::getPassParams(PASS_PREVIEW, 1).sample_step;
+    tile_size_ = (std::max(tile_size, 1) + step - 1) / step * step;
+}
+
+RenderSession::~RenderSession() {
+    cancel();
+}
+
+void RenderSession::update(const Viewport& viewport, const RenderParams& params,
+                           FractalType type, double julia_c_real, double julia_c_imag,
+                           RenderPass first_pass) {
+    TraceSpan span("sessionUpdate", "frame");
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (frame_ && sameViewport(frame_->viewport, viewport) &&
+        sameRender(frame_->params, params) && frame_->type == type &&
+        frame_->julia_c_real == julia_c_real && frame_->julia_c_imag == julia_c_imag &&
+        frame_->first_pass == first_pass) {
+        return;
+    }
+
+    if (frame_) {
+        frame_->cancelled.store(true, std::memory_order_relaxed);
+        span.setValue("cancelled_running", frame_->running);
+    }
+
+    auto frame = std::make_shared<Frame>();
+    frame->id = ++frame_count_;
+    frame->viewport = viewport;
+    frame->params = params;
+    frame->params.stats = nullptr;
+    frame->params.cancel = &frame->cancelled;
+    frame->type = type;
+    frame->julia_c_real = julia_c_real;
+    frame->julia_c_imag = julia_c_imag;
+    frame->first_pass = first_pass;
+    frame->cancelled.store(false, std::memory_order_relaxed);
+    frame->running = 0;
+    frame->finished = 0;
+    for (const Tile& tile : TileManager::generateTiles(viewport.width, viewport.height,
+                                                       tile_size_)) {
+        TileState state;
+        state.tile = tile;
+        state.next_pass = first_pass;
+        state.running = false;
+        frame->tiles.push_back(std::move(state));
+    }
+    frame_ = std::move(frame);
+    ready_cv_.notify_all();
+}
+
+void RenderSession::setFocus(double x, double y) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    has_focus_ = true;
+    focus_x_ = x;
+    focus_y_ = y;
+}
+
+void RenderSession::cancel() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (frame_) {
+        frame_->cancelled.store(true, std::memory_order_relaxed);
+        frame_.reset();
+    }
+    ready_cv_.notify_all();
+}
+
+int RenderSession::pick(const Frame& frame) const {
+    double focus_x = has_focus_ ? focus_x_ : frame.viewport.width / 2.0;
+    double focus_y = has_focus_ ? focus_y_ : frame.viewport.height / 2.0;
+
+    int best = -1;
+    int best_pass = kPassCount;
+    double best_distance = std::numeric_limits<double>::infinity();
+    for (size_t i = 0; i < frame.tiles.size(); i++) {
+        const TileState& state = frame.tiles[i];
+        if (state.running || state.next_pass >= kPassCount || state.next_pass > best_pass) {
+            continue;
+        }
+        double distance = std::hypot(state.tile.x + state.tile.width / 2.0 - focus_x,
+                                     state.tile.y + state.tile.height / 2.0 - focus_y);
+        if (state.next_pass < best_pass || distance < best_distance) {
+            best = static_cast<int>(i);
+            best_pass = state.next_pass;
+            best_distance = distance;
+        }
+    }
+    return best;
+}
+
+bool RenderSession::next(SessionTile& out) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (;;) {
+        if (!frame_) {
+            return false;
+        }
+        std::shared_ptr<Frame> frame = frame_;
+        int index = pick(*frame);
+        if (index < 0) {
+            // Later passes of running tiles become available when they return
+            if (frame->running == 0) {
+                return false;
+            }
+            ready_cv_.wait(lock);
+            continue;
+        }
+
+        TileState& state = frame->tiles[index];
+        int pass = state.next_pass;
+        state.running = true;
+        frame->running++;
+        lock.unlock();
+
+        const Tile& tile = state.tile;
+        ProgressiveRenderParams pass_params = ProgressiveRenderer::getPassParams(
+            static_cast<RenderPass>(pass), frame->params.max_iterations);
+        RenderParams params = frame->params;
+        params.max_iterations = pass_params.max_iterations;
+        if (params.color_iterations <= 0) {
+            params.color_iterations = frame->params.max_iterations;
+        }
+        bool first = pass == frame->first_pass;
+        if (first) {
+            state.field.keep_orbits = true;
+            state.field.reset(tile.x, tile.y, tile.width, tile.height);
+            state.pixels.resize(static_cast<size_t>(tile.width) * tile.height * 4);
+        }
+        // Later passes only redraw the blocks that changed
+        engine_.renderTileProgressive(tile.x, tile.y, tile.width, tile.height, frame->viewport,
+                                      params, frame->type, frame->julia_c_real,
+                                      frame->julia_c_imag, pass_params.sample_step,
+                                      first ? 0 : pass_params.previous_sample_step,
+                                      state.field, state.pixels.data(), tile.width * 4,
+                                      !first);
+
+        lock.lock();
+        state.running = false;
+        frame->running--;
+        ready_cv_.notify_all();
+        if (frame->cancelled.load(std::memory_order_relaxed)) {
+            continue;
+        }
+
+        state.next_pass++;
+        if (state.next_pass == kPassCount) {
+            state.field = IterationField();  // Release the orbits
+            out.pixels.swap(state.pixels);
+            std::vector<uint8_t>().swap(state.pixels);
+        } else {
+            out.pixels = state.pixels;
+        }
+        frame->finished++;
+        out.tile = tile;
+        out.pass = static_cast<RenderPass>(pass);
+        out.frame = frame->id;
+        return true;
+    }
+}
+
+uint64_t RenderSession::frame() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return frame_count_;
+}
+
+bool RenderSession::done() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!frame_) {
+        return true;
+    }
+    int units = static_cast<int>(frame_->tiles.size()) * (kPassCount - frame_->first_pass);
+    return frame_->finished == units;
+}
+
+} // namespace fractal
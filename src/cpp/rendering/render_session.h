@@ -0,0 +1,118 @@
+#ifndef RENDER_SESSION_H
+#define RENDER_SESSION_H
+
+#include "../core/fractal_engine.h"
+#include "progressive_renderer.h"
+#include "tile_manager.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace fractal {
+
+// One finished unit of a session: a progressive pass over one tile
+struct SessionTile {
+    Tile tile;
+    RenderPass pass;
+    uint64_t frame;               // RenderSession::frame() it was rendered for
+    std::vector<uint8_t> pixels;  // tile.width x tile.height RGBA
+
+    SessionTile() : pass(PASS_PREVIEW), frame(0) {}
+};
+
+// Owns the tiles and progressive passes of one view and yields them in
+// priority order: every tile's pass before any tile's next pass, and within
+// a pass the tiles nearest the focus first. Each pass refines the tile's
+// own retained field, as FractalEngine::renderTileProgressive describes.
+//
+// update() moves the session to another view. Work for the old view that
+// has not started is dropped, and renders already running are cancelled
+// through RenderParams::cancel, so they stop within about a millisecond
+// instead of finishing tiles nobody will see. setFocus() re-prioritizes
+// the pending work without cancelling any.
+//
+// next() may be called from any number of threads; the session must
+// outlive them.
+class RenderSession {
+public:
+    // tile_size is rounded up to a multiple of the preview pass's step
+    explicit RenderSession(const FractalEngine& engine, int tile_size = 64);
+    ~RenderSession();
+
+    RenderSession(const RenderSession&) = delete;
+    RenderSession& operator=(const RenderSession&) = delete;
+
+    // Render this view from first_pass to PASS_HIGH, whose limit is
+    // params.max_iterations; earlier passes use getPassParams' limits but
+    // are colored on the final pass's scale. Replaces the current view
+    // unless nothing that affects the output changed. params.stats and
+    // params.cancel are not used.
+    void update(const Viewport& viewport, const RenderParams& params, FractalType type,
+                double julia_c_real, double julia_c_imag,
+                RenderPass first_pass = PASS_PREVIEW);
+
+    // Start pending tiles nearest frame pixel (x, y) first (the frame
+    // center until set)
+    void setFocus(double x, double y);
+
+    // Drop the current view, cancelling its running renders
+    void cancel();
+
+    // Render the highest-priority pending unit of the current view into
+    // out. Waits while the only units left depend on passes running on
+    // other threads; returns false once the view has no unit left to start
+    // (or there is none). Units cancelled by update() are never returned.
+    bool next(SessionTile& out);
+
+    // Counts update() calls that replaced the view
+    uint64_t frame() const;
+
+    // Whether every unit of the current view has been returned
+    bool done() const;
+
+private:
+    struct TileState {
+        Tile tile;
+        int next_pass;
+        bool running;
+        IterationField field;
+        std::vector<uint8_t> pixels;  // The tile as of its last pass
+    };
+
+    // Everything about one view; renders still running for a replaced view
+    // keep theirs alive until they return
+    struct Frame {
+        uint64_t id;
+        Viewport viewport;
+        RenderParams params;
+        FractalType type;
+        double julia_c_real;
+        double julia_c_imag;
+        int first_pass;
+        std::atomic<bool> cancelled;
+        std::vector<TileState> tiles;
+        int running;   // Units being rendered
+        int finished;  // Units returned by next()
+    };
+
+    // Index of the best tile with a pass left that is not running, or -1
+    int pick(const Frame& frame) const;
+
+    const FractalEngine& engine_;
+    int tile_size_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable ready_cv_;
+    std::shared_ptr<Frame> frame_;
+    uint64_t frame_count_;
+    bool has_focus_;
+    double focus_x_;
+    double focus_y_;
+};
+
+} // namespace fractal
+
+#endif // RENDER_SESSION_H
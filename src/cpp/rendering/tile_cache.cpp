@@ -0,0 +1,312 @@
+#include "tile_cache.h"
+#include "../core/color_palette.h"
+#include "../core/fractal_family.h"
+#include <cmath>
+#include <functional>
+
+namespace fractal {
+
+namespace {
+
+// Approximate heap cost of one cached tile
+constexpr size_t kEntryBytes =
+    TileCache::kTileSize * TileCache::kTileSize * (sizeof(float) + sizeof(uint8_t)) +
+    sizeof(IterationField) + 2 * sizeof(TileKey) + 64;
+
+int64_t floorDiv(int64_t value, int64_t divisor) {
+    return (value >= 0 ? value : value - (divisor - 1)) / divisor;
+}
+
+// Index of the world sample nearest to coordinate, or false if it cannot be
+// represented exactly
+bool nearestSample(double coordinate, double pixel, int64_t& sample) {
+    double index = std::floor(coordinate / pixel + 0.5);
+    if (!(std::fabs(index) < 4503599627370496.0)) {  // 2^52, also rejects NaN
+        return false;
+    }
+    sample = static_cast<int64_t>(index);
+    return true;
+}
+
+void hashCombine(size_t& seed, size_t value) {
+    seed ^= value + 0x9e3779b97f4a7c15ull + (seed << 6) + (seed >> 2);
+}
+
+} // namespace
+
+bool TileKey::operator==(const TileKey& other) const {
+    return address.level == other.address.level && address.i == other.address.i &&
+           address.j == other.address.j && type == other.type &&
+           julia_c_real == other.julia_c_real && julia_c_imag == other.julia_c_imag &&
+           max_iterations == other.max_iterations &&
+           bailout_radius == other.bailout_radius &&
+           smooth_coloring == other.smooth_coloring;
+}
+
+size_t TileKeyHash::operator()(const TileKey& key) const {
+    size_t seed = std::hash<int>()(key.address.level);
+    hashCombine(seed, std::hash<int64_t>()(key.address.i));
+    hashCombine(seed, std::hash<int64_t>()(key.address.j));
+    hashCombine(seed, std::hash<int>()(key.type));
+    hashCombine(seed, std::hash<double>()(key.julia_c_real));
+    hashCombine(seed, std::hash<double>()(key.julia_c_imag));
+    hashCombine(seed, std::hash<int>()(key.max_iterations));
+    hashCombine(seed, std::hash<double>()(key.bailout_radius));
+    hashCombine(seed, std::hash<bool>()(key.smooth_coloring));
+    return seed;
+}
+
+TileCache::TileCache(size_t memory_budget)
+    : memory_budget_(memory_budget), memory_used_(0), hits_(0), merges_(0), misses_(0) {
+}
+
+int TileCache::levelForScale(double scale) {
+    // Smallest level whose pixel (2^-level) is not wider than scale
+    return static_cast<int>(std::ceil(-std::log2(scale)));
+}
+
+bool TileCache::renderTile(const FractalEngine& engine, int x_start, int y_start,
+                           int tile_width, int tile_height, const Viewport& viewport,
+                           const RenderParams& params, FractalType type,
+                           double julia_c_real, double julia_c_imag,
+                           uint8_t* pixels, int row_stride) {
+    if (tile_width <= 0 || tile_height <= 0) {
+        return true;
+    }
+
+    int level = levelForScale(viewport.scale);
+    if (level > kMaxLevel) {
+        return false;
+    }
+    double pixel = std::ldexp(1.0, -level);
+
+    // Nearest world sample for every column and row of the view tile
+    thread_local std::vector<int64_t> column_samples, row_samples;
+    column_samples.resize(tile_width);
+    row_samples.resize(tile_height);
+    for (int x = 0; x < tile_width; x++) {
+        double c_real = (x_start + x - viewport.width / 2.0) * viewport.scale + viewport.center_x;
+        if (!nearestSample(c_real, pixel, column_samples[x])) {
+            return false;
+        }
+    }
+    for (int y = 0; y < tile_height; y++) {
+        double c_imag = (y_start + y - viewport.height / 2.0) * viewport.scale + viewport.center_y;
+        if (!nearestSample(c_imag, pixel, row_samples[y])) {
+            return false;
+        }
+    }
+
+    TileKey key;
+    key.address.level = level;
+    key.type = type;
+    bool julia = familyKernels(type).julia;
+    key.julia_c_real = julia ? julia_c_real : 0.0;
+    key.julia_c_imag = julia ? julia_c_imag : 0.0;
+    key.max_iterations = params.max_iterations;
+    key.bailout_radius = params.bailout_radius;
+    key.smooth_coloring = params.smooth_coloring;
+
+    // Fetch every world tile the view tile touches
+    int64_t i_first = floorDiv(column_samples.front(), kTileSize);
+    int64_t i_last = floorDiv(column_samples.back(), kTileSize);
+    int64_t j_first = floorDiv(row_samples.front(), kTileSize);
+    int64_t j_last = floorDiv(row_samples.back(), kTileSize);
+    int64_t columns = i_last - i_first + 1;
+
+    std::vector<std::shared_ptr<const IterationField>> world_tiles;
+    world_tiles.reserve(columns * (j_last - j_first + 1));
+    for (int64_t j = j_first; j <= j_last; j++) {
+        for (int64_t i = i_first; i <= i_last; i++) {
+            key.address.i = i;
+            key.address.j = j;
+            world_tiles.push_back(fetch(engine, key, params));
+        }
+    }
+
+    const ColorPalette& palette = ColorPalette::forParams(params);
+    double lut_scale = ColorPalette::lutScale(params);
+    double lut_offset = ColorPalette::lutOffset(params);
+
+    for (int y = 0; y < tile_height; y++) {
+        int64_t j = floorDiv(row_samples[y], kTileSize);
+        int64_t sample_y = row_samples[y] - j * kTileSize;
+        const std::shared_ptr<const IterationField>* tile_row =
+            world_tiles.data() + (j - j_first) * columns;
+        uint8_t* row = pixels + static_cast<size_t>(y) * row_stride;
+
+        for (int x = 0; x < tile_width; x++) {
+            int64_t i = floorDiv(column_samples[x], kTileSize);
+            int64_t sample_x = column_samples[x] - i * kTileSize;
+            const IterationField& field = *tile_row[i - i_first];
+            size_t index = static_cast<size_t>(sample_y * kTileSize + sample_x);
+
+            double value = ColorPalette::colorValue(params, field.smooth_values[index]);
+            Color color = palette.lookup(value, field.inside_set[index] != 0, lut_scale,
+                                         lut_offset);
+            row[x * 4 + 0] = color.r;
+            row[x * 4 + 1] = color.g;
+            row[x * 4 + 2] = color.b;
+            row[x * 4 + 3] = color.a;
+        }
+    }
+
+    return true;
+}
+
+std::shared_ptr<const IterationField> TileCache::fetch(const FractalEngine& engine,
+                                                       const TileKey& key,
+                                                       const RenderParams& params) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (auto field = findLocked(key)) {
+            hits_++;
+            return field;
+        }
+    }
+
+    // Render outside the lock; another thread may race us to the same tile,
+    // in which case the first insert wins
+    std::shared_ptr<const IterationField> field = mergeChildren(key);
+    bool merged = field != nullptr;
+    if (!merged) {
+        field = renderWorldTile(engine, key, params);
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (merged) {
+        merges_++;
+    } else {
+        misses_++;
+    }
+
+    auto it = entries_.find(key);
+    if (it != entries_.end()) {
+        return it->second.field;
+    }
+
+    lru_.push_front(key);
+    entries_[key] = Entry{field, lru_.begin()};
+    memory_used_ += kEntryBytes;
+    evictLocked();
+    return field;
+}
+
+std::shared_ptr<const IterationField> TileCache::findLocked(const TileKey& key) {
+    auto it = entries_.find(key);
+    if (it == entries_.end()) {
+        return nullptr;
+    }
+    lru_.splice(lru_.begin(), lru_, it->second.lru_position);
+    return it->second.field;
+}
+
+void TileCache::evictLocked() {
+    while (memory_used_ > memory_budget_ && !lru_.empty()) {
+        entries_.erase(lru_.back());
+        lru_.pop_back();
+        memory_used_ -= kEntryBytes;
+    }
+}
+
+std::shared_ptr<const IterationField> TileCache::renderWorldTile(
+    const FractalEngine& engine, const TileKey& key, const RenderParams& params) const {
+    // A kTileSize-square view whose pixel x maps exactly to sample
+    // (i * kTileSize + x) * pixel
+    double pixel = std::ldexp(1.0, -key.address.level);
+    double half = kTileSize / 2;
+    Viewport tile_view((static_cast<double>(key.address.i * kTileSize) + half) * pixel,
+                       (static_cast<double>(key.address.j * kTileSize) + half) * pixel,
+                       pixel, kTileSize, kTileSize);
+
+    auto field = std::make_shared<IterationField>();
+    field->reset(0, 0, kTileSize, kTileSize);
+    engine.renderTile(0, 0, kTileSize, kTileSize, tile_view, params, key.type,
+                      key.julia_c_real, key.julia_c_imag, nullptr, 0, field.get());
+    return field;
+}
+
+std::shared_ptr<const IterationField> TileCache::mergeChildren(const TileKey& key) {
+    if (key.address.level >= kMaxLevel) {
+        return nullptr;
+    }
+
+    // Children in (a, b) order: child (2i + a, 2j + b)
+    std::shared_ptr<const IterationField> children[2][2];
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        TileKey child = key;
+        child.address.level = key.address.level + 1;
+        for (int b = 0; b < 2; b++) {
+            for (int a = 0; a < 2; a++) {
+                child.address.i = key.address.i * 2 + a;
+                child.address.j = key.address.j * 2 + b;
+                auto it = entries_.find(child);
+                if (it == entries_.end()) {
+                    return nullptr;
+                }
+                children[b][a] = it->second.field;
+            }
+        }
+    }
+
+    // Parent sample g is child sample 2g, so this is exact decimation
+    const int half = kTileSize / 2;
+    auto field = std::make_shared<IterationField>();
+    field->reset(0, 0, kTileSize, kTileSize);
+    for (int y = 0; y < kTileSize; y++) {
+        for (int x = 0; x < kTileSize; x++) {
+            const IterationField& source = *children[y / half][x / half];
+            size_t from = static_cast<size_t>((y % half) * 2) * kTileSize + (x % half) * 2;
+            size_t to = static_cast<size_t>(y) * kTileSize + x;
+            field->smooth_values[to] = source.smooth_values[from];
+            field->inside_set[to] = source.inside_set[from];
+        }
+    }
+    return field;
+}
+
+void TileCache::setMemoryBudget(size_t bytes) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    memory_budget_ = bytes;
+    evictLocked();
+}
+
+size_t TileCache::memoryBudget() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return memory_budget_;
+}
+
+size_t TileCache::memoryUsed() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return memory_used_;
+}
+
+size_t TileCache::tileCount() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return entries_.size();
+}
+
+void TileCache::clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    entries_.clear();
+    lru_.clear();
+    memory_used_ = 0;
+}
+
+uint64_t TileCache::hits() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return hits_;
+}
+
+uint64_t TileCache::merges() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return merges_;
+}
+
+uint64_t TileCache::misses() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return misses_;
+}
+
+} // namespace fractal
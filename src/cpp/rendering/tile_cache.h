@@ -0,0 +1,121 @@
+#ifndef TILE_CACHE_H
+#define TILE_CACHE_H
+
+#include "../core/fractal_engine.h"
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace fractal {
+
+// Address of a tile on the world-aligned quadtree. At level L a pixel is
+// 2^-L units wide and tile (i, j) holds the samples at
+// ((i * kTileSize + x) * 2^-L, (j * kTileSize + y) * 2^-L) for x, y in
+// [0, kTileSize). Every sample of a level-L tile is also a sample of one of
+// its four level-(L+1) children.
+struct TileAddress {
+    int level;
+    int64_t i;
+    int64_t j;
+
+    TileAddress() : level(0), i(0), j(0) {}
+    TileAddress(int level_, int64_t i_, int64_t j_) : level(level_), i(i_), j(j_) {}
+};
+
+// Everything that determines a tile's iteration data. The palette is not
+// part of it: cached tiles hold an IterationField and are colored on use.
+struct TileKey {
+    TileAddress address;
+    FractalType type;
+    double julia_c_real;  // 0 for Mandelbrot
+    double julia_c_imag;
+    int max_iterations;
+    double bailout_radius;
+    bool smooth_coloring;
+
+    bool operator==(const TileKey& other) const;
+};
+
+struct TileKeyHash {
+    size_t operator()(const TileKey& key) const;
+};
+
+// LRU cache of world-aligned tiles, bounded by a memory budget. Views are
+// composed from the level whose pixel is the largest power of two not
+// above the view's scale, so panning back, zooming back in and zooming
+// out over already-rendered regions (parents are assembled from their
+// children) are served without iterating. Views whose scale is not a power
+// of two are resampled to the nearest cached sample.
+class TileCache {
+public:
+    static constexpr int kTileSize = 64;
+
+    // Deepest level whose sample indices stay exact in a double
+    static constexpr int kMaxLevel = 44;
+
+    explicit TileCache(size_t memory_budget = 64u << 20);
+
+    TileCache(const TileCache&) = delete;
+    TileCache& operator=(const TileCache&) = delete;
+
+    // Level used for a view of the given scale (units per pixel)
+    static int levelForScale(double scale);
+
+    // Render a tile of the view from cached world tiles, rendering the
+    // missing ones with engine. Returns false (leaving pixels untouched) if
+    // the view is deeper than kMaxLevel or too far out to address.
+    bool renderTile(const FractalEngine& engine, int x_start, int y_start,
+                    int tile_width, int tile_height, const Viewport& viewport,
+                    const RenderParams& params, FractalType type,
+                    double julia_c_real, double julia_c_imag,
+                    uint8_t* pixels, int row_stride);
+
+    // Cached iteration data for a tile, rendering (or assembling it from
+    // cached children) on a miss
+    std::shared_ptr<const IterationField> fetch(const FractalEngine& engine, const TileKey& key,
+                                                const RenderParams& params);
+
+    // Shrinking the budget evicts least recently used tiles immediately
+    void setMemoryBudget(size_t bytes);
+    size_t memoryBudget() const;
+    size_t memoryUsed() const;
+    size_t tileCount() const;
+    void clear();
+
+    // Lookups served from cache, from cached children, and by rendering
+    uint64_t hits() const;
+    uint64_t merges() const;
+    uint64_t misses() const;
+
+private:
+    struct Entry {
+        std::shared_ptr<const IterationField> field;
+        std::list<TileKey>::iterator lru_position;
+    };
+
+    // Caller holds mutex_
+    std::shared_ptr<const IterationField> findLocked(const TileKey& key);
+    void evictLocked();
+
+    std::shared_ptr<const IterationField> renderWorldTile(const FractalEngine& engine,
+                                                          const TileKey& key,
+                                                          const RenderParams& params) const;
+    std::shared_ptr<const IterationField> mergeChildren(const TileKey& key);
+
+    mutable std::mutex mutex_;
+    std::unordered_map<TileKey, Entry, TileKeyHash> entries_;
+    std::list<TileKey> lru_;  // Most recently used first
+    size_t memory_budget_;
+    size_t memory_used_;
+    uint64_t hits_;
+    uint64_t merges_;
+    uint64_t misses_;
+};
+
+} // namespace fractal
+
+#endif // TILE_CACHE_H
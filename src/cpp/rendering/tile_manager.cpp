@@ -1,4 +1,5 @@
 #include "tile_manager.h"
+#include "../core/trace_recorder.h"
 #include <algorithm>
 #include <cmath>
 
@@ -6,6 +7,7 @@ namespace fractal {
 
 std::vector<Tile> TileManager::generateTiles(int viewport_width, int viewport_height,
                                              int tile_size) {
+    TraceSpan span("generateTiles", "frame");
     std::vector<Tile> tiles;
 
     for (int y = 0; y < viewport_height; y += tile_size) {
@@ -16,11 +18,14 @@ std::vector<Tile> TileManager::generateTiles(int viewport_width, int viewport_he
         }
     }
 
+    span.setValue("tiles", static_cast<int64_t>(tiles.size()));
     return tiles;
 }
 
 void TileManager::sortByDistanceFromCenter(std::vector<Tile>& tiles,
                                           int viewport_width, int viewport_height) {
+    TraceSpan span("sortTiles", "frame");
+    span.setValue("tiles", static_cast<int64_t>(tiles.size()));
     double center_x = viewport_width / 2.0;
     double center_y = viewport_height / 2.0;
 
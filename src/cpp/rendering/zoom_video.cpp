@@ -0,0 +1,347 @@
+#include "zoom_video.h"
+#include "../core/color_palette.h"
+#include "../core/trace_recorder.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace fractal {
+
+namespace {
+
+constexpr double kTwoPi = 6.283185307179586;
+
+void storeColor(const ColorPalette& palette, const RenderParams& params, double lut_scale,
+                double lut_offset, const FractalPoint& point, uint8_t* out) {
+    Color color = palette.lookup(ColorPalette::colorValue(params, point.smooth_value),
+                                 point.inside_set, lut_scale, lut_offset);
+    out[0] = color.r;
+    out[1] = color.g;
+    out[2] = color.b;
+    out[3] = color.a;
+}
+
+// Blend of two RGBA pixels, weight in [0, 256] toward b, two channels per
+// multiply
+inline uint32_t blend(uint32_t a, uint32_t b, uint32_t weight) {
+    uint32_t keep = 256 - weight;
+    uint32_t red_blue = ((a & 0xff00ff) * keep + (b & 0xff00ff) * weight) >> 8;
+    uint32_t green_alpha = ((a >> 8) & 0xff00ff) * keep + ((b >> 8) & 0xff00ff) * weight;
+    return (red_blue & 0xff00ff) | (green_alpha & 0xff00ff00);
+}
+
+// Mean of four RGBA pixels, rounded
+inline uint32_t average(uint32_t a, uint32_t b, uint32_t c, uint32_t d) {
+    uint32_t red_blue = (a & 0xff00ff) + (b & 0xff00ff) + (c & 0xff00ff) + (d & 0xff00ff) +
+                        0x20002;
+    uint32_t green_alpha = ((a >> 8) & 0xff00ff) + ((b >> 8) & 0xff00ff) +
+                           ((c >> 8) & 0xff00ff) + ((d >> 8) & 0xff00ff) + 0x20002;
+    return ((red_blue >> 2) & 0xff00ff) | ((green_alpha << 6) & 0xff00ff00);
+}
+
+inline uint32_t loadPixel(const uint8_t* cell) {
+    uint32_t pixel;
+    std::memcpy(&pixel, cell, 4);
+    return pixel;
+}
+
+} // namespace
+
+ZoomPath ZoomPath::fromViewport(const Viewport& start, double factor, int focus_x, int focus_y,
+                                int frame_count) {
+    ZoomPath path;
+    path.target_real = (focus_x - start.width / 2.0) * start.scale + start.center_x;
+    path.target_imag = (focus_y - start.height / 2.0) * start.scale + start.center_y;
+    path.focus_x = focus_x;
+    path.focus_y = focus_y;
+    path.width = start.width;
+    path.height = start.height;
+    path.start_scale = start.scale;
+    path.factor = factor;
+    path.frame_count = frame_count;
+    return path;
+}
+
+double ZoomPath::scaleAt(int frame) const {
+    return start_scale * std::pow(factor, frame);
+}
+
+Viewport ZoomPath::frame(int frame) const {
+    double scale = scaleAt(frame);
+    return Viewport(target_real - (focus_x - width / 2.0) * scale,
+                    target_imag - (focus_y - height / 2.0) * scale, scale, width, height);
+}
+
+ZoomVideoRenderer::ZoomVideoRenderer(RenderScheduler& scheduler, const FractalEngine& engine,
+                                     const ZoomPath& path, const RenderParams& params,
+                                     FractalType type, double julia_c_real,
+                                     double julia_c_imag, double density,
+                                     double center_radius)
+    : scheduler_(scheduler), engine_(engine), path_(path), params_(params), type_(type),
+      julia_c_real_(julia_c_real), julia_c_imag_(julia_c_imag), strip_points_(0),
+      center_points_(0) {
+    double reach_x = std::max(path.focus_x, path.width - path.focus_x);
+    double reach_y = std::max(path.focus_y, path.height - path.focus_y);
+    max_radius_ = std::hypot(reach_x, reach_y);
+    center_radius_ = center_radius > 0.0 ? center_radius : std::max(8.0, max_radius_ / 32.0);
+    center_radius_ = std::min(center_radius_, max_radius_);
+
+    // Every level's columns fill whole blocks
+    int column_unit = kBlockColumns << (kLevels - 1);
+    columns_ = static_cast<int>(std::ceil(kTwoPi * max_radius_ * density / column_unit));
+    columns_ = std::max(1, columns_) * column_unit;
+    delta_ = kTwoPi / columns_;
+
+    double first_scale = path.scaleAt(0);
+    double last_scale = path.scaleAt(std::max(0, path.frame_count - 1));
+    min_radius_ = std::min(first_scale, last_scale) * center_radius_ * std::exp(-2 * delta_);
+    double max_radius = std::max(first_scale, last_scale) * max_radius_;
+    rows_ = static_cast<int>(std::ceil(std::log(max_radius / min_radius_) / delta_)) + 2;
+    rows_ = (rows_ + kChunkRows - 1) / kChunkRows * kChunkRows;
+
+    level_offsets_[0] = 0;
+    for (int level = 0; level < kLevels; level++) {
+        level_offsets_[level + 1] = level_offsets_[level] +
+            static_cast<size_t>(kChunkRows >> level) * (columns_ >> level) * 4;
+    }
+
+    cos_.resize(columns_);
+    sin_.resize(columns_);
+    for (int j = 0; j < columns_; j++) {
+        cos_[j] = std::cos(j * delta_);
+        sin_[j] = std::sin(j * delta_);
+    }
+
+    // A pixel's log radius and angle are the same in every frame; only the
+    // strip row of radius 1 pixel moves. Its level is the one whose cells
+    // at its radius are about a pixel wide.
+    polar_.resize(static_cast<size_t>(path.width) * path.height);
+    for (int y = 0; y < path.height; y++) {
+        double dy = y - path.focus_y;
+        for (int x = 0; x < path.width; x++) {
+            double dx = x - path.focus_x;
+            PolarPixel& pixel = polar_[static_cast<size_t>(y) * path.width + x];
+            double radius_squared = dx * dx + dy * dy;
+            if (radius_squared < center_radius_ * center_radius_) {
+                pixel = PolarPixel();
+                pixel.level = -1;
+                continue;
+            }
+            double radius = std::sqrt(radius_squared);
+            int level = static_cast<int>(std::floor(std::log2(1.0 / (radius * delta_))));
+            level = std::min(std::max(level, 0), kLevels - 1);
+
+            // A level cell's center is the mean of the cells it covers
+            double cells = 1 << level;
+            double center = (cells - 1.0) / 2.0;
+            double column = std::atan2(dy, dx) / delta_;
+            column = (column - center) / cells;
+            int level_columns = columns_ >> level;
+            if (column < 0.0) {
+                column += level_columns;
+            }
+            column = std::min(column, level_columns - 1e-3);
+            int left = static_cast<int>(column);
+            int right = left + 1 == level_columns ? 0 : left + 1;
+            pixel.row = static_cast<float>((std::log(radius) / delta_ - center) / cells);
+            pixel.level = static_cast<int16_t>(level);
+            pixel.column_weight = static_cast<uint16_t>((column - left) * 256.0);
+            pixel.left = static_cast<uint32_t>(cellOffset(level, 0, left) -
+                                               cellOffset(level, 0, 0));
+            pixel.right = static_cast<uint32_t>(cellOffset(level, 0, right) -
+                                                cellOffset(level, 0, 0));
+        }
+    }
+}
+
+size_t ZoomVideoRenderer::stripBytes() const {
+    size_t bytes = 0;
+    for (const auto& chunk : chunks_) {
+        bytes += chunk.second.size();
+    }
+    return bytes;
+}
+
+void ZoomVideoRenderer::rowWindow(int index, int& first, int& last) const {
+    double scale = path_.scaleAt(index);
+    first = static_cast<int>(std::floor(std::log(scale * center_radius_ / min_radius_) /
+                                        delta_)) - 1;
+    last = static_cast<int>(std::ceil(std::log(scale * max_radius_ / min_radius_) / delta_)) + 1;
+    first = std::max(0, first);
+    last = std::min(rows_ - 1, last);
+}
+
+void ZoomVideoRenderer::prepareRows(int first, int last) {
+    int first_chunk = first / kChunkRows;
+    int last_chunk = last / kChunkRows;
+    for (auto it = chunks_.begin(); it != chunks_.end();) {
+        if (it->first < first_chunk || it->first > last_chunk) {
+            it = chunks_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+
+    // Buffers are all allocated before the tasks start, which only read
+    // the map
+    std::vector<Tile> tiles;
+    for (int chunk = first_chunk; chunk <= last_chunk; chunk++) {
+        if (chunks_.count(chunk)) {
+            continue;
+        }
+        chunks_[chunk].resize(level_offsets_[kLevels]);
+        strip_points_ += static_cast<uint64_t>(kChunkRows) * columns_;
+        for (int column = 0; column < columns_; column += kTaskColumns) {
+            tiles.emplace_back(column, chunk * kChunkRows,
+                               std::min(kTaskColumns, columns_ - column), kChunkRows);
+        }
+    }
+    if (!tiles.empty()) {
+        scheduler_.runTasks(tiles, [this](const Tile& tile) { computeStripTile(tile); });
+    }
+}
+
+void ZoomVideoRenderer::computeStripTile(const Tile& tile) {
+    TraceSpan span("stripTile", "tile", tile.x, tile.y, tile.width, tile.height);
+    const ColorPalette& palette = ColorPalette::forParams(params_);
+    double lut_scale = ColorPalette::lutScale(params_);
+    double lut_offset = ColorPalette::lutOffset(params_);
+
+    thread_local std::vector<double> offset_real, offset_imag;
+    thread_local std::vector<FractalPoint> points;
+    offset_real.resize(tile.width);
+    offset_imag.resize(tile.width);
+    points.resize(tile.width);
+
+    uint8_t* chunk = chunks_.find(tile.y / kChunkRows)->second.data();
+    for (int row = tile.y; row < tile.y + tile.height; row++) {
+        double radius = min_radius_ * std::exp(row * delta_);
+        for (int i = 0; i < tile.width; i++) {
+            offset_real[i] = radius * cos_[tile.x + i];
+            offset_imag[i] = radius * sin_[tile.x + i];
+        }
+        engine_.computePoints(path_.target_real, path_.target_imag, offset_real.data(),
+                              offset_imag.data(), tile.width, radius * delta_, params_, type_,
+                              julia_c_real_, julia_c_imag_, points.data());
+
+        for (int i = 0; i < tile.width; i++) {
+            storeColor(palette, params_, lut_scale, lut_offset, points[i],
+                       chunk + cellOffset(0, row - tile.y, tile.x + i));
+        }
+    }
+
+    // Tiles cover whole chunks of rows and whole blocks of every level
+    for (int level = 1; level < kLevels; level++) {
+        for (int row = 0; row < kChunkRows >> level; row++) {
+            for (int column = tile.x >> level; column < (tile.x + tile.width) >> level;
+                 column++) {
+                const uint8_t* inner = chunk + cellOffset(level - 1, row * 2, column * 2);
+                const uint8_t* outer = chunk + cellOffset(level - 1, row * 2 + 1, column * 2);
+                uint32_t color = average(loadPixel(inner), loadPixel(inner + 4),
+                                         loadPixel(outer), loadPixel(outer + 4));
+                std::memcpy(chunk + cellOffset(level, row, column), &color, 4);
+            }
+        }
+    }
+}
+
+void ZoomVideoRenderer::renderFrame(int index, std::vector<uint8_t>& frame_buffer) {
+    TraceSpan span("zoomFrame", "frame", 0, 0, path_.width, path_.height);
+    span.setValue("frame", index);
+    frame_buffer.resize(static_cast<size_t>(path_.width) * path_.height * 4);
+
+    int first, last;
+    rowWindow(index, first, last);
+    prepareRows(first, last);
+
+    std::vector<const uint8_t*> strip_rows[kLevels];
+    int first_rows[kLevels];
+    for (int level = 0; level < kLevels; level++) {
+        int level_rows = kChunkRows >> level;
+        first_rows[level] = first >> level;
+        for (int row = first_rows[level]; row <= last >> level; row++) {
+            strip_rows[level].push_back(chunks_.find(row / level_rows)->second.data() +
+                                        cellOffset(level, row % level_rows, 0));
+        }
+    }
+
+    std::vector<Tile> bands;
+    for (int y = 0; y < path_.height; y += 16) {
+        bands.emplace_back(0, y, path_.width, std::min(16, path_.height - y));
+    }
+    uint8_t* frame = frame_buffer.data();
+    scheduler_.runTasks(bands, [&](const Tile& rows) {
+        composeRows(rows, index, strip_rows, first_rows, frame);
+    });
+}
+
+void ZoomVideoRenderer::composeRows(const Tile& rows, int index,
+                                    const std::vector<const uint8_t*> (&strip_rows)[kLevels],
+                                    const int (&first_rows)[kLevels], uint8_t* frame) {
+    double scale = path_.scaleAt(index);
+    double row_base = std::log(scale / min_radius_) / delta_;
+    double row_bases[kLevels];
+    for (int level = 0; level < kLevels; level++) {
+        row_bases[level] = row_base / (1 << level);
+    }
+
+    // Center disc pixels, iterated together once the strip samples are in
+    thread_local std::vector<double> offset_real, offset_imag;
+    thread_local std::vector<size_t> center_pixels;
+    thread_local std::vector<FractalPoint> points;
+    offset_real.clear();
+    offset_imag.clear();
+    center_pixels.clear();
+
+    for (int y = rows.y; y < rows.y + rows.height; y++) {
+        size_t index_base = static_cast<size_t>(y) * path_.width;
+        uint8_t* out = frame + index_base * 4;
+        for (int x = 0; x < path_.width; x++, out += 4) {
+            const PolarPixel& pixel = polar_[index_base + x];
+            if (pixel.level < 0) {
+                offset_real.push_back((x - path_.focus_x) * scale);
+                offset_imag.push_back((y - path_.focus_y) * scale);
+                center_pixels.push_back(index_base + x);
+                continue;
+            }
+
+            // Bilinear sample of the pixel's level (8-bit weights): rows by
+            // log radius, columns by angle
+            const std::vector<const uint8_t*>& level_rows = strip_rows[pixel.level];
+            int first_row = first_rows[pixel.level];
+            int last_row = first_row + static_cast<int>(level_rows.size()) - 1;
+            double u = pixel.row + row_bases[pixel.level];
+            int row = static_cast<int>(u);
+            row = std::max(std::min(row - (row > u), last_row - 1), first_row);
+            uint32_t wu = static_cast<uint32_t>(std::min(std::max(u - row, 0.0), 1.0) * 256.0);
+            uint32_t wv = pixel.column_weight;
+
+            const uint8_t* inner = level_rows[row - first_row];
+            const uint8_t* outer = level_rows[std::min(row + 1, last_row) - first_row];
+            uint32_t near = blend(loadPixel(inner + pixel.left), loadPixel(inner + pixel.right), wv);
+            uint32_t far = blend(loadPixel(outer + pixel.left), loadPixel(outer + pixel.right), wv);
+            uint32_t color = blend(near, far, wu);
+            std::memcpy(out, &color, 4);
+        }
+    }
+
+    int count = static_cast<int>(center_pixels.size());
+    if (count == 0) {
+        return;
+    }
+    points.resize(count);
+    engine_.computePoints(path_.target_real, path_.target_imag, offset_real.data(),
+                          offset_imag.data(), count, scale, params_, type_, julia_c_real_,
+                          julia_c_imag_, points.data());
+    center_points_.fetch_add(count, std::memory_order_relaxed);
+
+    const ColorPalette& palette = ColorPalette::forParams(params_);
+    double lut_scale = ColorPalette::lutScale(params_);
+    double lut_offset = ColorPalette::lutOffset(params_);
+    for (int i = 0; i < count; i++) {
+        storeColor(palette, params_, lut_scale, lut_offset, points[i],
+                   frame + center_pixels[i] * 4);
+    }
+}
+
+} // namespace fractal
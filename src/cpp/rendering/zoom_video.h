@@ -0,0 +1,155 @@
+#ifndef ZOOM_VIDEO_H
+#define ZOOM_VIDEO_H
+
+#include "../core/fractal_engine.h"
+#include "render_scheduler.h"
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <vector>
+
+namespace fractal {
+
+// A constant-rate zoom about a fixed point: frame k is the first frame
+// zoomed k times by factor with ViewportManager::zoom at (focus_x, focus_y),
+// which holds the target point at that pixel.
+struct ZoomPath {
+    double target_real;
+    double target_imag;
+    double focus_x;      // Pixel the target stays at
+    double focus_y;
+    int width;
+    int height;
+    double start_scale;  // Units per pixel of frame 0
+    double factor;       // Scale ratio between consecutive frames, < 1 zooms in
+    int frame_count;
+
+    ZoomPath() : target_real(-0.5), target_imag(0.0), focus_x(400), focus_y(300), width(800),
+                 height(600), start_scale(0.004), factor(0.99), frame_count(1) {}
+
+    // The path replayed from start through ViewportManager::zoom
+    static ZoomPath fromViewport(const Viewport& start, double factor, int focus_x,
+                                 int focus_y, int frame_count);
+
+    double scaleAt(int frame) const;
+    Viewport frame(int frame) const;
+};
+
+// Renders the frames of a ZoomPath from one exponential map of the zoom
+// instead of rendering each frame: a log-polar strip about the target whose
+// row i is the ring of radius r_min * e^(i * delta) and whose columns are
+// angles delta apart (delta = 2 pi / columns, so cells are square). Every
+// frame is a window of rows in that strip, one ring row per zoom step of
+// e^delta, so each ring is computed once for the whole video and frames are
+// resampled from it. Only a disc of center_radius pixels around the target,
+// where the rings would shrink without bound, is computed directly per
+// frame.
+//
+// The strip has columns = 2 pi * (distance from the focus to the farthest
+// corner) * density, one ring cell per pixel at the frame's edge, so the
+// work is about 2 pi * rho_max^2 * density^2 points per e-fold of zoom
+// (~3.7 frames' worth at 16:9), however many frames cover it. Rows are
+// computed in chunks as frames need them and dropped once the zoom has
+// passed them, so memory holds about one frame's window of rows (and a
+// third more for their filtered levels).
+class ZoomVideoRenderer {
+public:
+    // center_radius <= 0 picks rho_max / 32 (at least 8 pixels)
+    ZoomVideoRenderer(RenderScheduler& scheduler, const FractalEngine& engine,
+                      const ZoomPath& path, const RenderParams& params, FractalType type,
+                      double julia_c_real, double julia_c_imag, double density = 1.0,
+                      double center_radius = 0.0);
+
+    ZoomVideoRenderer(const ZoomVideoRenderer&) = delete;
+    ZoomVideoRenderer& operator=(const ZoomVideoRenderer&) = delete;
+
+    // Frame `index` as path.width x path.height RGBA. Frames are cheapest
+    // in path order; going back recomputes the rows dropped since.
+    void renderFrame(int index, std::vector<uint8_t>& frame_buffer);
+
+    int columns() const { return columns_; }
+    int stripRows() const { return rows_; }
+    double centerRadius() const { return center_radius_; }
+
+    // Points iterated so far (strip rings and center discs)
+    uint64_t pointsComputed() const { return strip_points_ + center_points_.load(); }
+    uint64_t stripPoints() const { return strip_points_; }
+    uint64_t centerPoints() const { return center_points_.load(); }
+
+    // Bytes of strip rows currently held
+    size_t stripBytes() const;
+
+private:
+    // Strip rows are held in chunks of kChunkRows. A chunk also keeps
+    // kLevels - 1 box-filtered copies, each halving the rows and columns of
+    // the last: inner rings are iterated far more finely than the pixels
+    // they land on, so frames sample the level whose cells are about a
+    // pixel wide, which antialiases them and keeps the reads to a few
+    // cells per pixel. Each level is stored in blocks of kBlockColumns
+    // columns by all of its rows, since a frame row crosses a strip row at
+    // nearly every pixel.
+    static constexpr int kChunkRows = 32;
+    static constexpr int kLevels = 6;
+    static constexpr int kBlockColumns = 8;
+    static constexpr int kTaskColumns = 256;
+
+    // Byte offset of a cell within its chunk
+    size_t cellOffset(int level, int chunk_row, int column) const {
+        return level_offsets_[level] +
+               ((static_cast<size_t>(column / kBlockColumns) * (kChunkRows >> level) +
+                 chunk_row) * kBlockColumns + column % kBlockColumns) * 4;
+    }
+
+    // Strip rows frame index samples, inclusive
+    void rowWindow(int index, int& first, int& last) const;
+
+    // Compute the chunks covering rows [first, last] not already held, and
+    // drop the ones outside that range
+    void prepareRows(int first, int last);
+
+    void computeStripTile(const Tile& tile);
+
+    // strip_rows[level] holds where each of the level's rows from
+    // first_rows[level] on starts
+    void composeRows(const Tile& rows, int index,
+                     const std::vector<const uint8_t*> (&strip_rows)[kLevels],
+                     const int (&first_rows)[kLevels], uint8_t* frame);
+
+    RenderScheduler& scheduler_;
+    const FractalEngine& engine_;
+    ZoomPath path_;
+    RenderParams params_;
+    FractalType type_;
+    double julia_c_real_;
+    double julia_c_imag_;
+
+    double center_radius_;  // Pixels
+    double max_radius_;     // Pixels, focus to the farthest corner
+    int columns_;
+    int rows_;
+    double delta_;          // Log-radius and angle step
+    double min_radius_;     // Plane units, radius of row 0
+
+    // Where each frame pixel samples its level: the row in level cells
+    // relative to the row of radius one pixel, and the byte offsets within
+    // a row of the two columns it blends. Only the row moves between frames.
+    // level < 0 marks the center disc.
+    struct PolarPixel {
+        float row;
+        int16_t level;
+        uint16_t column_weight;  // Toward right, of 256
+        uint32_t left;
+        uint32_t right;
+    };
+
+    std::vector<double> cos_, sin_;  // Per column
+    std::vector<PolarPixel> polar_;
+    size_t level_offsets_[kLevels + 1];  // Last is the chunk size
+    std::map<int, std::vector<uint8_t>> chunks_;  // RGBA cells of all levels by chunk index
+    uint64_t strip_points_;
+    std::atomic<uint64_t> center_points_;
+};
+
+} // namespace fractal
+
+#endif // ZOOM_VIDEO_H
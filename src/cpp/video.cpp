@@ -0,0 +1,192 @@
+/**
+ * Fractal Explorer - Zoom video renderer
+ *
+ * Renders the frames of a constant-rate zoom (what replaying keyframes
+ * through ViewportManager::zoom produces) from one exponential map of the
+ * path, so each ring of the zoom is iterated once rather than in every
+ * frame:
+ *
+ *   fractal_video --output PATTERN [--width W] [--height H] [--center X Y]
+ *                 [--span S] [--focus FX FY] [--frames N]
+ *                 [--factor F | --end-span S] [--iterations N]
+ *                 [--type NAME | --julia CR CI] [--palette ID] [--density D]
+ *                 [--center-radius R] [--threads N] [--direct]
+ *
+ * --center and --span give frame 0; --focus is the pixel held fixed (the
+ * frame center by default); --type is as for fractal_render. PATTERN is a
+ * printf pattern such as frames/%05d.png (or .ppm, .tif), or - for raw
+ * rgb24 on stdout, e.g.
+ *
+ *   fractal_video --output - ... | ffmpeg -f rawvideo -pix_fmt rgb24 \
+ *       -s 1920x1080 -r 60 -i - zoom.mp4
+ *
+ * --direct renders every frame in full instead, for comparison.
+ */
+
+#include "core/fractal_engine.h"
+#include "core/fractal_family.h"
+#include "io/image_writer.h"
+#include "rendering/render_scheduler.h"
+#include "rendering/tile_manager.h"
+#include "rendering/zoom_video.h"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace {
+
+void usage() {
+    std::cerr << "usage: fractal_video --output PATTERN [--width W] [--height H]\n"
+              << "                     [--center X Y] [--span S] [--focus FX FY]\n"
+              << "                     [--frames N] [--factor F | --end-span S]\n"
+              << "                     [--iterations N] [--type NAME | --julia CR CI]\n"
+              << "                     [--palette ID] [--density D] [--center-radius R]\n"
+              << "                     [--threads N] [--direct]" << std::endl;
+}
+
+bool writeFrame(const std::string& pattern, int index, const std::vector<uint8_t>& frame,
+                int width, int height) {
+    if (pattern == "-") {
+        std::vector<uint8_t> rgb(static_cast<size_t>(width) * height * 3);
+        for (size_t i = 0; i < rgb.size() / 3; i++) {
+            rgb[i * 3] = frame[i * 4];
+            rgb[i * 3 + 1] = frame[i * 4 + 1];
+            rgb[i * 3 + 2] = frame[i * 4 + 2];
+        }
+        return std::fwrite(rgb.data(), 1, rgb.size(), stdout) == rgb.size();
+    }
+
+    std::vector<char> path(pattern.size() + 32);
+    std::snprintf(path.data(), path.size(), pattern.c_str(), index);
+    fractal::ImageWriter::Format format;
+    if (!fractal::ImageWriter::formatFromPath(path.data(), format)) {
+        return false;
+    }
+    std::unique_ptr<fractal::ImageWriter> image = fractal::ImageWriter::create(format);
+    return image && image->open(path.data(), width, height) &&
+           image->writeRows(frame.data(), height) && image->finish();
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    fractal::Viewport start(-0.5, 0.0, 0.0, 1920, 1080);
+    fractal::RenderParams params;
+    fractal::FractalType type = fractal::MANDELBROT;
+    double julia_c_real = 0.0, julia_c_imag = 0.0;
+    double span = 3.2, end_span = 0.0, factor = 0.99;
+    double density = 1.0, center_radius = 0.0;
+    int focus_x = -1, focus_y = -1;
+    int frames = 600;
+    int threads = 0;
+    bool direct = false;
+    std::string output;
+
+    for (int i = 1; i < argc; i++) {
+        int values = argc - i - 1;
+        if (!std::strcmp(argv[i], "--output") && values >= 1) {
+            output = argv[++i];
+        } else if (!std::strcmp(argv[i], "--width") && values >= 1) {
+            start.width = std::atoi(argv[++i]);
+        } else if (!std::strcmp(argv[i], "--height") && values >= 1) {
+            start.height = std::atoi(argv[++i]);
+        } else if (!std::strcmp(argv[i], "--center") && values >= 2) {
+            start.center_x = std::atof(argv[++i]);
+            start.center_y = std::atof(argv[++i]);
+        } else if (!std::strcmp(argv[i], "--span") && values >= 1) {
+            span = std::atof(argv[++i]);
+        } else if (!std::strcmp(argv[i], "--focus") && values >= 2) {
+            focus_x = std::atoi(argv[++i]);
+            focus_y = std::atoi(argv[++i]);
+        } else if (!std::strcmp(argv[i], "--frames") && values >= 1) {
+            frames = std::atoi(argv[++i]);
+        } else if (!std::strcmp(argv[i], "--factor") && values >= 1) {
+            factor = std::atof(argv[++i]);
+        } else if (!std::strcmp(argv[i], "--end-span") && values >= 1) {
+            end_span = std::atof(argv[++i]);
+        } else if (!std::strcmp(argv[i], "--iterations") && values >= 1) {
+            params.max_iterations = std::atoi(argv[++i]);
+        } else if (!std::strcmp(argv[i], "--type") && values >= 1) {
+            if (!fractal::fractalTypeFromName(argv[++i], type)) {
+                usage();
+                return 1;
+            }
+        } else if (!std::strcmp(argv[i], "--julia") && values >= 2) {
+            type = fractal::JULIA;
+            julia_c_real = std::atof(argv[++i]);
+            julia_c_imag = std::atof(argv[++i]);
+        } else if (!std::strcmp(argv[i], "--palette") && values >= 1) {
+            params.palette_id = std::atoi(argv[++i]);
+        } else if (!std::strcmp(argv[i], "--density") && values >= 1) {
+            density = std::atof(argv[++i]);
+        } else if (!std::strcmp(argv[i], "--center-radius") && values >= 1) {
+            center_radius = std::atof(argv[++i]);
+        } else if (!std::strcmp(argv[i], "--threads") && values >= 1) {
+            threads = std::atoi(argv[++i]);
+        } else if (!std::strcmp(argv[i], "--direct")) {
+            direct = true;
+        } else {
+            usage();
+            return 1;
+        }
+    }
+    if (output.empty() || start.width < 1 || start.height < 1 || !(span > 0.0) ||
+        frames < 1 || !(factor > 0.0) || !(density > 0.0) || params.max_iterations < 1) {
+        usage();
+        return 1;
+    }
+    start.scale = span / start.width;
+    if (end_span > 0.0 && frames > 1) {
+        factor = std::pow(end_span / span, 1.0 / (frames - 1));
+    }
+    if (focus_x < 0 || focus_y < 0) {
+        focus_x = start.width / 2;
+        focus_y = start.height / 2;
+    }
+
+    fractal::ZoomPath path = fractal::ZoomPath::fromViewport(start, factor, focus_x, focus_y,
+                                                             frames);
+    fractal::FractalEngine engine;
+    fractal::RenderScheduler scheduler(threads);
+    fractal::ZoomVideoRenderer video(scheduler, engine, path, params, type, julia_c_real,
+                                     julia_c_imag, density, center_radius);
+    std::vector<fractal::Tile> tiles = fractal::TileManager::generateTiles(start.width,
+                                                                           start.height);
+
+    auto begin = std::chrono::steady_clock::now();
+    std::vector<uint8_t> frame;
+    for (int index = 0; index < frames; index++) {
+        if (direct) {
+            fractal::Viewport viewport = path.frame(index);
+            scheduler.renderFrame(engine, tiles, viewport, params, type, julia_c_real,
+                                  julia_c_imag, frame);
+        } else {
+            video.renderFrame(index, frame);
+        }
+        if (!writeFrame(output, index, frame, start.width, start.height)) {
+            std::cerr << "\ncannot write frame " << index << " to " << output << std::endl;
+            return 1;
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin)
+                             .count();
+        std::cerr << "\rframe " << index + 1 << " / " << frames << ", " << seconds << " s"
+                  << std::flush;
+    }
+
+    double frame_pixels = static_cast<double>(start.width) * start.height;
+    std::cerr << "\n";
+    if (direct) {
+        std::cerr << "rendered " << frames << " frames directly" << std::endl;
+    } else {
+        std::cerr << "exponential map: " << video.columns() << " x " << video.stripRows()
+                  << " strip, " << video.stripPoints() / frame_pixels << " frames of strip + "
+                  << video.centerPoints() / frame_pixels << " of center discs for " << frames
+                  << " frames" << std::endl;
+    }
+    return 0;
+}
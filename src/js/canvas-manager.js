@@ -105,6 +105,12 @@ export class CanvasManager {
         }
     }
 
+    // Move the visible image by whole pixels (after a pan); the uncovered
+    // strips keep stale content until they are redrawn
+    shift(dx, dy) {
+        this.ctx.drawImage(this.canvas, dx, dy);
+    }
+
     getCanvas() {
         return this.canvas;
     }
@@ -4,6 +4,9 @@
 
 import { WebGPURenderer, OrbitTrapType } from './webgpu-renderer.js';
 
+// Subsample cap per edge pixel with anti-aliasing on
+const ANTIALIAS_SAMPLES = 16;
+
 export class HybridRenderer {
     constructor(wasmModule, canvasManager) {
         this.wasmModule = wasmModule;
@@ -28,6 +31,38 @@ export class HybridRenderer {
         this.colorCycleOffset = 0;
         this.colorCycleAnimating = false;
         this.colorCycleSpeed = 0.001;
+
+        // Tiles of the last completed full-resolution WASM frame and the
+        // workers holding their iteration data, for recolor()
+        this.lastFrame = null;
+
+        // Whether the canvas holds a complete full-resolution frame that a
+        // pan can shift, and the exposed tiles still waiting to be drawn
+        this.panReady = false;
+        this.pendingPanTiles = [];
+
+        // Iteration limit of the frame on the canvas, and a callback that
+        // receives the statistics behind an automatic limit
+        this.frameMaxIter = 0;
+        this.onAutoIterations = null;
+
+        // Whether workers keep the orbits of pixels stopped by the limit, so
+        // that raiseIterations() resumes them instead of restarting them.
+        // They cost 16 bytes per pixel, so callers only set this while they
+        // may raise the limit.
+        this.keepOrbits = false;
+
+        // Merged histogram behind the equalized colors on the canvas
+        // ({ counts, maxIter, id }), reused to color pan strips
+        this.frameHistogram = null;
+        this.histogramSerial = 0;
+
+        // Render counters summed over the last frame's tiles, when the
+        // module was built with FRACTAL_PROFILE (null otherwise)
+        this.frameStats = null;
+
+        // Trace events recorded on this thread while tracing, else null
+        this.trace = null;
     }
 
     async initialize(workerCount = 4) {
@@ -80,10 +115,17 @@ export class HybridRenderer {
         this.currentRenderID++;
         const renderID = this.currentRenderID;
         this.isRendering = true;
+        this.lastFrame = null;
+        this.panReady = false;
+        this.pendingPanTiles = [];
 
         // Clear canvas
         this.canvasManager.clear();
 
+        params = { ...params, maxIter: this.resolveIterations(viewport, params, mode, juliaParams) };
+        this.frameMaxIter = params.maxIter;
+        this.frameHistogram = null;
+
         try {
             if (this.useWebGPU) {
                 await this.renderWithWebGPU(viewport, params, mode, juliaParams, renderID);
@@ -99,6 +141,296 @@ export class HybridRenderer {
         }
     }
 
+    // Iteration limit for a render: an explicit maxIter (interaction
+    // previews), an estimate from a preview grid's escape statistics in auto
+    // mode, or the slider value
+    resolveIterations(viewport, params, mode, juliaParams) {
+        if (params.maxIter) {
+            return params.maxIter;
+        }
+        if (params.autoIterations && this.wasmModule.autoIterations) {
+            const estimate = this.wasmModule.autoIterations(
+                viewport.centerX,
+                viewport.centerY,
+                viewport.scale,
+                viewport.width,
+                viewport.height,
+                mode === 'julia' ? 1 : 0,
+                juliaParams?.cReal || 0,
+                juliaParams?.cImag || 0,
+                0,
+                0
+            );
+            this.onAutoIterations?.(estimate);
+            return estimate.maxIterations;
+        }
+        return params.maxIterations || 1000;
+    }
+
+    // Apply a palette or color offset change to the last completed frame.
+    // The WASM workers kept each tile's iteration data, so this is a memory
+    // pass per tile; anything else falls back to a full render.
+    async recolor(viewport, params, mode, juliaParams) {
+        const frame = this.lastFrame;
+        if (this.useWebGPU || this.isRendering || !frame) {
+            return this.startRender(viewport, params, mode, juliaParams);
+        }
+
+        this.currentRenderID++;
+        const renderID = this.currentRenderID;
+
+        // Equalizing a linearly colored frame needs its histogram first
+        if (params.equalize && !frame.histogram) {
+            const histograms = await this.workerPool.tileHistograms(frame.tiles, {
+                params: { maxIter: frame.maxIter },
+                renderID
+            });
+            if (renderID !== this.currentRenderID) return;
+            frame.histogram = this.mergeHistograms(histograms, frame.maxIter);
+            if (!frame.histogram) {
+                return this.startRender(viewport, params, mode, juliaParams);
+            }
+        }
+
+        const histogram = params.equalize ? frame.histogram : null;
+        const results = await this.workerPool.recolorTiles(frame.tiles, {
+            viewport: frame.viewport,
+            params: {
+                maxIter: frame.maxIter,
+                ...frame.fractal,
+                paletteID: params.paletteID || 0,
+                colorOffset: this.colorCycleOffset,
+                ...this.histogramParams(histogram)
+            },
+            renderID
+        });
+
+        if (renderID !== this.currentRenderID) return;
+        this.frameHistogram = histogram;
+
+        if (results.some(result => !result || !result.pixelData)) {
+            // A worker no longer holds its tiles
+            return this.startRender(viewport, params, mode, juliaParams);
+        }
+
+        for (const result of results) {
+            const imageData = new ImageData(
+                new Uint8ClampedArray(result.pixelData),
+                result.tile.width,
+                result.tile.height
+            );
+            this.canvasManager.drawImageData(imageData, result.tile.x, result.tile.y);
+        }
+    }
+
+    // Raise the iteration limit of the last completed frame. The WASM
+    // workers kept its iteration data, so only pixels stopped by the old
+    // limit are iterated further (from their orbits with keepOrbits);
+    // anything else falls back to a full render.
+    async raiseIterations(viewport, params, mode, juliaParams) {
+        const frame = this.lastFrame;
+        const maxIter = params.maxIter || params.maxIterations || 1000;
+        if (this.useWebGPU || this.isRendering || !frame || maxIter < frame.maxIter) {
+            return this.startRender(viewport, params, mode, juliaParams);
+        }
+
+        this.currentRenderID++;
+        const renderID = this.currentRenderID;
+        this.isRendering = true;
+
+        const results = await this.workerPool.continueTiles(frame.tiles, {
+            viewport,
+            params: {
+                maxIter,
+                fractalType: mode === 'julia' ? 1 : 0,
+                juliaCReal: juliaParams?.cReal || 0,
+                juliaCImag: juliaParams?.cImag || 0,
+                paletteID: params.paletteID || 0,
+                equalize: !!params.equalize,
+                keepOrbits: this.keepOrbits,
+                ...this.histogramParams(frame.histogram)
+            },
+            renderID
+        });
+
+        if (renderID !== this.currentRenderID) return;
+        this.isRendering = false;
+
+        if (results.some(result => !result || !result.pixelData)) {
+            // A worker no longer holds its tiles
+            return this.startRender(viewport, params, mode, juliaParams);
+        }
+
+        for (const result of results) {
+            const imageData = new ImageData(
+                new Uint8ClampedArray(result.pixelData),
+                result.tile.width,
+                result.tile.height
+            );
+            this.canvasManager.drawImageData(imageData, result.tile.x, result.tile.y);
+        }
+        frame.maxIter = maxIter;
+        this.frameMaxIter = maxIter;
+        this.frameStats = this.mergeStats(results, null);
+
+        // The new limit moves the distribution: recolor through its histogram
+        frame.histogram = params.equalize ? this.mergeHistograms(results, maxIter) : null;
+        if (frame.histogram) {
+            await this.equalizeFrame(frame, params, renderID);
+        }
+    }
+
+    // Recolor a finished frame through its merged histogram: a memory pass
+    // per tile on the workers holding the tiles
+    async equalizeFrame(frame, params, renderID) {
+        const results = await this.workerPool.recolorTiles(frame.tiles, {
+            viewport: frame.viewport,
+            params: {
+                maxIter: frame.maxIter,
+                ...frame.fractal,
+                paletteID: params.paletteID || 0,
+                colorOffset: this.colorCycleOffset,
+                ...this.histogramParams(frame.histogram)
+            },
+            renderID
+        });
+
+        if (renderID !== this.currentRenderID) return;
+
+        for (const result of results) {
+            if (result && result.pixelData) {
+                const imageData = new ImageData(
+                    new Uint8ClampedArray(result.pixelData),
+                    result.tile.width,
+                    result.tile.height
+                );
+                this.canvasManager.drawImageData(imageData, result.tile.x, result.tile.y);
+            }
+        }
+        this.frameHistogram = frame.histogram;
+    }
+
+    // Sum the tile histograms in results into a frame histogram, or null
+    // if none came back
+    mergeHistograms(results, maxIter) {
+        let counts = null;
+        for (const result of results) {
+            if (!result || !result.histogram) continue;
+            const tileCounts = result.histogram;
+            if (!counts) {
+                counts = new Uint32Array(tileCounts.length);
+            }
+            for (let i = 0; i < counts.length; i++) {
+                counts[i] += tileCounts[i];
+            }
+        }
+        return counts ? { counts, maxIter, id: ++this.histogramSerial } : null;
+    }
+
+    // Add the tile counters in results to stats (or to a new total); null
+    // if there are none
+    mergeStats(results, stats) {
+        for (const result of results) {
+            if (!result || !result.stats) continue;
+            if (!stats) {
+                stats = { ...result.stats, escapeHistogram: [...result.stats.escapeHistogram] };
+                continue;
+            }
+            for (const key of Object.keys(stats)) {
+                if (key === 'escapeHistogram') {
+                    result.stats.escapeHistogram.forEach((count, bin) => {
+                        stats.escapeHistogram[bin] += count;
+                    });
+                } else {
+                    stats[key] += result.stats[key];
+                }
+            }
+        }
+        return stats;
+    }
+
+    // Worker params that color through a frame histogram (none: linear)
+    histogramParams(histogram) {
+        if (!histogram) return {};
+        return {
+            colorHistogram: histogram.counts,
+            colorHistogramMaxIter: histogram.maxIter,
+            colorHistogramID: histogram.id
+        };
+    }
+
+    // Pan by whole pixels: shift the image already on screen and render only
+    // the strips the move exposed. Strips still pending from an interrupted
+    // pan are shifted along and rendered too. Anything that cannot be
+    // shifted falls back to a full render.
+    async renderPan(viewport, params, mode, juliaParams, dx, dy) {
+        if (this.useWebGPU || !this.panReady || !this.wasmModule.getExposedRects ||
+            Math.abs(dx) >= viewport.width || Math.abs(dy) >= viewport.height) {
+            return this.startRender(viewport, params, mode, juliaParams);
+        }
+
+        this.currentRenderID++;
+        const renderID = this.currentRenderID;
+        this.isRendering = true;
+        this.lastFrame = null;  // Worker iteration data no longer lines up
+
+        this.canvasManager.shift(dx, dy);
+
+        const tileSize = 64;
+        const tiles = [];
+        for (const tile of this.pendingPanTiles) {
+            const x = Math.max(tile.x + dx, 0);
+            const y = Math.max(tile.y + dy, 0);
+            const right = Math.min(tile.x + dx + tile.width, viewport.width);
+            const bottom = Math.min(tile.y + dy + tile.height, viewport.height);
+            if (right > x && bottom > y) {
+                tiles.push({ x, y, width: right - x, height: bottom - y });
+            }
+        }
+        for (const rect of this.wasmModule.getExposedRects(viewport.width, viewport.height, dx, dy)) {
+            for (let y = rect.y; y < rect.y + rect.height; y += tileSize) {
+                for (let x = rect.x; x < rect.x + rect.width; x += tileSize) {
+                    tiles.push({
+                        x,
+                        y,
+                        width: Math.min(tileSize, rect.x + rect.width - x),
+                        height: Math.min(tileSize, rect.y + rect.height - y)
+                    });
+                }
+            }
+        }
+        this.pendingPanTiles = tiles;
+
+        const results = await this.workerPool.renderTiles(tiles, {
+            viewport,
+            params: {
+                maxIter: this.frameMaxIter || params.maxIter || 1000,
+                fractalType: mode === 'julia' ? 1 : 0,
+                juliaCReal: juliaParams?.cReal || 0,
+                juliaCImag: juliaParams?.cImag || 0,
+                paletteID: params.paletteID || 0,
+                ...this.histogramParams(this.frameHistogram)
+            },
+            renderID
+        });
+
+        if (renderID !== this.currentRenderID) return;
+
+        for (const result of results) {
+            if (result && result.pixelData) {
+                const imageData = new ImageData(
+                    new Uint8ClampedArray(result.pixelData),
+                    result.tile.width,
+                    result.tile.height
+                );
+                this.canvasManager.drawImageData(imageData, result.tile.x, result.tile.y);
+            }
+        }
+
+        this.pendingPanTiles = [];
+        this.isRendering = false;
+    }
+
     async renderWithWebGPU(viewport, params, mode, juliaParams, renderID) {
         const startTime = performance.now();
 
@@ -127,42 +459,59 @@ export class HybridRenderer {
     }
 
     async renderWithWASM(viewport, params, mode, juliaParams, renderID) {
-        // Progressive rendering with WASM (same as before)
-        const passes = [
-            { scale: 0.25, maxIter: 100, name: 'preview' },
-            { scale: 0.5, maxIter: 200, name: 'low' },
-            { scale: 0.75, maxIter: 500, name: 'medium' },
-            { scale: 1.0, maxIter: params.maxIter || 1000, name: 'high' }
-        ];
-
-        for (const pass of passes) {
+        // Nested progressive passes (1/8, 1/4, 1/2, full resolution): each
+        // pass's sample grid contains the previous one, so a pass only
+        // computes its new samples and continues the earlier ones on the
+        // worker that holds them. The kernels do about the work of one
+        // render (double-double samples restart from z = 0 each pass), but
+        // coloring each pass and keeping the iteration field make the four
+        // passes cost about 1.3x one full-resolution render (fractal_native,
+        // 800x600).
+        //
+        // With equalized colors every tile returns its histogram; each pass
+        // is colored through the merged histogram of the pass before, so no
+        // tile waits for the rest of its own pass, and the finished frame is
+        // recolored through its own.
+        const frameStart = this.traceNow();
+        const baseIter = params.maxIter || 1000;
+        const tiles = this.generateTiles(viewport.width, viewport.height, 64);
+        this.traceSpan('generateTiles', frameStart, { tiles: tiles.length });
+        let owners = null;  // { tile, workerID } from the first pass
+        let histogram = null;
+        let extraSamples = 0;
+        let stats = null;
+
+        for (let pass = 0; pass < 4; pass++) {
             if (renderID !== this.currentRenderID) return;
 
-            const passWidth = Math.ceil(viewport.width * pass.scale);
-            const passHeight = Math.ceil(viewport.height * pass.scale);
-
-            const tiles = this.generateTiles(passWidth, passHeight, 64);
-
-            const results = await this.workerPool.renderTiles(tiles, {
-                viewport: {
-                    ...viewport,
-                    width: passWidth,
-                    height: passHeight,
-                    scale: viewport.scale / pass.scale
-                },
+            const passStart = this.traceNow();
+            const passParams = this.wasmModule.getPassParams(pass, baseIter);
+            const config = {
+                viewport,
                 params: {
-                    maxIter: pass.maxIter,
+                    maxIter: passParams.maxIterations,
                     fractalType: mode === 'julia' ? 1 : 0,
                     juliaCReal: juliaParams?.cReal || 0,
                     juliaCImag: juliaParams?.cImag || 0,
-                    paletteID: params.paletteID || 0
+                    paletteID: params.paletteID || 0,
+                    sampleStep: passParams.sampleStep,
+                    previousSampleStep: passParams.previousSampleStep,
+                    equalize: !!params.equalize,
+                    antialias: params.antialias ? ANTIALIAS_SAMPLES : 1,
+                    keepOrbits: this.keepOrbits,
+                    ...this.histogramParams(histogram)
                 },
                 renderID
-            });
+            };
+
+            const results = owners ?
+                await this.workerPool.renderTilesOnOwners(owners, config) :
+                await this.workerPool.renderTiles(tiles, config);
 
             if (renderID !== this.currentRenderID) return;
 
-            // Composite tiles
+            // Composite tiles (already full resolution, coarse samples
+            // filling their blocks)
             for (const result of results) {
                 if (result && result.pixelData) {
                     const imageData = new ImageData(
@@ -170,22 +519,100 @@ export class HybridRenderer {
                         result.tile.width,
                         result.tile.height
                     );
-
-                    // Scale up for lower resolution passes
-                    const scaleX = viewport.width / passWidth;
-                    const scaleY = viewport.height / passHeight;
-
-                    this.canvasManager.drawImageData(
-                        imageData,
-                        result.tile.x * scaleX,
-                        result.tile.y * scaleY,
-                        result.tile.width * scaleX,
-                        result.tile.height * scaleY,
-                        pass.scale < 1.0  // Use nearest neighbor for low-res
-                    );
+                    this.canvasManager.drawImageData(imageData, result.tile.x, result.tile.y);
+                    extraSamples += result.extraSamples || 0;
                 }
             }
+
+            stats = this.mergeStats(results, stats);
+
+            owners = results.filter(result => result).map(result => ({
+                tile: result.tile,
+                workerID: result.workerID
+            }));
+            if (params.equalize) {
+                histogram = this.mergeHistograms(results, passParams.maxIterations) || histogram;
+            }
+            this.traceSpan('pass', passStart, {
+                step: passParams.sampleStep,
+                maxIterations: passParams.maxIterations,
+                tiles: results.length
+            });
+        }
+
+        if (extraSamples) {
+            const pixels = viewport.width * viewport.height;
+            console.log(`Anti-aliasing: ${(extraSamples / pixels).toFixed(2)} extra samples/pixel`);
+        }
+        this.frameStats = stats;
+        if (stats) {
+            console.log(`Render counters: ${stats.iterations} iterations, ` +
+                `${stats.bulbSkipped} cardioid/bulb, ${stats.periodic} periodic, ` +
+                `${stats.escaped} escaped, ${stats.limitReached} at the limit, ` +
+                `iterate ${stats.iterateMs.toFixed(1)}ms, color ${stats.colorMs.toFixed(1)}ms`);
+        }
+
+        // The view is kept so that recolors only take tiles rendered for it
+        this.lastFrame = {
+            tiles: owners,
+            maxIter: baseIter,
+            histogram,
+            viewport,
+            fractal: {
+                fractalType: mode === 'julia' ? 1 : 0,
+                juliaCReal: juliaParams?.cReal || 0,
+                juliaCImag: juliaParams?.cImag || 0
+            }
+        };
+        if (histogram) {
+            await this.equalizeFrame(this.lastFrame, params, renderID);
+            if (renderID !== this.currentRenderID) return;
         }
+        this.traceSpan('frame', frameStart, { width: viewport.width, height: viewport.height });
+        this.panReady = true;
+    }
+
+    // Record a Chrome trace-event timeline of the WASM pipeline: frame and
+    // pass spans from this thread, tile spans (with tile coordinates) from
+    // every worker. stopTrace() resolves to the JSON for chrome://tracing or
+    // Perfetto.
+    startTrace() {
+        this.trace = [];
+        if (this.workerPool) {
+            this.workerPool.startTrace();
+        }
+    }
+
+    async stopTrace() {
+        const events = this.trace || [];
+        this.trace = null;
+        const workerEvents = this.workerPool ? await this.workerPool.stopTrace() : [];
+        const threadName = {
+            name: 'thread_name', ph: 'M', pid: 1, tid: 0, args: { name: 'main' }
+        };
+        return JSON.stringify({
+            traceEvents: [threadName, ...events, ...workerEvents],
+            displayTimeUnit: 'ms'
+        });
+    }
+
+    // Microseconds since the epoch, the clock every trace event uses
+    traceNow() {
+        return (performance.timeOrigin + performance.now()) * 1000;
+    }
+
+    traceSpan(name, start, args = {}) {
+        if (!this.trace) return;
+        this.trace.push({
+            name,
+            cat: 'frame',
+            ph: 'X',
+            pid: 1,
+            tid: 0,
+            ts: start,
+            dur: this.traceNow() - start,
+            args
+        });
     }
 
     generateTiles(width, height, tileSize) {
@@ -299,26 +726,72 @@ class WorkerPool {
 
     renderTile(tile, config) {
         return new Promise((resolve) => {
-            const job = { tile, config, resolve };
+            const job = { type: 'RENDER_TILE', tile, config, resolve };
             this.queue.push(job);
             this.processQueue();
         });
     }
 
+    // Recolor tiles on the workers that rendered them ({ tile, workerID })
+    async recolorTiles(entries, config) {
+        return this.runOnOwners('RECOLOR_TILE', entries, config);
+    }
+
+    // Render tiles on the workers that rendered their earlier passes
+    async renderTilesOnOwners(entries, config) {
+        return this.runOnOwners('RENDER_TILE', entries, config);
+    }
+
+    // Continue tiles to a higher iteration limit on the workers holding
+    // their orbits ({ tile, workerID })
+    async continueTiles(entries, config) {
+        return this.runOnOwners('CONTINUE_TILE', entries, config);
+    }
+
+    // Histograms of tiles on the workers holding their iteration data
+    async tileHistograms(entries, config) {
+        return this.runOnOwners('HISTOGRAM_TILE', entries, config);
+    }
+
+    runOnOwners(type, entries, config) {
+        return Promise.all(entries.map(entry => new Promise((resolve) => {
+            const job = {
+                type,
+                tile: entry.tile,
+                workerID: entry.workerID,
+                config,
+                resolve
+            };
+            this.queue.push(job);
+            this.processQueue();
+        })));
+    }
+
     processQueue() {
-        if (this.queue.length === 0) return;
+        for (const workerInfo of this.workers) {
+            if (this.queue.length === 0) return;
+            if (workerInfo.busy) continue;
 
-        const availableWorker = this.workers.find(w => !w.busy);
-        if (!availableWorker) return;
+            // Recolor/continue jobs must go to the worker holding the tile's data
+            const index = this.queue.findIndex(job =>
+                job.workerID === undefined || job.workerID === workerInfo.id);
+            if (index < 0) continue;
 
-        const job = this.queue.shift();
+            const job = this.queue.splice(index, 1)[0];
+            this.dispatch(workerInfo, job);
+        }
+    }
+
+    dispatch(availableWorker, job) {
         availableWorker.busy = true;
 
         const messageHandler = (e) => {
             if (e.data.type === 'TILE_COMPLETE') {
                 availableWorker.worker.removeEventListener('message', messageHandler);
                 availableWorker.busy = false;
-                job.resolve(e.data.data);
+                const result = e.data.data;
+                result.workerID = availableWorker.id;
+                job.resolve(result);
                 this.processQueue();
             } else if (e.data.type === 'ERROR') {
                 availableWorker.worker.removeEventListener('message', messageHandler);
@@ -330,7 +803,7 @@ class WorkerPool {
 
         availableWorker.worker.addEventListener('message', messageHandler);
         availableWorker.worker.postMessage({
-            type: 'RENDER_TILE',
+            type: job.type,
             data: {
                 tile: job.tile,
                 viewport: job.config.viewport,
@@ -340,6 +813,29 @@ class WorkerPool {
         });
     }
 
+    startTrace() {
+        for (const workerInfo of this.workers) {
+            workerInfo.worker.postMessage({
+                type: 'TRACE_START',
+                data: { workerID: workerInfo.id }
+            });
+        }
+    }
+
+    // Every worker's trace events, merged
+    async stopTrace() {
+        const lists = await Promise.all(this.workers.map(workerInfo => new Promise((resolve) => {
+            const handler = (e) => {
+                if (e.data.type !== 'TRACE_DATA') return;
+                workerInfo.worker.removeEventListener('message', handler);
+                resolve(e.data.data.events);
+            };
+            workerInfo.worker.addEventListener('message', handler);
+            workerInfo.worker.postMessage({ type: 'TRACE_STOP' });
+        })));
+        return lists.flat();
+    }
+
     terminate() {
         for (const workerInfo of this.workers) {
             workerInfo.worker.terminate();
@@ -266,6 +266,11 @@ export class InteractionHandler {
     pan(dx, dy) {
         const viewport = this.state.getViewport();
 
+        // Whole pixels, so the previous frame can be shifted and reused
+        dx = Math.round(dx);
+        dy = Math.round(dy);
+        if (dx === 0 && dy === 0) return;
+
         // Convert pixel delta to complex delta
         const newCenterX = viewport.centerX - dx * viewport.scale;
         const newCenterY = viewport.centerY - dy * viewport.scale;
@@ -276,7 +281,14 @@ export class InteractionHandler {
             centerY: newCenterY
         });
 
-        this.triggerRender();
+        if (this.renderer.renderPan) {
+            const params = this.state.getRenderParams();
+            const mode = this.state.getMode();
+            const juliaParams = this.state.getJuliaParams();
+            this.renderer.renderPan(this.state.getViewport(), params, mode, juliaParams, dx, dy);
+        } else {
+            this.triggerRender();
+        }
     }
 
     triggerRender() {
@@ -44,11 +44,11 @@ export class RendererManager {
                 break; // Cancelled
             }
 
-            // Get adaptive iteration count for this pass
-            const maxIter = this.wasmModule.getAdaptiveIterations(
+            // Iteration limit for this pass
+            const maxIter = this.wasmModule.getPassParams(
                 passInfo.pass,
                 params.maxIterations
-            );
+            ).maxIterations;
 
             await this.renderPass(viewport, {
                 ...params,
@@ -104,6 +104,9 @@ export class RendererManager {
                     this.canvasManager.requestFlip();
                 }
             }
+
+            // Hand the pixel buffer back to its worker for reuse
+            this.workerPool.recycle(result);
         }
 
         // Final flip after pass complete
@@ -220,7 +223,9 @@ class WorkerPool {
                     availableWorker.worker.removeEventListener('message', messageHandler);
                     availableWorker.busy = false;
                     this.activeJobs--;
-                    job.resolve(e.data.data);
+                    const result = e.data.data;
+                    result.workerID = availableWorker.id;
+                    job.resolve(result);
                     this.processQueue(); // Process next job
                 } else if (e.data.type === 'ERROR') {
                     availableWorker.worker.removeEventListener('message', messageHandler);
@@ -236,6 +241,20 @@ class WorkerPool {
         }
     }
 
+    recycle(result) {
+        if (!result || !result.pixelData || result.workerID === undefined) {
+            return;
+        }
+        const workerInfo = this.workers[result.workerID];
+        if (workerInfo) {
+            workerInfo.worker.postMessage({
+                type: 'RECYCLE_BUFFER',
+                data: { buffer: result.pixelData }
+            }, [result.pixelData]);
+        }
+        result.pixelData = null;
+    }
+
     terminate() {
         this.workers.forEach(workerInfo => {
             workerInfo.worker.terminate();
@@ -17,7 +17,10 @@ export class StateManager {
                 maxIterations: 1000,
                 bailoutRadius: 4.0,
                 smoothColoring: true,
-                paletteID: 0
+                paletteID: 0,
+                autoIterations: false,
+                equalize: false,
+                antialias: false
             },
             juliaParams: {
                 cReal: -0.7,
@@ -57,18 +57,54 @@ export class UIController {
             this.triggerRender();
         });
 
-        // Max iterations slider
+        // Max iterations slider, and the automatic limit from a preview
+        // grid's escape statistics
         const maxIterations = document.getElementById('max-iterations');
+        const autoIterations = document.getElementById('auto-iterations-toggle');
         maxIterations?.addEventListener('input', (e) => {
+            // A hand-picked limit ends auto mode
+            if (autoIterations?.checked) {
+                autoIterations.checked = false;
+                this.state.setRenderParams({ autoIterations: false });
+            }
             this.state.setMaxIterations(parseInt(e.target.value));
             document.getElementById('iterations-value').textContent = e.target.value;
+            this.triggerIterationChange();
+        });
+
+        // Frames rendered while the slider is in use keep their unfinished
+        // orbits, so raising the limit resumes them
+        maxIterations?.addEventListener('focus', () => {
+            this.renderer.keepOrbits = true;
+        });
+        maxIterations?.addEventListener('blur', () => {
+            this.renderer.keepOrbits = false;
+        });
+
+        autoIterations?.addEventListener('change', (e) => {
+            this.state.setRenderParams({ autoIterations: e.target.checked });
             this.triggerRender();
         });
+        this.renderer.onAutoIterations = (estimate) => this.showAutoIterations(estimate);
 
         // Color palette selector
         const paletteSelector = document.getElementById('palette-selector');
         paletteSelector?.addEventListener('change', (e) => {
             this.state.setPaletteID(parseInt(e.target.value));
+            this.triggerRecolor();
+        });
+
+        // Histogram-equalized coloring, applied to the retained iteration data
+        const equalizeToggle = document.getElementById('equalize-toggle');
+        equalizeToggle?.addEventListener('change', (e) => {
+            this.state.setRenderParams({ equalize: e.target.checked });
+            this.triggerRecolor();
+        });
+
+        // Adaptive supersampling of edge pixels (needs a re-render)
+        const antialiasToggle = document.getElementById('antialias-toggle');
+        antialiasToggle?.addEventListener('change', (e) => {
+            this.state.setRenderParams({ antialias: e.target.checked });
             this.triggerRender();
         });
 
@@ -131,6 +167,52 @@ export class UIController {
         this.renderer.startRender(viewport, params, mode, juliaParams);
     }
 
+    // Palette changes only need the last frame recolored, not recomputed
+    triggerRecolor() {
+        if (!this.renderer.recolor) {
+            this.triggerRender();
+            return;
+        }
+
+        const viewport = this.state.getViewport();
+        const params = this.state.getRenderParams();
+        const mode = this.state.getMode();
+        const juliaParams = this.state.getJuliaParams();
+
+        this.renderer.recolor(viewport, params, mode, juliaParams);
+    }
+
+    // A higher iteration limit continues the last frame's unfinished orbits
+    triggerIterationChange() {
+        if (!this.renderer.raiseIterations) {
+            this.triggerRender();
+            return;
+        }
+
+        const viewport = this.state.getViewport();
+        const params = this.state.getRenderParams();
+        const mode = this.state.getMode();
+        const juliaParams = this.state.getJuliaParams();
+
+        this.renderer.raiseIterations(viewport, params, mode, juliaParams);
+    }
+
+    // Reflect an automatically chosen limit in the slider, so turning auto
+    // mode off keeps it
+    showAutoIterations(estimate) {
+        this.state.setMaxIterations(estimate.maxIterations);
+
+        const slider = document.getElementById('max-iterations');
+        if (slider) {
+            slider.value = estimate.maxIterations;
+        }
+        const value = document.getElementById('iterations-value');
+        if (value) {
+            const resolved = (estimate.resolvedFraction * 100).toFixed(1);
+            value.textContent = `${estimate.maxIterations} (auto, ${resolved}% resolved)`;
+        }
+    }
+
     saveImage() {
         const canvas = document.getElementById('main-canvas');
         const dataURL = canvas.toDataURL('image/png');
@@ -27,9 +27,37 @@ export async function initWASM() {
 
         return {
             renderTile: module.renderTile,
+            renderTileDeep: module.renderTileDeep,
+            renderTileInto: module.renderTileInto,
+            renderTileDeepInto: module.renderTileDeepInto,
+            recolorTileInto: module.recolorTileInto,
+            continueTileInto: module.continueTileInto,
+            renderPassInto: module.renderPassInto,
+            setKeepOrbits: module.setKeepOrbits,
+            renderTileCachedInto: module.renderTileCachedInto,
+            setTileCacheBudget: module.setTileCacheBudget,
+            getTileCacheStats: module.getTileCacheStats,
+            acquireTileBuffer: module.acquireTileBuffer,
+            releaseTileBuffer: module.releaseTileBuffer,
             screenToComplex: module.screenToComplex,
-            getAdaptiveIterations: module.getAdaptiveIterations,
+            getPassParams: module.getPassParams,
+            autoIterations: module.autoIterations,
             generateTiles: module.generateTiles,
+            getExposedRects: module.getExposedRects,
+            setSubdivision: module.setSubdivision,
+            setAntialiasing: module.setAntialiasing,
+            lastExtraSamples: module.lastExtraSamples,
+            setColorHistogram: module.setColorHistogram,
+            clearColorHistogram: module.clearColorHistogram,
+            setCustomPalette: module.setCustomPalette,
+            tileHistogram: module.tileHistogram,
+            getPeriodicityStats: module.getPeriodicityStats,
+            resetPeriodicityStats: module.resetPeriodicityStats,
+            getTileStats: module.getTileStats,
+            getRenderStats: module.getRenderStats,
+            resetRenderStats: module.resetRenderStats,
+            startTrace: module.startTrace,
+            stopTrace: module.stopTrace,
             FractalType: {
                 MANDELBROT: 0,
                 JULIA: 1
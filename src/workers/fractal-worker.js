@@ -8,6 +8,80 @@ importScripts('../fractal.js');
 let wasmModule = null;
 let isInitialized = false;
 
+// Persistent output buffer leased from the WASM module's pool
+let tileBuffer = 0;
+let tileBufferSize = 0;
+
+// Transfer buffers handed back by the main thread after drawing
+const recycledBuffers = [];
+const MAX_RECYCLED_BUFFERS = 16;
+
+function leaseTileBuffer(size) {
+    if (size > tileBufferSize) {
+        if (tileBuffer) {
+            wasmModule.releaseTileBuffer(tileBuffer);
+        }
+        tileBuffer = wasmModule.acquireTileBuffer(size);
+        tileBufferSize = size;
+    }
+    return tileBuffer;
+}
+
+function takeTransferBuffer(size) {
+    const index = recycledBuffers.findIndex(buffer => buffer.byteLength === size);
+    if (index >= 0) {
+        return recycledBuffers.splice(index, 1)[0];
+    }
+    return new ArrayBuffer(size);
+}
+
+// WASM memory cannot be transferred, so copy once into a recycled transfer
+// buffer (no allocation once the pool is warm) and send it back, with the
+// tile's histogram when equalizing, its anti-aliasing sample count and its
+// render counters (profiling builds of the module only)
+function postTile(tile, pixelData, size, renderID, histogram = null, extraSamples = 0,
+                  stats = null) {
+    const buffer = takeTransferBuffer(size);
+    new Uint8Array(buffer).set(pixelData);
+
+    // Send result back (transfer ownership for zero-copy)
+    const transfer = histogram ? [buffer, histogram.buffer] : [buffer];
+    self.postMessage({
+        type: 'TILE_COMPLETE',
+        data: { tile, pixelData: buffer, histogram, extraSamples, stats, renderID }
+    }, transfer);
+}
+
+// Frame histogram loaded into the module for equalized coloring (0: none).
+// Every tile of a pass carries the same one, so it is only loaded once.
+let colorHistogramID = 0;
+
+function applyColorHistogram(params) {
+    const id = params.colorHistogram ? params.colorHistogramID : 0;
+    if (id === colorHistogramID) return;
+
+    if (params.colorHistogram) {
+        wasmModule.setColorHistogram(params.colorHistogram, params.colorHistogramMaxIter);
+    } else {
+        wasmModule.clearColorHistogram();
+    }
+    colorHistogramID = id;
+}
+
+// Copy of a tile's histogram from the retained frame, when equalizing
+function tileHistogram(tile, params) {
+    if (!params.equalize) return null;
+    const counts = wasmModule.tileHistogram(
+        tile.x,
+        tile.y,
+        tile.width,
+        tile.height,
+        params.maxIter,
+        params.sampleStep || 1
+    );
+    return counts ? counts.slice() : null;
+}
+
 // Initialize WASM module in worker context
 async function initializeWASM() {
     if (isInitialized) return;
@@ -41,6 +115,35 @@ self.addEventListener('message', async (e) => {
         return;
     }
 
+    if (type === 'TRACE_START') {
+        if (isInitialized) {
+            wasmModule.startTrace(data.workerID);
+        }
+        return;
+    }
+
+    if (type === 'TRACE_STOP') {
+        // Module timestamps count from this worker's time origin; shift them
+        // to the epoch so every worker's events share one clock
+        let events = [];
+        if (isInitialized) {
+            events = JSON.parse(wasmModule.stopTrace());
+            const origin = performance.timeOrigin * 1000;
+            for (const event of events) {
+                if (event.ts !== undefined) event.ts += origin;
+            }
+        }
+        self.postMessage({ type: 'TRACE_DATA', data: { events } });
+        return;
+    }
+
+    if (type === 'RECYCLE_BUFFER') {
+        if (recycledBuffers.length < MAX_RECYCLED_BUFFERS) {
+            recycledBuffers.push(data.buffer);
+        }
+        return;
+    }
+
     if (type === 'RENDER_TILE') {
         if (!isInitialized) {
             self.postMessage({
@@ -53,32 +156,77 @@ self.addEventListener('message', async (e) => {
         try {
             const { tile, viewport, params, renderID } = data;
 
-            // Call WASM render function
-            const pixelData = wasmModule.renderTile(
-                tile.x,
-                tile.y,
-                tile.width,
-                tile.height,
-                viewport.centerX,
-                viewport.centerY,
-                viewport.scale,
-                viewport.width,
-                viewport.height,
-                params.maxIter,
-                params.fractalType,
-                params.juliaCReal || 0,
-                params.juliaCImag || 0,
-                params.paletteID || 0
-            );
-
-            // Copy pixel data to transferable buffer
-            const buffer = new Uint8Array(pixelData).buffer;
-
-            // Send result back (transfer ownership for zero-copy)
-            self.postMessage({
-                type: 'TILE_COMPLETE',
-                data: { tile, pixelData: buffer, renderID }
-            }, [buffer]);
+            // Render straight into the leased WASM buffer. Deep-zoom views
+            // carry their center as decimal strings and go through the
+            // perturbation renderer; progressive passes carry their sample
+            // grid.
+            const size = tile.width * tile.height * 4;
+            const target = leaseTileBuffer(size);
+            wasmModule.setSubdivision(!!params.subdivide);
+            wasmModule.setKeepOrbits(!!params.keepOrbits);
+            wasmModule.setAntialiasing(params.antialias || 1);
+            applyColorHistogram(params);
+            let pixelData;
+            let extraSamples = 0;
+            if (viewport.deepCenterX !== undefined) {
+                pixelData = wasmModule.renderTileDeepInto(
+                    target,
+                    tile.x,
+                    tile.y,
+                    tile.width,
+                    tile.height,
+                    viewport.deepCenterX,
+                    viewport.deepCenterY,
+                    viewport.scale,
+                    viewport.width,
+                    viewport.height,
+                    params.maxIter,
+                    params.paletteID || 0
+                );
+            } else if (params.sampleStep) {
+                pixelData = wasmModule.renderPassInto(
+                    target,
+                    tile.x,
+                    tile.y,
+                    tile.width,
+                    tile.height,
+                    viewport.centerX,
+                    viewport.centerY,
+                    viewport.scale,
+                    viewport.width,
+                    viewport.height,
+                    params.maxIter,
+                    params.fractalType,
+                    params.juliaCReal || 0,
+                    params.juliaCImag || 0,
+                    params.paletteID || 0,
+                    params.sampleStep,
+                    params.previousSampleStep || 0
+                );
+                extraSamples = wasmModule.lastExtraSamples();
+            } else {
+                pixelData = wasmModule.renderTileInto(
+                    target,
+                    tile.x,
+                    tile.y,
+                    tile.width,
+                    tile.height,
+                    viewport.centerX,
+                    viewport.centerY,
+                    viewport.scale,
+                    viewport.width,
+                    viewport.height,
+                    params.maxIter,
+                    params.fractalType,
+                    params.juliaCReal || 0,
+                    params.juliaCImag || 0,
+                    params.paletteID || 0
+                );
+                extraSamples = wasmModule.lastExtraSamples();
+            }
+
+            postTile(tile, pixelData, size, renderID, tileHistogram(tile, params), extraSamples,
+                     wasmModule.getTileStats());
 
         } catch (error) {
             self.postMessage({
@@ -88,6 +236,120 @@ self.addEventListener('message', async (e) => {
             });
         }
     }
+
+    if (type === 'CONTINUE_TILE') {
+        // Raise the iteration limit of a tile this worker rendered earlier:
+        // only orbits stopped by the old limit are iterated further
+        try {
+            const { tile, viewport, params, renderID } = data;
+            const size = tile.width * tile.height * 4;
+            if (isInitialized) {
+                applyColorHistogram(params);
+                wasmModule.setKeepOrbits(!!params.keepOrbits);
+            }
+            const pixelData = isInitialized ?
+                wasmModule.continueTileInto(
+                    leaseTileBuffer(size),
+                    tile.x,
+                    tile.y,
+                    tile.width,
+                    tile.height,
+                    viewport.centerX,
+                    viewport.centerY,
+                    viewport.scale,
+                    viewport.width,
+                    viewport.height,
+                    params.maxIter,
+                    params.fractalType,
+                    params.juliaCReal || 0,
+                    params.juliaCImag || 0,
+                    params.paletteID || 0
+                ) : null;
+
+            if (!pixelData) {
+                throw new Error('no retained data for tile');
+            }
+            postTile(tile, pixelData, size, renderID, tileHistogram(tile, params), 0,
+                     wasmModule.getTileStats());
+        } catch (error) {
+            self.postMessage({
+                type: 'ERROR',
+                error: 'Continue error: ' + error.message,
+                data: data
+            });
+        }
+    }
+
+    if (type === 'RECOLOR_TILE') {
+        // Recolor a tile this worker rendered earlier from its retained
+        // iteration data: a memory pass instead of a re-render
+        try {
+            // The view is the frame's: a worker that has since rendered
+            // another view returns null instead of that view's data
+            const { tile, viewport, params, renderID } = data;
+            const size = tile.width * tile.height * 4;
+            if (isInitialized) {
+                applyColorHistogram(params);
+            }
+            const pixelData = isInitialized ?
+                wasmModule.recolorTileInto(
+                    leaseTileBuffer(size),
+                    tile.x,
+                    tile.y,
+                    tile.width,
+                    tile.height,
+                    viewport.centerX || 0,
+                    viewport.centerY || 0,
+                    viewport.deepCenterX || '',
+                    viewport.deepCenterY || '',
+                    viewport.scale,
+                    viewport.width,
+                    viewport.height,
+                    params.maxIter,
+                    params.fractalType || 0,
+                    params.juliaCReal || 0,
+                    params.juliaCImag || 0,
+                    params.paletteID || 0,
+                    params.colorOffset || 0,
+                    params.colorSpeed || 1
+                ) : null;
+
+            if (!pixelData) {
+                throw new Error('no retained data for tile');
+            }
+            postTile(tile, pixelData, size, renderID);
+        } catch (error) {
+            self.postMessage({
+                type: 'ERROR',
+                error: 'Recolor error: ' + error.message,
+                data: data
+            });
+        }
+    }
+
+    if (type === 'HISTOGRAM_TILE') {
+        // Histogram of a tile this worker rendered earlier, for equalizing
+        // a frame that was colored linearly
+        try {
+            const { tile, params, renderID } = data;
+            const histogram = isInitialized ?
+                tileHistogram(tile, { ...params, equalize: true }) : null;
+
+            if (!histogram) {
+                throw new Error('no retained data for tile');
+            }
+            self.postMessage({
+                type: 'TILE_COMPLETE',
+                data: { tile, histogram, renderID }
+            }, [histogram.buffer]);
+        } catch (error) {
+            self.postMessage({
+                type: 'ERROR',
+                error: 'Histogram error: ' + error.message,
+                data: data
+            });
+        }
+    }
 });
 
 // Auto-initialize on load